@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include <Usagi/Entity/detail/EntityId.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Refers to an individual selected as a crossover parent. Entities
+ * with this component are the slots of the offspring: selection fills in the
+ * parent, and recombination overwrites the chromosome of the entity with
+ * that of the offspring.
+ */
+struct CChromosomalCrossoverParent
+{
+    EntityId id;
+};
+}
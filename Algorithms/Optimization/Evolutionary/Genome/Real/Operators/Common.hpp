@@ -0,0 +1,222 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <random>
+#include <ranges>
+#include <span>
+
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/CChromosomeFloatingPoint.hpp>
+
+namespace usagi::detail
+{
+/*
+ * Shared pieces of the real-coded chromosome operators. The operators work
+ * on blocks of genes: random numbers for a whole block are generated into a
+ * local buffer first, then the genes are updated in a plain loop over arrays
+ * without branches, which compilers vectorize for the enabled instruction
+ * set (AVX2, AVX-512). Hand-written intrinsics are avoided to keep the
+ * module portable.
+ */
+
+// number of genes processed per block. the random numbers of one block stay
+// in L1 cache.
+constexpr std::size_t BLOCK_SIZE = 256;
+
+// uniform random numbers in [0, 1).
+template <typename URBG>
+void fill_canonical(URBG &rng, std::span<float> out)
+{
+    if constexpr(requires { rng.fill_canonical(out); })
+    {
+        rng.fill_canonical(out);
+    }
+    else
+    {
+        for(auto &&x : out)
+            x = std::generate_canonical<float, 24>(rng);
+    }
+}
+
+// natural logarithm of positive normal floats, with a relative error around
+// 1e-7. unlike std::log, it inlines into a branchless loop that compilers can
+// vectorize. (cephes logf)
+inline float fast_log(const float x)
+{
+    // x = m * 2^e with m in [sqrt(0.5), sqrt(2))
+    const auto bits = std::bit_cast<std::uint32_t>(x);
+    float e = static_cast<float>(static_cast<std::int32_t>(bits >> 23) - 126);
+    float m = std::bit_cast<float>((bits & 0x007FFFFF) | 0x3F000000);
+    const bool small = m < 0.707106781186547524f;
+    e = small ? e - 1.f : e;
+    m = small ? m + m - 1.f : m - 1.f;
+
+    const float z = m * m;
+    float y = 7.0376836292e-2f;
+    y = y * m - 1.1514610310e-1f;
+    y = y * m + 1.1676998740e-1f;
+    y = y * m - 1.2420140846e-1f;
+    y = y * m + 1.4249322787e-1f;
+    y = y * m - 1.6668057665e-1f;
+    y = y * m + 2.0000714765e-1f;
+    y = y * m - 2.4999993993e-1f;
+    y = y * m + 3.3333331174e-1f;
+    y = y * m * z;
+    y += e * -2.12194440e-4f;
+    y -= 0.5f * z;
+    return m + y + e * 0.693359375f;
+}
+
+// exponential function of x in [-87, 88], with a relative error around 1e-7.
+// the range is not checked, as clamping stops GCC from vectorizing the loops
+// using it. (cephes expf)
+inline float fast_exp(float x)
+{
+    // x = n * ln2 + r with |r| <= ln2 / 2. the argument is shifted to be
+    // positive so that truncating gives the floor.
+    const auto k = static_cast<std::int32_t>(
+        x * 1.44269504088896341f + (0.5f + 128.f)) - 128;
+    const auto n = static_cast<float>(k);
+    x -= n * 0.693359375f;
+    x -= n * -2.12194440e-4f;
+
+    const float z = x * x;
+    float y = 1.9875691500e-4f;
+    y = y * x + 1.3981999507e-3f;
+    y = y * x + 8.3334519073e-3f;
+    y = y * x + 4.1665795894e-2f;
+    y = y * x + 1.6666665459e-1f;
+    y = y * x + 5.0000001201e-1f;
+    y = y * z + x + 1.f;
+
+    // scale by 2^n
+    const auto scale = std::bit_cast<float>(
+        static_cast<std::uint32_t>(k + 127) << 23);
+    return y * scale;
+}
+
+// standard normal random numbers via the Box-Muller transform. the size of
+// the output must be even.
+template <typename URBG>
+void fill_normal(URBG &rng, std::span<float> out)
+{
+    assert(out.size() % 2 == 0);
+
+    fill_canonical(rng, out);
+
+    // the first half holds the radii and the second half the angles, so
+    // both outputs of each pair are written with unit stride.
+    const auto half = out.size() / 2;
+    float *u1 = out.data();
+    float *u2 = out.data() + half;
+
+    // the loops are split so that std::sqrt, which may set errno, does not
+    // prevent the other loops from being vectorized.
+    for(std::size_t i = 0; i < half; ++i)
+    {
+        // 1 - u is in (0, 1] which avoids log(0).
+        u1[i] = -2.f * fast_log(1.f - u1[i]);
+    }
+    for(std::size_t i = 0; i < half; ++i)
+        u1[i] = std::sqrt(u1[i]);
+
+    for(std::size_t i = 0; i < half; ++i)
+    {
+        // the pair is rotationally symmetric, so any uniform angle does.
+        // pick a quadrant with the top 2 bits of u2 and an angle in
+        // [-pi/4, pi/4) relative to it with the rest, which only needs
+        // short polynomials for sin & cos.
+        const auto q = static_cast<std::int32_t>(u2[i] * 4.f);
+        const float t = (u2[i] * 4.f - static_cast<float>(q) - 0.5f) *
+            (std::numbers::pi_v<float> / 2);
+        const float t2 = t * t;
+        const float c = 1.f + t2 * (-0.5f + t2 * (1.f / 24 + t2 *
+            (-1.f / 720 + t2 * (1.f / 40320))));
+        const float s = t * (1.f + t2 * (-1.f / 6 + t2 * (1.f / 120 + t2 *
+            (-1.f / 5040 + t2 * (1.f / 362880)))));
+
+        // rotate (c, s) by q * 90 degrees
+        const bool swap = (q & 1) != 0;
+        const bool negate_x = ((q ^ (q >> 1)) & 1) != 0;
+        const bool negate_y = (q & 2) != 0;
+        const float x = swap ? s : c;
+        const float y = swap ? c : s;
+        const float r = u1[i];
+        u1[i] = r * (negate_x ? -x : x);
+        u2[i] = r * (negate_y ? -y : y);
+    }
+}
+
+// view the genes of consecutive chromosomes as one array.
+template <std::floating_point Gene, std::size_t Size>
+std::span<Gene> flatten(std::span<CChromosomeFloatingPoint<Gene, Size>> c)
+{
+    static_assert(
+        sizeof(CChromosomeFloatingPoint<Gene, Size>) == sizeof(Gene) * Size,
+        "chromosomes must be tightly packed."
+    );
+    return { c.empty() ? nullptr : c.front().data(), c.size() * Size };
+}
+
+template <std::floating_point Gene, std::size_t Size>
+std::span<const Gene> flatten(
+    std::span<const CChromosomeFloatingPoint<Gene, Size>> c)
+{
+    static_assert(
+        sizeof(CChromosomeFloatingPoint<Gene, Size>) == sizeof(Gene) * Size,
+        "chromosomes must be tightly packed."
+    );
+    return { c.empty() ? nullptr : c.front().data(), c.size() * Size };
+}
+
+/**
+ * \brief Call `func(block)` for successive blocks of the gene range, where
+ * `block` is a span of genes. Contiguous ranges are passed directly so the
+ * loops in `func` can be vectorized. Other ranges, e.g. chunked views, are
+ * staged through a local buffer.
+ */
+template <typename Range, typename Func>
+void for_each_gene_block(Range &&genes, Func &&func)
+{
+    if constexpr(std::ranges::contiguous_range<Range>)
+    {
+        std::span span { genes };
+        for(std::size_t i = 0; i < span.size(); i += BLOCK_SIZE)
+            func(span.subspan(i, std::min(BLOCK_SIZE, span.size() - i)));
+    }
+    else
+    {
+        using std::begin;
+        using std::end;
+        using Gene = std::remove_cvref_t<decltype(*begin(genes))>;
+
+        Gene buffer[BLOCK_SIZE];
+        auto iter = begin(genes);
+        const auto last = end(genes);
+        while(iter != last)
+        {
+            auto block_begin = iter;
+            std::size_t n = 0;
+            for(; n < BLOCK_SIZE && iter != last; ++n, ++iter)
+                buffer[n] = *iter;
+            func(std::span<Gene>(buffer, n));
+            for(std::size_t i = 0; i < n; ++i, ++block_begin)
+                *block_begin = buffer[i];
+        }
+    }
+}
+
+// call `func(offset, size)` for successive blocks of [0, size).
+template <typename Func>
+void for_each_index_block(const std::size_t size, Func &&func)
+{
+    for(std::size_t i = 0; i < size; i += BLOCK_SIZE)
+        func(i, std::min(BLOCK_SIZE, size - i));
+}
+}
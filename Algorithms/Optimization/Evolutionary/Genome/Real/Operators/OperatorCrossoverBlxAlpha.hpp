@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include "Common.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Blend crossover (BLX-alpha). Each gene of the offspring is drawn
+ * uniformly from the interval spanned by the parent genes, extended by Alpha
+ * times its length on both sides.
+ *
+ * Reference: Larry J. Eshelman and J. David Schaffer. 1993. Real-coded
+ * genetic algorithms and interval-schemata.
+ */
+template <float Alpha = 0.5f>
+struct OperatorCrossoverBlxAlpha
+{
+    static_assert(Alpha >= 0);
+
+    /**
+     * \brief Produce two offspring from each pair of parents. The i-th
+     * offspring of each span comes from the i-th parents.
+     */
+    template <std::floating_point Gene, std::size_t Size, typename URBG>
+    void operator()(
+        std::span<const CChromosomeFloatingPoint<Gene, Size>> parents_a,
+        std::span<const CChromosomeFloatingPoint<Gene, Size>> parents_b,
+        std::span<CChromosomeFloatingPoint<Gene, Size>> offspring_a,
+        std::span<CChromosomeFloatingPoint<Gene, Size>> offspring_b,
+        URBG &rng) const
+    {
+        assert(parents_b.size() == parents_a.size());
+        assert(offspring_a.size() == parents_a.size());
+        assert(offspring_b.size() == parents_a.size());
+
+        const auto p0 = detail::flatten(parents_a);
+        const auto p1 = detail::flatten(parents_b);
+        const auto c0 = detail::flatten(offspring_a);
+        const auto c1 = detail::flatten(offspring_b);
+
+        detail::for_each_index_block(p0.size(), [&](
+            const std::size_t offset,
+            const std::size_t n) {
+            float u0[detail::BLOCK_SIZE];
+            float u1[detail::BLOCK_SIZE];
+            detail::fill_canonical(rng, { u0, n });
+            detail::fill_canonical(rng, { u1, n });
+
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                const auto a = p0[offset + i];
+                const auto b = p1[offset + i];
+                const auto lo = std::min(a, b);
+                const auto d = std::abs(a - b);
+                const auto base = lo - Gene(Alpha) * d;
+                const auto width = d * Gene(1 + 2 * Alpha);
+                c0[offset + i] = base + static_cast<Gene>(u0[i]) * width;
+                c1[offset + i] = base + static_cast<Gene>(u1[i]) * width;
+            }
+        });
+    }
+
+    template <std::floating_point Gene, std::size_t Size, typename URBG>
+    void operator()(
+        const CChromosomeFloatingPoint<Gene, Size> &parent_a,
+        const CChromosomeFloatingPoint<Gene, Size> &parent_b,
+        CChromosomeFloatingPoint<Gene, Size> &offspring_a,
+        CChromosomeFloatingPoint<Gene, Size> &offspring_b,
+        URBG &rng) const
+    {
+        using ChromosomeT = CChromosomeFloatingPoint<Gene, Size>;
+        (*this)(
+            std::span<const ChromosomeT>(&parent_a, 1),
+            std::span<const ChromosomeT>(&parent_b, 1),
+            std::span<ChromosomeT>(&offspring_a, 1),
+            std::span<ChromosomeT>(&offspring_b, 1),
+            rng
+        );
+    }
+};
+}
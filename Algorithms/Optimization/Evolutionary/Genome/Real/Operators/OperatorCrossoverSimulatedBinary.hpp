@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include "Common.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Simulated binary crossover (SBX). The offspring are spread around
+ * the parents with a spread factor whose distribution is controlled by the
+ * distribution index Eta. Larger Eta keeps the offspring closer to the
+ * parents.
+ *
+ * Reference: Kalyanmoy Deb and Ram Bhushan Agrawal. 1995. Simulated binary
+ * crossover for continuous search space.
+ */
+template <float Eta = 15.f>
+struct OperatorCrossoverSimulatedBinary
+{
+    static_assert(Eta >= 0);
+
+    /**
+     * \brief Produce two offspring from each pair of parents. The i-th
+     * offspring of each span comes from the i-th parents.
+     */
+    template <std::floating_point Gene, std::size_t Size, typename URBG>
+    void operator()(
+        std::span<const CChromosomeFloatingPoint<Gene, Size>> parents_a,
+        std::span<const CChromosomeFloatingPoint<Gene, Size>> parents_b,
+        std::span<CChromosomeFloatingPoint<Gene, Size>> offspring_a,
+        std::span<CChromosomeFloatingPoint<Gene, Size>> offspring_b,
+        URBG &rng) const
+    {
+        assert(parents_b.size() == parents_a.size());
+        assert(offspring_a.size() == parents_a.size());
+        assert(offspring_b.size() == parents_a.size());
+
+        const auto p0 = detail::flatten(parents_a);
+        const auto p1 = detail::flatten(parents_b);
+        const auto c0 = detail::flatten(offspring_a);
+        const auto c1 = detail::flatten(offspring_b);
+
+        constexpr float exponent = 1.f / (Eta + 1.f);
+
+        detail::for_each_index_block(p0.size(), [&](
+            const std::size_t offset,
+            const std::size_t n) {
+            float u[detail::BLOCK_SIZE];
+            detail::fill_canonical(rng, { u, n });
+
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                // beta = (2u)^e when u <= 0.5, else (1 / (2 (1 - u)))^e.
+                // both branches are evaluated as exp(e * log(x)) so the loop
+                // stays branchless. the tiny offset avoids log(0) and does
+                // not change any other value of u.
+                const float lower = 2.f * u[i] + 1e-30f;
+                const float upper = 1.f / (2.f * (1.f - u[i]));
+                const float x = u[i] <= 0.5f ? lower : upper;
+                const auto beta = static_cast<Gene>(detail::fast_exp(
+                    exponent * detail::fast_log(x)));
+
+                const auto a = p0[offset + i];
+                const auto b = p1[offset + i];
+                const auto sum = a + b;
+                const auto diff = beta * (a - b);
+                c0[offset + i] = Gene(0.5) * (sum + diff);
+                c1[offset + i] = Gene(0.5) * (sum - diff);
+            }
+        });
+    }
+
+    template <std::floating_point Gene, std::size_t Size, typename URBG>
+    void operator()(
+        const CChromosomeFloatingPoint<Gene, Size> &parent_a,
+        const CChromosomeFloatingPoint<Gene, Size> &parent_b,
+        CChromosomeFloatingPoint<Gene, Size> &offspring_a,
+        CChromosomeFloatingPoint<Gene, Size> &offspring_b,
+        URBG &rng) const
+    {
+        using ChromosomeT = CChromosomeFloatingPoint<Gene, Size>;
+        (*this)(
+            std::span<const ChromosomeT>(&parent_a, 1),
+            std::span<const ChromosomeT>(&parent_b, 1),
+            std::span<ChromosomeT>(&offspring_a, 1),
+            std::span<ChromosomeT>(&offspring_b, 1),
+            rng
+        );
+    }
+};
+}
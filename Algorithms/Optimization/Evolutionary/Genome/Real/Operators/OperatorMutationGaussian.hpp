@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include "Common.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Add normally distributed noise to the genes.
+ * \tparam Sigma Standard deviation of the noise.
+ * \tparam Rate Probability of each gene being mutated.
+ */
+template <float Sigma, float Rate = 1.f>
+struct OperatorMutationGaussian
+{
+    // mutate the genes of one chromosome, or a chunk of it.
+    template <typename Range, typename URBG>
+    void operator()(Range &&genes, URBG &rng) const
+    {
+        detail::for_each_gene_block(genes, [&]<typename Gene>(
+            std::span<Gene> block) {
+            float noise[detail::BLOCK_SIZE];
+            float coin[detail::BLOCK_SIZE];
+            const auto n = block.size();
+
+            // box-muller produces numbers in pairs
+            detail::fill_normal(rng, { noise, (n + 1) & ~std::size_t(1) });
+            if constexpr(Rate < 1.f)
+                detail::fill_canonical(rng, { coin, n });
+
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                const auto delta = static_cast<Gene>(Sigma * noise[i]);
+                if constexpr(Rate < 1.f)
+                    block[i] += coin[i] < Rate ? delta : Gene(0);
+                else
+                    block[i] += delta;
+            }
+        });
+    }
+
+    // mutate a batch of chromosomes stored consecutively.
+    template <std::floating_point Gene, std::size_t Size, typename URBG>
+    void operator()(
+        std::span<CChromosomeFloatingPoint<Gene, Size>> population,
+        URBG &rng) const
+    {
+        (*this)(detail::flatten(population), rng);
+    }
+};
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include "Common.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Replace genes with values drawn uniformly from [Lower, Upper).
+ * \tparam Rate Probability of each gene being reset.
+ */
+template <float Lower, float Upper, float Rate = 1.f>
+struct OperatorResetUniform
+{
+    static_assert(Lower < Upper);
+
+    // reset the genes of one chromosome, or a chunk of it.
+    template <typename Range, typename URBG>
+    void operator()(Range &&genes, URBG &rng) const
+    {
+        detail::for_each_gene_block(genes, [&]<typename Gene>(
+            std::span<Gene> block) {
+            float u[detail::BLOCK_SIZE];
+            float coin[detail::BLOCK_SIZE];
+            const auto n = block.size();
+
+            detail::fill_canonical(rng, { u, n });
+            if constexpr(Rate < 1.f)
+                detail::fill_canonical(rng, { coin, n });
+
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                const auto value =
+                    static_cast<Gene>(Lower + u[i] * (Upper - Lower));
+                if constexpr(Rate < 1.f)
+                    block[i] = coin[i] < Rate ? value : block[i];
+                else
+                    block[i] = value;
+            }
+        });
+    }
+
+    // reset a batch of chromosomes stored consecutively.
+    template <std::floating_point Gene, std::size_t Size, typename URBG>
+    void operator()(
+        std::span<CChromosomeFloatingPoint<Gene, Size>> population,
+        URBG &rng) const
+    {
+        (*this)(detail::flatten(population), rng);
+    }
+};
+}
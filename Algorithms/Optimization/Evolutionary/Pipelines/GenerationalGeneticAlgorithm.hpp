@@ -0,0 +1,171 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <execution>
+#include <functional>
+#include <utility>
+
+#include <Usagi/Entity/Archetype.hpp>
+#include <Usagi/Entity/ComponentQueryFilter.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/RandomNumbers/ServiceRandomNumberGenerator.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/Sampling/Probabilities/Ranking/SystemSelectionProbabilityRankingExponential.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/Sampling/Sampling/Roulette/SystemStochasticUniversalSamplingUnordered.hpp>
+#include <Usagi/Modules/Common/Indexing/EntityIndexDescriptor.hpp>
+#include <Usagi/Modules/Common/Indexing/FlatSortedMap.hpp>
+#include <Usagi/Modules/Common/Indexing/ServiceExternalEntityIndex.hpp>
+#include <Usagi/Modules/Common/Indexing/SystemRebuildEntityIndex.hpp>
+#include <Usagi/Modules/Runtime/Executive/SystemTaskList.hpp>
+#include <Usagi/Modules/Runtime/KeyValueStorage/ServiceRuntimeKeyValueStorage.hpp>
+
+#include "../Genealogy/CChromosomalCrossoverParent.hpp"
+#include "../Genome/Real/Operators/OperatorResetUniform.hpp"
+#include "../Population/CFitness.hpp"
+#include "../Population/CSelectionProbability.hpp"
+#include "../Systems/SystemApplyChromosomeOperator.hpp"
+#include "../Systems/SystemEvaluateFitness.hpp"
+#include "../Systems/SystemInitializePopulation.hpp"
+#include "../Systems/SystemRecombineParentSamples.hpp"
+#include "../Systems/SystemReplacePopulation.hpp"
+
+namespace usagi
+{
+// sort key of the fitness index. the serial makes equal fitness values unique.
+struct ProjectFitnessSerial
+{
+    std::pair<float, std::uint64_t> operator()(const CFitness &c) const
+    {
+        return { c.fitness, c.serial };
+    }
+};
+
+/**
+ * \brief Reference generational genetic algorithm assembled from the systems
+ * of the Evolutionary and Sampling modules. Each update of the task list is
+ * one generation:
+ *
+ *  1. initialize: create the population in the first generation.
+ *  2. evaluate:   compute the fitness of every individual.
+ *  3. index:      sort the individuals by fitness.
+ *  4. rank:       assign exponential ranking selection probabilities.
+ *  5. sample:     select parents by stochastic universal sampling.
+ *  6. vary:       recombine pairs of parents, then mutate the offspring.
+ *  7. replace:    the offspring replace the population.
+ *
+ * The key-value storage must provide `population_size` and
+ * `target_sample_size` (the number of offspring, usually the same).
+ *
+ * \tparam Chromosome Component type of the chromosome.
+ * \tparam Objective Objective function to minimize, providing the domain
+ * bounds LOWER and UPPER. See ObjectiveFunctions.hpp.
+ * \tparam Crossover Batch crossover operator.
+ * \tparam Mutation Mutation operator applied to each offspring.
+ * \tparam ExecutionPolicy Execution policy passed to the systems which
+ * support parallel execution.
+ */
+template <
+    Component Chromosome,
+    typename Objective,
+    typename Crossover,
+    typename Mutation,
+    typename ExecutionPolicy = std::execution::sequenced_policy
+>
+struct GenerationalGeneticAlgorithm
+{
+    using IndividualArchetype = Archetype<Chromosome, CFitness>;
+    using SampleArchetype = Archetype<Chromosome, CChromosomalCrossoverParent>;
+
+    using FitnessIndex = EntityIndexDescriptor<
+        ComponentQuery<C<Chromosome, CFitness>, C<>>,
+        CFitness,
+        ProjectFitnessSerial,
+        // the worst individual comes first and receives rank 1.
+        std::greater,
+        FlatSortedMap
+    >;
+
+    using SelectionQuery = ComponentQuery<
+        C<Chromosome, CFitness, CSelectionProbability>,
+        C<>
+    >;
+
+    using Initializer = OperatorResetUniform<
+        Objective::LOWER,
+        Objective::UPPER
+    >;
+
+    using SystemInitialize = SystemInitializePopulation<
+        IndividualArchetype,
+        Chromosome,
+        Initializer
+    >;
+    using SystemEvaluate = SystemEvaluateFitness<
+        Chromosome,
+        Objective,
+        ExecutionPolicy
+    >;
+    using SystemIndex = SystemRebuildEntityIndex<FitnessIndex>;
+    // ranks are scaled to the population size so that the selection
+    // pressure stays the same for any population.
+    using SystemRank = SystemSelectionProbabilityRankingExponential<
+        FitnessIndex,
+        CSelectionProbability,
+        1.0,
+        ExecutionPolicy
+    >;
+    using SystemSample = SystemStochasticUniversalSamplingUnordered<
+        SelectionQuery,
+        CSelectionProbability,
+        SampleArchetype,
+        CChromosomalCrossoverParent,
+        ExecutionPolicy
+    >;
+    using SystemRecombine = SystemRecombineParentSamples<
+        Chromosome,
+        Crossover,
+        CChromosomalCrossoverParent,
+        ExecutionPolicy
+    >;
+    using SystemMutate = SystemApplyChromosomeOperator<
+        Chromosome,
+        Mutation,
+        0,
+        C<CChromosomalCrossoverParent>,
+        C<>,
+        ExecutionPolicy
+    >;
+    using SystemReplace = SystemReplacePopulation<
+        Chromosome,
+        CChromosomalCrossoverParent
+    >;
+
+    using Systems = SystemTaskList<
+        SystemInitialize,
+        SystemEvaluate,
+        SystemIndex,
+        SystemRank,
+        SystemSample,
+        SystemRecombine,
+        SystemMutate,
+        SystemReplace
+    >;
+
+    // names of the systems above in the same order, for reporting.
+    constexpr static const char *STAGE_NAMES[] = {
+        "initialize",
+        "evaluate",
+        "index",
+        "rank",
+        "sample",
+        "recombine",
+        "mutate",
+        "replace",
+    };
+
+    struct Services
+        : ServiceRuntimeKeyValueStorage
+        , ServiceRandomStreams
+        , ServiceExternalEntityIndex<FitnessIndex>
+    {
+    };
+};
+}
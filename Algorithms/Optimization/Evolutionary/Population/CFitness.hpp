@@ -0,0 +1,18 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace usagi
+{
+/**
+ * \brief Fitness of an individual, given by the objective function being
+ * minimized. Lower is better.
+ */
+struct CFitness
+{
+    float fitness;
+    // identifies the individual for the lifetime of the population. used to
+    // break ties in the fitness index, whose keys must be unique.
+    std::uint64_t serial;
+};
+}
@@ -0,0 +1,9 @@
+﻿#pragma once
+
+namespace usagi
+{
+struct CSelectionProbability
+{
+    double probability;
+};
+}
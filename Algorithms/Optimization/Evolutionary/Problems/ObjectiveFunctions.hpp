@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <ranges>
+
+namespace usagi
+{
+/*
+ * Standard test functions for real-coded optimization. All of them have the
+ * global minimum 0. LOWER and UPPER give the usual search domain of each
+ * variable.
+ */
+
+// f(x) = sum x_i^2. unimodal and separable. minimum at x = 0.
+struct ObjectiveSphere
+{
+    constexpr static float LOWER = -5.12f;
+    constexpr static float UPPER = 5.12f;
+
+    template <std::ranges::input_range Genes>
+    float operator()(const Genes &x) const
+    {
+        float sum = 0;
+        for(const float xi : x)
+            sum += xi * xi;
+        return sum;
+    }
+};
+
+// f(x) = 10 n + sum (x_i^2 - 10 cos(2 pi x_i)). highly multimodal with a
+// regular grid of local minima. minimum at x = 0.
+struct ObjectiveRastrigin
+{
+    constexpr static float LOWER = -5.12f;
+    constexpr static float UPPER = 5.12f;
+
+    template <std::ranges::input_range Genes>
+    float operator()(const Genes &x) const
+    {
+        constexpr float two_pi = 2 * std::numbers::pi_v<float>;
+        float sum = 0;
+        for(const float xi : x)
+            sum += xi * xi - 10.f * std::cos(two_pi * xi) + 10.f;
+        return sum;
+    }
+};
+
+// f(x) = sum 100 (x_{i+1} - x_i^2)^2 + (1 - x_i)^2. the minimum at x = 1 lies
+// in a long curved valley which is hard to follow.
+struct ObjectiveRosenbrock
+{
+    constexpr static float LOWER = -2.048f;
+    constexpr static float UPPER = 2.048f;
+
+    template <std::ranges::random_access_range Genes>
+    float operator()(const Genes &x) const
+    {
+        float sum = 0;
+        const auto n = std::ranges::size(x);
+        for(std::size_t i = 0; i + 1 < n; ++i)
+        {
+            const float a = x[i + 1] - x[i] * x[i];
+            const float b = 1.f - x[i];
+            sum += 100.f * a * a + b * b;
+        }
+        return sum;
+    }
+};
+}
@@ -1,11 +1,14 @@
 ﻿#pragma once
 
+#include <execution>
+
 #include <range/v3/view/chunk.hpp>
 
 #include <Usagi/Entity/EntityDatabase.hpp>
 #include <Usagi/Runtime/Service/ServiceAccess.hpp>
 
-#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Services/ServiceRandomNumberGenerator.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/RandomNumbers/ServiceRandomNumberGenerator.hpp>
+#include <Usagi/Modules/Common/Functional/Visitors/ForEachEntityBlock.hpp>
 
 namespace usagi
 {
@@ -20,42 +23,69 @@ namespace usagi
  * subrange independently.
  * \tparam IncludeFilter Extra include filter.
  * \tparam ExcludeFilter Extra exclude filter.
+ * \tparam ExecutionPolicy Execution policy used to process the individuals,
+ * e.g. std::execution::parallel_policy for large populations. Each individual
+ * draws from its own random stream, so the result is the same under any
+ * policy.
  */
 template <
     Component Chromosome,
     typename Operator,
     std::size_t ChunkSize = 0,
     IsComponentFilter IncludeFilter = C<>,
-    IsComponentFilter ExcludeFilter = C<>
+    IsComponentFilter ExcludeFilter = C<>,
+    typename ExecutionPolicy = std::execution::sequenced_policy
 >
 struct SystemApplyChromosomeOperator
 {
     using WriteAccess = C<Chromosome>;
     using ReadAccess = FilterConcatenatedT<IncludeFilter, ExcludeFilter>;
 
-    using ServiceAccessT = ServiceAccess<ServiceRandomNumberGenerator>;
+    using ServiceAccessT = ServiceAccess<ServiceRandomStreams>;
+
+    // the random streams do not depend on the execution policy.
+    using RandomStreamKey = SystemApplyChromosomeOperator<
+        Chromosome,
+        Operator,
+        ChunkSize,
+        IncludeFilter,
+        ExcludeFilter
+    >;
+
+    EntityBlockBuffers block_buffers;
 
     void update(ServiceAccessT rt, auto &&db)
     {
-        for(auto &&e : db.view(
-            FilterConcatenatedT<IncludeFilter, C<Chromosome>>(), 
-            ExcludeFilter()))
-        {
-            auto &chromosome = USAGI_COMPONENT(e, Chromosome);
+        ExecutionPolicy policy;
 
-            if constexpr(ChunkSize == 0)
-            {
-                Operator()(chromosome, rt.rng());
-            }
-            else
+        auto view = db.view(
+            FilterConcatenatedT<IncludeFilter, C<Chromosome>>(),
+            ExcludeFilter());
+        const auto streams =
+            rt.random_streams().next_update<RandomStreamKey>();
+
+        for_each_entity_block(policy, view, block_buffers, [&](auto &&block) {
+            for(auto &&e : block)
             {
-                for(auto &&chunked : 
-                    chromosome | ranges::views::chunk(ChunkSize))
+                auto &chromosome = USAGI_COMPONENT(e, Chromosome);
+                // each individual has its own stream so the result doesn't
+                // depend on the iteration order or the thread.
+                auto rng = streams.stream(e.id());
+
+                if constexpr(ChunkSize == 0)
+                {
+                    Operator()(chromosome, rng);
+                }
+                else
                 {
-                    Operator()(chunked, rt.rng());
+                    for(auto &&chunked :
+                        chromosome | ranges::views::chunk(ChunkSize))
+                    {
+                        Operator()(chunked, rng);
+                    }
                 }
             }
-        }
+        });
     }
 };
 }
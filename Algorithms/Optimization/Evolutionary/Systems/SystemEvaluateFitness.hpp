@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <execution>
+
+#include <Usagi/Entity/EntityDatabase.hpp>
+#include <Usagi/Runtime/Service/ServiceAccess.hpp>
+#include <Usagi/Modules/Common/Functional/Visitors/ForEachEntityBlock.hpp>
+
+#include "../Population/CFitness.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Evaluate the objective function on the chromosome of every
+ * individual and store the result as its fitness.
+ * \tparam Chromosome Component type of the chromosome.
+ * \tparam Objective Callable mapping the chromosome to the value being
+ * minimized.
+ * \tparam ExecutionPolicy Execution policy used to evaluate the individuals.
+ */
+template <
+    Component Chromosome,
+    typename Objective,
+    typename ExecutionPolicy = std::execution::sequenced_policy
+>
+struct SystemEvaluateFitness
+{
+    using WriteAccess = C<CFitness>;
+    using ReadAccess = C<Chromosome>;
+
+    using ServiceAccessT = ServiceAccess<>;
+
+    EntityBlockBuffers block_buffers;
+
+    void update(ServiceAccessT rt, auto &&db)
+    {
+        ExecutionPolicy policy;
+
+        auto view = db.view(C<Chromosome, CFitness>());
+
+        for_each_entity_block(policy, view, block_buffers, [](auto &&block) {
+            for(auto &&e : block)
+            {
+                const auto &chromosome = USAGI_COMPONENT(e, Chromosome);
+                USAGI_COMPONENT(e, CFitness).fitness = Objective()(chromosome);
+            }
+        });
+    }
+};
+}
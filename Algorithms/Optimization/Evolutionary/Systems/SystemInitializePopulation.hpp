@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <Usagi/Entity/Archetype.hpp>
+#include <Usagi/Entity/EntityDatabase.hpp>
+#include <Usagi/Runtime/Service/ServiceAccess.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/RandomNumbers/ServiceRandomNumberGenerator.hpp>
+#include <Usagi/Modules/Runtime/KeyValueStorage/ServiceRuntimeKeyValueStorage.hpp>
+
+#include "../Population/CFitness.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Create individuals with randomly initialized chromosomes until the
+ * population reaches `population_size` in the key-value storage. Usually
+ * this only does work in the first generation.
+ * \tparam IndividualArchetype The archetype of individuals.
+ * \tparam Chromosome Component type of the chromosome.
+ * \tparam Initializer Chromosome operator used to initialize the genes, e.g.
+ * OperatorResetUniform.
+ */
+template <
+    typename IndividualArchetype,
+    Component Chromosome,
+    typename Initializer
+>
+requires ArchetypeHasComponent<IndividualArchetype, Chromosome> &&
+    ArchetypeHasComponent<IndividualArchetype, CFitness>
+struct SystemInitializePopulation
+{
+    using WriteAccess = typename IndividualArchetype::ComponentFilterT;
+    using ReadAccess = C<>;
+
+    using ServiceAccessT = ServiceAccess<
+        ServiceRuntimeKeyValueStorage,
+        ServiceRandomStreams
+    >;
+
+    IndividualArchetype archetype;
+    // number of individuals created so far, also used as their serials.
+    std::uint64_t num_created = 0;
+
+    void update(ServiceAccessT rt, auto &&db)
+    {
+        const auto population_size =
+            rt.kv_storage().require<std::size_t>("population_size");
+        const auto streams = rt.random_streams()
+            .next_update<SystemInitializePopulation>();
+
+        for(; num_created < population_size; ++num_created)
+        {
+            auto rng = streams.stream(num_created);
+            Initializer()(archetype(C<Chromosome>()), rng);
+            archetype(C<CFitness>()) = { 0.f, num_created };
+            db.insert(archetype);
+        }
+    }
+};
+}
@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <span>
+#include <vector>
+
+#include <Usagi/Entity/EntityDatabase.hpp>
+#include <Usagi/Entity/detail/EntityId.hpp>
+#include <Usagi/Runtime/Service/ServiceAccess.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/RandomNumbers/ServiceRandomNumberGenerator.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Pair up the parent samples randomly and overwrite the chromosomes of
+ * the sample entities with the offspring of each pair.
+ *
+ * The parent chromosomes are gathered into contiguous buffers so that the
+ * crossover is applied to whole batches. The batches are processed under
+ * the execution policy, each with its own random stream.
+ * \tparam Chromosome Component type of the chromosome. Both the individuals
+ * and the sample entities must have it.
+ * \tparam Crossover Operator producing two offspring from each pair of
+ * parents, taking parallel spans of parents and offspring, e.g.
+ * OperatorCrossoverSimulatedBinary.
+ * \tparam SampleIdentity The component storing the EntityId of the parent.
+ * \tparam ExecutionPolicy Execution policy used to apply the crossover.
+ */
+template <
+    Component Chromosome,
+    typename Crossover,
+    Component SampleIdentity,
+    typename ExecutionPolicy = std::execution::sequenced_policy
+>
+struct SystemRecombineParentSamples
+{
+    using WriteAccess = C<Chromosome>;
+    using ReadAccess = C<SampleIdentity>;
+
+    using ServiceAccessT = ServiceAccess<ServiceRandomStreams>;
+
+    // the random streams do not depend on the execution policy.
+    using RandomStreamKey = SystemRecombineParentSamples<
+        Chromosome,
+        Crossover,
+        SampleIdentity
+    >;
+
+    // number of pairs recombined with one random stream.
+    constexpr static std::size_t BATCH_SIZE = 4096;
+
+    // kept across updates to reuse the memory.
+    std::vector<EntityId> sample_entities;
+    std::vector<EntityId> parents;
+    std::vector<Chromosome> parents_a, parents_b;
+    std::vector<Chromosome> offspring_a, offspring_b;
+    std::vector<std::size_t> batches;
+
+    void update(ServiceAccessT rt, auto &&db)
+    {
+        ExecutionPolicy policy;
+        const auto streams =
+            rt.random_streams().next_update<RandomStreamKey>();
+
+        sample_entities.clear();
+        parents.clear();
+        for(auto &&e : db.view(C<SampleIdentity, Chromosome>()))
+        {
+            sample_entities.push_back(e.id());
+            parents.push_back(USAGI_COMPONENT(e, SampleIdentity).id);
+        }
+
+        // the samples come in the order of selection, where copies of the
+        // same parent are adjacent. shuffle to get random pairs.
+        {
+            auto rng = streams.stream();
+            std::shuffle(parents.begin(), parents.end(), rng);
+        }
+
+        const auto num_pairs = parents.size() / 2;
+        parents_a.resize(num_pairs);
+        parents_b.resize(num_pairs);
+        offspring_a.resize(num_pairs);
+        offspring_b.resize(num_pairs);
+
+        for(std::size_t i = 0; i < num_pairs; ++i)
+        {
+            parents_a[i] = USAGI_COMPONENT(
+                db.entity(parents[2 * i]), Chromosome);
+            parents_b[i] = USAGI_COMPONENT(
+                db.entity(parents[2 * i + 1]), Chromosome);
+        }
+
+        batches.resize((num_pairs + BATCH_SIZE - 1) / BATCH_SIZE);
+        std::iota(batches.begin(), batches.end(), 0);
+        std::for_each(policy, batches.begin(), batches.end(),
+            [&](const std::size_t b) {
+                const auto begin = b * BATCH_SIZE;
+                const auto n = std::min(BATCH_SIZE, num_pairs - begin);
+                auto rng = streams.stream(b);
+                Crossover()(
+                    std::span<const Chromosome>(parents_a).subspan(begin, n),
+                    std::span<const Chromosome>(parents_b).subspan(begin, n),
+                    std::span<Chromosome>(offspring_a).subspan(begin, n),
+                    std::span<Chromosome>(offspring_b).subspan(begin, n),
+                    rng
+                );
+            }
+        );
+
+        for(std::size_t i = 0; i < num_pairs; ++i)
+        {
+            USAGI_COMPONENT(db.entity(sample_entities[2 * i]), Chromosome) =
+                offspring_a[i];
+            USAGI_COMPONENT(db.entity(sample_entities[2 * i + 1]), Chromosome) =
+                offspring_b[i];
+        }
+
+        // with an odd number of samples, the last one is copied from its
+        // parent without crossover.
+        if(parents.size() % 2)
+        {
+            USAGI_COMPONENT(db.entity(sample_entities.back()), Chromosome) =
+                USAGI_COMPONENT(db.entity(parents.back()), Chromosome);
+        }
+    }
+};
+}
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <Usagi/Entity/EntityDatabase.hpp>
+#include <Usagi/Runtime/Service/ServiceAccess.hpp>
+
+#include "../Population/CFitness.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Generational replacement: the chromosomes of the offspring, stored in
+ * the sample entities, are copied into the individuals and the sample
+ * entities are destroyed. The individual entities are kept, so the
+ * population does not create or destroy pages between generations.
+ *
+ * If there are fewer offspring than individuals, the remaining individuals
+ * survive unchanged. Extra offspring are dropped.
+ * \tparam Chromosome Component type of the chromosome.
+ * \tparam SampleIdentity The component marking the sample entities.
+ */
+template <
+    Component Chromosome,
+    Component SampleIdentity
+>
+struct SystemReplacePopulation
+{
+    using WriteAccess = C<Chromosome, SampleIdentity>;
+    using ReadAccess = C<CFitness>;
+
+    using ServiceAccessT = ServiceAccess<>;
+
+    void update(ServiceAccessT rt, auto &&db)
+    {
+        auto offspring = db.view(C<SampleIdentity, Chromosome>());
+        auto iter = offspring.begin();
+        const auto end = offspring.end();
+
+        for(auto &&e : db.view(C<Chromosome, CFitness>()))
+        {
+            if(iter == end) break;
+            USAGI_COMPONENT(e, Chromosome) =
+                USAGI_COMPONENT(*iter, Chromosome);
+            ++iter;
+        }
+
+        // the pages are reclaimed after the frame.
+        for(auto &&e : db.view(C<SampleIdentity>()))
+            e.destroy();
+    }
+};
+}
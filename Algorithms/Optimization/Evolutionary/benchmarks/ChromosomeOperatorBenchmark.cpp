@@ -0,0 +1,163 @@
+﻿// Benchmark of real-coded chromosome operators.
+//
+// Usage: ChromosomeOperatorBenchmark [population size]
+//
+// Applies each operator to a population of 64-gene chromosomes and reports the
+// time and throughput. "scalar" rows draw one random number per gene from
+// std::mt19937 through the standard distributions, as a per-gene operator
+// would. "per_entity" rows call the block operators once per chromosome with
+// a stream per individual, which is how SystemApplyChromosomeOperator invokes
+// them. "batch" rows pass the whole population in one call.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/CChromosomeFloatingPoint.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/Operators/OperatorCrossoverBlxAlpha.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/Operators/OperatorCrossoverSimulatedBinary.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/Operators/OperatorMutationGaussian.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/Operators/OperatorResetUniform.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/RandomNumbers/RandomStreams.hpp>
+
+using namespace usagi;
+
+namespace
+{
+constexpr std::size_t NumGenes = 64;
+
+using ChromosomeT = CChromosomeFloatingPoint<float, NumGenes>;
+using Clock = std::chrono::steady_clock;
+
+struct SystemBenchmark { };
+
+float gChecksum = 0;
+
+template <typename Func>
+void measure(
+    const char *name,
+    std::vector<ChromosomeT> &population,
+    Func &&func)
+{
+    const auto begin = Clock::now();
+    func();
+    const auto end = Clock::now();
+
+    const auto ms =
+        std::chrono::duration<double, std::milli>(end - begin).count();
+    const auto genes = static_cast<double>(population.size() * NumGenes);
+    fmt::print("{},{:.3f},{:.1f}\n", name, ms, genes / ms / 1e3);
+    gChecksum += population.back().back();
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t size = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    const std::size_t pairs = size / 2;
+
+    std::vector<ChromosomeT> population(size), offspring(size);
+    const auto streams = RandomStreams().next_update<SystemBenchmark>();
+
+    fmt::print("population={} genes={}\n", size, NumGenes);
+    fmt::print("operator,time_ms,million_genes_per_s\n");
+
+    measure("reset_uniform_scalar", population, [&] {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> dist(-5.12f, 5.12f);
+        for(auto &&c : population)
+            for(auto &&g : c)
+                g = dist(rng);
+    });
+    measure("reset_uniform_batch", population, [&] {
+        auto rng = streams.stream();
+        OperatorResetUniform<-5.12f, 5.12f>()(
+            std::span<ChromosomeT>(population), rng);
+    });
+
+    measure("mutation_gaussian_scalar", population, [&] {
+        std::mt19937 rng(1);
+        std::normal_distribution<float> dist(0.f, 0.1f);
+        for(auto &&c : population)
+            for(auto &&g : c)
+                g += dist(rng);
+    });
+    measure("mutation_gaussian_per_entity", population, [&] {
+        for(std::size_t i = 0; i < population.size(); ++i)
+        {
+            auto rng = streams.stream(i);
+            OperatorMutationGaussian<0.1f>()(population[i], rng);
+        }
+    });
+    measure("mutation_gaussian_batch", population, [&] {
+        auto rng = streams.stream();
+        OperatorMutationGaussian<0.1f>()(
+            std::span<ChromosomeT>(population), rng);
+    });
+    measure("mutation_gaussian_rate_0.1_batch", population, [&] {
+        auto rng = streams.stream();
+        OperatorMutationGaussian<0.1f, 0.1f>()(
+            std::span<ChromosomeT>(population), rng);
+    });
+
+    const std::span<const ChromosomeT> parents_a(population.data(), pairs);
+    const std::span<const ChromosomeT> parents_b(
+        population.data() + pairs, pairs);
+    const std::span<ChromosomeT> offspring_a(offspring.data(), pairs);
+    const std::span<ChromosomeT> offspring_b(
+        offspring.data() + pairs, pairs);
+
+    measure("crossover_blx_scalar", offspring, [&] {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> dist;
+        for(std::size_t i = 0; i < pairs; ++i)
+        {
+            for(std::size_t g = 0; g < NumGenes; ++g)
+            {
+                const auto a = parents_a[i][g];
+                const auto b = parents_b[i][g];
+                const auto lo = std::min(a, b);
+                const auto d = std::abs(a - b);
+                offspring_a[i][g] = lo - 0.5f * d + dist(rng) * 2.f * d;
+                offspring_b[i][g] = lo - 0.5f * d + dist(rng) * 2.f * d;
+            }
+        }
+    });
+    measure("crossover_blx_batch", offspring, [&] {
+        auto rng = streams.stream();
+        OperatorCrossoverBlxAlpha<0.5f>()(
+            parents_a, parents_b, offspring_a, offspring_b, rng);
+    });
+    measure("crossover_sbx_scalar", offspring, [&] {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> dist;
+        for(std::size_t i = 0; i < pairs; ++i)
+        {
+            for(std::size_t g = 0; g < NumGenes; ++g)
+            {
+                const auto u = dist(rng);
+                const auto beta = u <= 0.5f
+                    ? std::pow(2.f * u, 1.f / 16.f)
+                    : std::pow(1.f / (2.f * (1.f - u)), 1.f / 16.f);
+                const auto a = parents_a[i][g];
+                const auto b = parents_b[i][g];
+                offspring_a[i][g] = 0.5f * ((a + b) + beta * (a - b));
+                offspring_b[i][g] = 0.5f * ((a + b) - beta * (a - b));
+            }
+        }
+    });
+    measure("crossover_sbx_batch", offspring, [&] {
+        auto rng = streams.stream();
+        OperatorCrossoverSimulatedBinary<15.f>()(
+            parents_a, parents_b, offspring_a, offspring_b, rng);
+    });
+
+    fmt::print("checksum={}\n", gChecksum);
+
+    return 0;
+}
@@ -0,0 +1,136 @@
+﻿// Benchmark of the reference generational genetic algorithm.
+//
+// Usage: GenerationalGaBenchmark [max population size] [generations]
+//        [data folder]
+//
+// Runs GenerationalGeneticAlgorithm on AppHost for the Sphere, Rastrigin and
+// Rosenbrock functions with populations of 10^3 up to the given size
+// (default 10^7). For each run, the average time of every stage over the
+// generations after the first, the generations per second and the best
+// fitness in the last generation are reported. The first generation, which
+// creates the population, is excluded.
+//
+// The entity database of each run is stored in a subfolder of the data
+// folder (default ./ga_benchmark).
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <execution>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/CChromosomeFloatingPoint.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/Operators/OperatorCrossoverSimulatedBinary.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/Operators/OperatorMutationGaussian.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Pipelines/GenerationalGeneticAlgorithm.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Problems/ObjectiveFunctions.hpp>
+#include <Usagi/Modules/Runtime/Executive/AppHost.hpp>
+
+using namespace usagi;
+
+namespace
+{
+constexpr std::size_t NumGenes = 16;
+
+using ChromosomeT = CChromosomeFloatingPoint<float, NumGenes>;
+using Clock = std::chrono::steady_clock;
+
+template <typename Objective>
+using GeneticAlgorithmT = GenerationalGeneticAlgorithm<
+    ChromosomeT,
+    Objective,
+    OperatorCrossoverSimulatedBinary<15.f>,
+    // one gene per chromosome on average
+    OperatorMutationGaussian<0.1f, 1.f / NumGenes>,
+    std::execution::parallel_policy
+>;
+
+constexpr std::size_t NumStages =
+    std::size(GeneticAlgorithmT<ObjectiveSphere>::STAGE_NAMES);
+
+template <typename Objective>
+void run(
+    const char *name,
+    const std::size_t population_size,
+    const std::size_t generations,
+    const std::filesystem::path &data_folder)
+{
+    using GaT = GeneticAlgorithmT<Objective>;
+
+    const auto folder =
+        data_folder / fmt::format("{}_{}", name, population_size);
+    std::filesystem::remove_all(folder);
+
+    AppHost<typename GaT::Services, typename GaT::Systems> app(folder);
+
+    auto &kv = app.template service<ServiceRuntimeKeyValueStorage>();
+    kv.values["population_size"] = std::uint64_t(population_size);
+    kv.values["target_sample_size"] = std::uint64_t(population_size);
+
+    std::vector<double> stage_ms(NumStages);
+    double total_ms = 0;
+
+    for(std::size_t g = 0; g <= generations; ++g)
+    {
+        // the observer is called after each system, so the time between
+        // two calls is the time of the system.
+        std::size_t stage = 0;
+        const auto begin = Clock::now();
+        auto last = begin;
+        app.update([&](auto &&, auto &&) {
+            const auto now = Clock::now();
+            if(g > 0)
+            {
+                stage_ms[stage] += std::chrono::duration<double, std::milli>(
+                    now - last).count();
+            }
+            last = now;
+            ++stage;
+        });
+        const auto end = Clock::now();
+
+        if(g > 0)
+            total_ms += std::chrono::duration<double, std::milli>(
+                end - begin).count();
+    }
+
+    // the worst individual comes first in the index
+    const auto &index = app.template service<
+        ServiceExternalEntityIndex<typename GaT::FitnessIndex>>().index;
+    const float best = std::prev(index.end())->first.first;
+
+    fmt::print("{},{},{:.3f},{:.6g}",
+        name, population_size, generations * 1e3 / total_ms, best);
+    for(auto &&ms : stage_ms)
+        fmt::print(",{:.3f}", ms / generations);
+    fmt::print("\n");
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t max_size = argc > 1 ? std::atoll(argv[1]) : 10000000;
+    const std::size_t generations = argc > 2 ? std::atoll(argv[2]) : 10;
+    const std::filesystem::path data_folder =
+        argc > 3 ? argv[3] : "ga_benchmark";
+
+    fmt::print("genes={} generations={}\n", NumGenes, generations);
+    fmt::print("function,population,generations_per_s,best_fitness");
+    for(auto &&stage : GeneticAlgorithmT<ObjectiveSphere>::STAGE_NAMES)
+        fmt::print(",{}_ms", stage);
+    fmt::print("\n");
+
+    for(std::size_t size = 1000; size <= max_size; size *= 10)
+    {
+        run<ObjectiveSphere>("sphere", size, generations, data_folder);
+        run<ObjectiveRastrigin>("rastrigin", size, generations, data_folder);
+        run<ObjectiveRosenbrock>("rosenbrock", size, generations, data_folder);
+    }
+
+    return 0;
+}
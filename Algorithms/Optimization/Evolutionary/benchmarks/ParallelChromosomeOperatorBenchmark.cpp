@@ -0,0 +1,97 @@
+﻿// Benchmark of applying chromosome operators to entities in parallel.
+//
+// Usage: ParallelChromosomeOperatorBenchmark [population size]
+//
+// Runs the loop of SystemApplyChromosomeOperator over mock entity views with
+// Gaussian mutation under the sequenced and the parallel execution policy and
+// reports the speedup. The number of worker threads is decided by the standard
+// library backend (TBB for libstdc++), usually one per hardware thread. The
+// population after the update must be the same under both policies, since
+// every entity draws from its own random stream.
+
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/CChromosomeFloatingPoint.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Evolutionary/Genome/Real/Operators/OperatorMutationGaussian.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/RandomNumbers/RandomStreams.hpp>
+#include <Usagi/Modules/Common/Functional/Visitors/ForEachEntityBlock.hpp>
+
+using namespace usagi;
+
+namespace
+{
+using ChromosomeT = CChromosomeFloatingPoint<float, 64>;
+using Clock = std::chrono::steady_clock;
+
+struct SystemBenchmark { };
+
+// stands in for the entity views produced by db.view().
+struct MockEntityView
+{
+    ChromosomeT *chromosome;
+    std::uint64_t entity_id;
+};
+
+template <typename ExecutionPolicy>
+double run(
+    std::vector<MockEntityView> &views,
+    const SystemRandomStreams &streams,
+    const std::size_t repeats)
+{
+    ExecutionPolicy policy;
+    EntityBlockBuffers buffers;
+
+    const auto begin = Clock::now();
+    for(std::size_t r = 0; r < repeats; ++r)
+    {
+        for_each_entity_block(policy, views, buffers, [&](auto &&block) {
+            for(auto &&e : block)
+            {
+                auto rng = streams.stream(e.entity_id);
+                OperatorMutationGaussian<0.1f>()(*e.chromosome, rng);
+            }
+        });
+    }
+    const auto end = Clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - begin).count() /
+        static_cast<double>(repeats);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t size = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    constexpr std::size_t Repeats = 5;
+
+    std::vector<ChromosomeT> seq_population(size), par_population(size);
+    std::vector<MockEntityView> seq_views(size), par_views(size);
+    for(std::size_t i = 0; i < size; ++i)
+    {
+        seq_views[i] = { &seq_population[i], i };
+        par_views[i] = { &par_population[i], i };
+    }
+
+    const auto streams = RandomStreams().next_update<SystemBenchmark>();
+
+    fmt::print("population={} hardware_threads={}\n",
+        size, std::thread::hardware_concurrency());
+    fmt::print("policy,time_ms,speedup\n");
+
+    const auto seq_ms = run<std::execution::sequenced_policy>(
+        seq_views, streams, Repeats);
+    fmt::print("sequenced,{:.3f},1.00\n", seq_ms);
+    const auto par_ms = run<std::execution::parallel_policy>(
+        par_views, streams, Repeats);
+    fmt::print("parallel,{:.3f},{:.2f}\n", par_ms, seq_ms / par_ms);
+
+    fmt::print("identical: {}\n", seq_population == par_population);
+
+    return 0;
+}
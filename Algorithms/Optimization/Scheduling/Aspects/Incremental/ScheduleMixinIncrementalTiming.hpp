@@ -0,0 +1,352 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <Usagi/Library/Utilities/Variant.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Execution/ScheduleNodeExecuteTask.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Execution/ScheduleNodeExecutionBarrier.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Processors/ScheduleNodeProcessorReady.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Root/ScheduleNodeRoot.hpp>
+#include <Usagi/Runtime/ErrorHandling.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Update the time points of a built schedule after the task costs or
+ * the precedence constraints are changed, without rebuilding the whole
+ * constraint graph. Only the vertices reachable from the changed ones are
+ * visited, in topological order, and the propagation stops at vertices whose
+ * times are not affected.
+ *
+ * The processor assignment and the order of tasks on each processor are kept.
+ * Rebuild the schedule when they should be reconsidered.
+ *
+ * The index used by the updates is built by the first of them, so schedules
+ * that are never updated don't pay for it. Call build_timing_index() to
+ * build it ahead of time.
+ */
+template <
+    typename Graph,
+    typename TaskIndexT,
+    typename VertexIndexT
+>
+struct ScheduleMixinIncrementalTiming
+{
+    // indexed by vertex index
+    std::pmr::vector<std::pmr::vector<VertexIndexT>> incoming_edges;
+    std::pmr::vector<std::uint32_t> topological_ranks;
+
+    explicit ScheduleMixinIncrementalTiming(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : incoming_edges(resource)
+        , topological_ranks(resource)
+        , retime_flags(resource)
+        , retime_touched(resource)
+        , retime_queue(resource)
+    {
+    }
+
+    void build_timing_index()
+    {
+        auto &graph = *static_cast<Graph *>(this);
+
+        incoming_edges.clear();
+        incoming_edges.resize(graph.vertices.size());
+        for(auto &&[from, to] : graph.edges)
+            incoming_edges[to].push_back(from);
+
+        rebuild_topological_ranks();
+        timing_index_built = true;
+    }
+
+    // the graph is changed by something other than the updates below, e.g.
+    // it is scheduled again.
+    void invalidate_timing_index()
+    {
+        timing_index_built = false;
+    }
+
+    /**
+     * \brief Re-read the execution time of the subtasks of the task from the
+     * schedule and update the affected time points.
+     */
+    void update_task_exec_time(const TaskIndexT task)
+    {
+        using Exec = ScheduleNodeExecuteTask<TaskIndexT>;
+
+        auto &graph = *static_cast<Graph *>(this);
+        ensure_timing_index();
+
+        std::pmr::vector<VertexIndexT> changed(
+            incoming_edges.get_allocator());
+        graph.template visit_outgoing_edges<
+            ScheduleNodeExecutionBarrier<TaskIndexT>
+        >(graph.task_begin_barrier_index(task),
+            [&]<typename FromVertex, typename ToVertex>(
+                VertexIndexT from_idx,
+                FromVertex &from_v,
+                VertexIndexT to_idx,
+                ToVertex &&to_v) {
+                if constexpr(std::is_same_v<std::decay_t<ToVertex>, Exec>)
+                {
+                    const auto exec_time = subtask_exec_time_of(
+                        task, to_v.task_id);
+                    if(exec_time != to_v.exec_time)
+                    {
+                        to_v.exec_time = exec_time;
+                        changed.push_back(to_idx);
+                    }
+                }
+            }
+        );
+
+        retime(changed);
+    }
+
+    // make task `to` wait for task `from`.
+    void add_task_precedence(const TaskIndexT from, const TaskIndexT to)
+    {
+        using Barrier = ScheduleNodeExecutionBarrier<TaskIndexT>;
+
+        auto &graph = *static_cast<Graph *>(this);
+        ensure_timing_index();
+
+        const auto from_idx = graph.task_end_barrier_index(from);
+        const auto to_idx = graph.task_begin_barrier_index(to);
+
+        graph.template add_edge_silently<Barrier, Barrier>(from_idx, to_idx);
+        incoming_edges[to_idx].push_back(from_idx);
+
+        // the topological order is only affected when the new edge goes
+        // backward.
+        if(topological_ranks[from_idx] >= topological_ranks[to_idx])
+        {
+            try
+            {
+                rebuild_topological_ranks();
+            }
+            catch(...)
+            {
+                // the tasks are already ordered the other way on some
+                // processor. revert the change.
+                graph.remove_edge(from_idx, to_idx);
+                incoming_edges[to_idx].pop_back();
+                rebuild_topological_ranks();
+                throw;
+            }
+        }
+
+        const VertexIndexT seeds[] { to_idx };
+        retime(seeds);
+    }
+
+    void remove_task_precedence(const TaskIndexT from, const TaskIndexT to)
+    {
+        auto &graph = *static_cast<Graph *>(this);
+        ensure_timing_index();
+
+        const auto from_idx = graph.task_end_barrier_index(from);
+        const auto to_idx = graph.task_begin_barrier_index(to);
+
+        graph.remove_edge(from_idx, to_idx);
+        auto &incoming = incoming_edges[to_idx];
+        incoming.erase(std::ranges::find(incoming, from_idx));
+
+        // removing an edge never breaks a topological order.
+        const VertexIndexT seeds[] { to_idx };
+        retime(seeds);
+    }
+
+    /**
+     * \brief Recompute the time points of the seed vertices and propagate the
+     * changes to their descendants.
+     */
+    void retime(std::span<const VertexIndexT> seeds)
+    {
+        auto &graph = *static_cast<Graph *>(this);
+        ensure_timing_index();
+
+        retime_flags.resize(graph.vertices.size());
+
+        // process vertices in topological order so that each vertex is
+        // evaluated only once after all of its affected predecessors.
+        const auto push = [&](const VertexIndexT v) {
+            if(retime_flags[v] & RETIME_QUEUED) return;
+            retime_flags[v] |= RETIME_QUEUED;
+            retime_touched.push_back(v);
+            retime_queue.emplace_back(topological_ranks[v], v);
+            std::ranges::push_heap(retime_queue, std::greater<>());
+        };
+
+        for(auto &&s : seeds)
+            push(s);
+
+        // seeds are propagated even if their times are unchanged since
+        // their costs may have been changed.
+        for(auto &&s : seeds)
+            retime_flags[s] |= RETIME_SEED;
+
+        while(!retime_queue.empty())
+        {
+            std::ranges::pop_heap(retime_queue, std::greater<>());
+            const auto v = retime_queue.back().second;
+            retime_queue.pop_back();
+
+            if(!recompute_vertex_time(v) && !(retime_flags[v] & RETIME_SEED))
+                continue;
+
+            const auto [begin, end] = graph.edges.equal_range(v);
+            for(auto it = begin; it != end; ++it)
+                push(it->second);
+        }
+
+        // only the flags of the queued vertices were set.
+        for(auto &&v : retime_touched)
+            retime_flags[v] = 0;
+        retime_touched.clear();
+    }
+
+private:
+    constexpr static std::uint8_t RETIME_QUEUED = 1;
+    constexpr static std::uint8_t RETIME_SEED = 2;
+
+    // reused by retime() so that an update only costs as much as the
+    // vertices it visits. the flags are indexed by vertex index and are all
+    // zero between updates.
+    std::pmr::vector<std::uint8_t> retime_flags;
+    std::pmr::vector<VertexIndexT> retime_touched;
+    std::pmr::vector<std::pair<std::uint32_t, VertexIndexT>> retime_queue;
+
+    bool timing_index_built = false;
+
+    void ensure_timing_index()
+    {
+        if(!timing_index_built) build_timing_index();
+    }
+
+    float subtask_exec_time_of(
+        const TaskIndexT task,
+        const TaskIndexT composed_task_id)
+    {
+        auto &graph = *static_cast<Graph *>(this);
+
+        for(TaskIndexT j = 0; j < graph.num_subtasks(task); ++j)
+        {
+            if(graph.composed_task_id(task, j) == composed_task_id)
+                return graph.subtask_exec_time(task, j);
+        }
+        USAGI_UNREACHABLE("the execution node doesn't belong to the task.");
+    }
+
+    // evaluate the time points of a vertex from its predecessors following
+    // the same rules as the event handlers used when building the schedule.
+    // returns true if any time point is changed.
+    bool recompute_vertex_time(const VertexIndexT v)
+    {
+        using Barrier = ScheduleNodeExecutionBarrier<TaskIndexT>;
+        using Exec = ScheduleNodeExecuteTask<TaskIndexT>;
+        using Ready = ScheduleNodeProcessorReady;
+
+        auto &graph = *static_cast<Graph *>(this);
+
+        // the time when all predecessors are done. a vertex left without
+        // predecessors, e.g. the begin barrier of a source task after its
+        // precedence is removed, is ready at the start.
+        const auto incoming_ready_time = [&] {
+            float time = 0;
+            for(auto &&u : incoming_edges[v])
+            {
+                time = std::max(time, std::visit(Overloaded {
+                    [](const ScheduleNodeRoot &) {
+                        // the root only boots the scheduling.
+                        return 0.f;
+                    },
+                    [](const Ready &n) { return n.ready_time; },
+                    [](const Exec &n) { return n.finish_time; },
+                    [](const Barrier &n) { return n.finish_time; },
+                }, graph.vertices[u]));
+            }
+            return time;
+        };
+
+        return std::visit(Overloaded {
+            [](ScheduleNodeRoot &) {
+                return false;
+            },
+            [&](Ready &n) {
+                // processors created from the root node keep their time.
+                if(!std::holds_alternative<Exec>(
+                    graph.vertices[incoming_edges[v].front()]))
+                    return false;
+                const auto ready = incoming_ready_time();
+                const bool changed = ready != n.ready_time;
+                n.ready_time = ready;
+                return changed;
+            },
+            [&](Exec &n) {
+                const auto ready = incoming_ready_time();
+                const auto finish = ready + n.exec_time;
+                const bool changed =
+                    ready != n.ready_time || finish != n.finish_time;
+                n.ready_time = ready;
+                n.finish_time = finish;
+                return changed;
+            },
+            [&](Barrier &n) {
+                const auto ready = incoming_ready_time();
+                const bool changed =
+                    ready != n.ready_time || ready != n.finish_time;
+                n.ready_time = ready;
+                n.finish_time = ready;
+                return changed;
+            },
+        }, graph.vertices[v]);
+    }
+
+    // Kahn's algorithm over the whole constraint graph.
+    void rebuild_topological_ranks()
+    {
+        auto &graph = *static_cast<Graph *>(this);
+
+        const auto num_vertices = graph.vertices.size();
+        const auto resource = topological_ranks.get_allocator().resource();
+        std::pmr::vector<std::uint32_t> in_degrees(num_vertices, resource);
+        for(std::size_t i = 0; i < num_vertices; ++i)
+            in_degrees[i] = static_cast<std::uint32_t>(
+                incoming_edges[i].size());
+
+        std::pmr::vector<VertexIndexT> order(resource);
+        order.reserve(num_vertices);
+        for(std::size_t i = 0; i < num_vertices; ++i)
+        {
+            if(in_degrees[i] == 0)
+                order.push_back(static_cast<VertexIndexT>(i));
+        }
+        for(std::size_t head = 0; head < order.size(); ++head)
+        {
+            const auto [begin, end] = graph.edges.equal_range(order[head]);
+            for(auto it = begin; it != end; ++it)
+            {
+                if(--in_degrees[it->second] == 0)
+                    order.push_back(it->second);
+            }
+        }
+
+        USAGI_ASSERT_THROW(
+            order.size() == num_vertices,
+            std::runtime_error("the constraint graph contains cycles.")
+        );
+
+        topological_ranks.resize(num_vertices);
+        for(std::uint32_t i = 0; i < order.size(); ++i)
+            topological_ranks[order[i]] = i;
+    }
+};
+}
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <map>
+#include <memory_resource>
 
 namespace usagi
 {
@@ -11,8 +12,15 @@ template <
 >
 struct ScheduleMixinTaskBarrierIndices
 {
-    std::map<TaskIndexT, VertexIndexT> task_begin_barrier_indices;
-    std::map<TaskIndexT, VertexIndexT> task_end_barrier_indices;
+    std::pmr::map<TaskIndexT, VertexIndexT> task_begin_barrier_indices;
+    std::pmr::map<TaskIndexT, VertexIndexT> task_end_barrier_indices;
+
+    explicit ScheduleMixinTaskBarrierIndices(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : task_begin_barrier_indices(resource)
+        , task_end_barrier_indices(resource)
+    {
+    }
 
     auto task_begin_barrier_index(TaskIndexT task) const
     {
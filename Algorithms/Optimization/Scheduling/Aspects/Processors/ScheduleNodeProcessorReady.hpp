@@ -38,5 +38,13 @@ struct ScheduleNodeProcessorReady
         assert(!occupied);
         occupied = true;
     }
+
+    // make the processor available again. used when inserting another task
+    // into the idle slot before the task originally assigned to it.
+    void release()
+    {
+        assert(occupied);
+        occupied = false;
+    }
 };
 }
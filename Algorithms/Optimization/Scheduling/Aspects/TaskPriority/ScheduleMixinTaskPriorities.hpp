@@ -0,0 +1,20 @@
+﻿#pragma once
+
+#include <memory_resource>
+#include <vector>
+
+namespace usagi
+{
+template <typename TaskIndexT>
+struct ScheduleMixinTaskPriorities
+{
+    // indexed by task index. higher value gets scheduled earlier.
+    std::pmr::vector<float> task_priorities;
+
+    explicit ScheduleMixinTaskPriorities(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : task_priorities(resource)
+    {
+    }
+};
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+#include "ScheduleMixinTaskPriorities.hpp"
+
+namespace usagi
+{
+// evaluate the priorities of the original tasks using the provided policy.
+// the task graph must be constructed before applying this modifier.
+template <typename PriorityPolicy>
+struct ScheduleModifierAssignTaskPriorities
+{
+    template <typename Graph>
+    void operator()(Graph &&graph) requires
+        std::is_base_of_v<
+            ScheduleMixinTaskPriorities<
+                typename std::decay_t<Graph>::TaskIndexT>,
+            std::decay_t<Graph>
+        >
+    {
+        // copied instead of moved to keep the allocator of the schedule.
+        const auto priorities = PriorityPolicy()(std::as_const(graph));
+        graph.task_priorities.assign(priorities.begin(), priorities.end());
+        assert(graph.task_priorities.size() == graph.num_tasks());
+    }
+};
+}
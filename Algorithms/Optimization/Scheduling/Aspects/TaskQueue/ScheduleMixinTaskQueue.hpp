@@ -1,6 +1,8 @@
 ﻿#pragma once
 
+#include <memory_resource>
 #include <queue>
+#include <vector>
 
 namespace usagi
 {
@@ -31,12 +33,15 @@ struct ScheduleMixinTaskQueue
     // store the vertex indices of tasks to be scheduled
     std::priority_queue<
         VertexIndexT,
-        std::vector<VertexIndexT>,
+        std::pmr::vector<VertexIndexT>,
         TaskCompareFunc
     > task_queue;
 
-    ScheduleMixinTaskQueue()
-        : task_queue(TaskCompareFunc { .graph = static_cast<Graph *>(this) })
+    explicit ScheduleMixinTaskQueue(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : task_queue(
+            TaskCompareFunc { .graph = static_cast<Graph *>(this) },
+            std::pmr::vector<VertexIndexT>(resource))
     {
     }
 
@@ -24,14 +24,26 @@ struct ScheduleModifierListScheduler
         >
     {
         using TaskIndexT = typename std::decay_t<Graph>::TaskIndexT;
+        using VertexIndexT = typename std::decay_t<Graph>::VertexIndexT;
+
+        // the policy may keep states across allocations.
+        ProcAllocPolicy alloc_policy;
 
         while(!graph.task_queue.empty())
         {
             auto task_vertex_id = graph.task_queue.top();
             graph.task_queue.pop();
 
-            auto [proc_idx, proc_ref] = 
-                ProcAllocPolicy()(std::forward<Graph>(graph));
+            // policies that take the task into account, e.g. the ones
+            // minimizing the finish time of the task, accept the task
+            // vertex index as an extra parameter.
+            auto [proc_idx, proc_ref] = [&] {
+                if constexpr(std::is_invocable_v<
+                    ProcAllocPolicy &, Graph &, VertexIndexT>)
+                    return alloc_policy(graph, task_vertex_id);
+                else
+                    return alloc_policy(graph);
+            }();
 
             static_assert(std::is_reference_v<decltype(proc_ref)>);
 
@@ -39,6 +51,13 @@ struct ScheduleModifierListScheduler
                 ScheduleNodeProcessorReady,
                 ScheduleNodeExecuteTask<TaskIndexT>
             >(proc_idx, task_vertex_id);
+
+            if constexpr(requires {
+                alloc_policy.on_task_assigned(graph, proc_idx, task_vertex_id);
+            })
+            {
+                alloc_policy.on_task_assigned(graph, proc_idx, task_vertex_id);
+            }
         }
     }
 };
@@ -0,0 +1,231 @@
+﻿#include "ScheduleSweep.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <fmt/ostream.h>
+
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Facades/ScheduleHomogeneousSplittable.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/ProcessorAllocation/ProcessorAllocationEarliestAvailable.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/ProcessorAllocation/ProcessorAllocationInsertionEarliestFinish.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityCriticalPath.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityUniform.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityUpwardRank.hpp>
+#include <Usagi/Runtime/ErrorHandling.hpp>
+
+namespace usagi
+{
+namespace
+{
+// initial size of the per-worker arena. schedules exceeding it fall back to
+// the upstream allocator.
+constexpr std::size_t ArenaSize = 16 * 1024 * 1024;
+
+template <typename PriorityPolicy>
+void schedule_with_priority(
+    ScheduleHomogeneousSplittable &schedule,
+    const ScheduleSweepAllocation allocation)
+{
+    switch(allocation)
+    {
+        case ScheduleSweepAllocation::EARLIEST_AVAILABLE:
+            schedule.schedule<
+                PriorityPolicy,
+                ProcessorAllocationEarliestAvailable
+            >();
+            break;
+        case ScheduleSweepAllocation::INSERTION_EARLIEST_FINISH:
+            schedule.schedule<
+                PriorityPolicy,
+                ProcessorAllocationInsertionEarliestFinish
+            >();
+            break;
+        default: USAGI_UNREACHABLE("unknown allocation policy.");
+    }
+}
+
+void schedule_with_config(
+    ScheduleHomogeneousSplittable &schedule,
+    const ScheduleSweepConfig &config)
+{
+    schedule.max_subtasks = config.max_subtasks;
+    schedule.num_processors = config.num_processors;
+
+    switch(config.priority)
+    {
+        case ScheduleSweepPriority::UNIFORM:
+            schedule_with_priority<TaskPriorityUniform>(
+                schedule, config.allocation);
+            break;
+        case ScheduleSweepPriority::UPWARD_RANK:
+            schedule_with_priority<TaskPriorityUpwardRank>(
+                schedule, config.allocation);
+            break;
+        case ScheduleSweepPriority::CRITICAL_PATH:
+            schedule_with_priority<TaskPriorityCriticalPath>(
+                schedule, config.allocation);
+            break;
+        default: USAGI_UNREACHABLE("unknown priority policy.");
+    }
+}
+
+const char * to_string(const ScheduleSweepPriority priority)
+{
+    switch(priority)
+    {
+        case ScheduleSweepPriority::UNIFORM: return "uniform";
+        case ScheduleSweepPriority::UPWARD_RANK: return "upward_rank";
+        case ScheduleSweepPriority::CRITICAL_PATH: return "critical_path";
+        default: return "unknown";
+    }
+}
+
+const char * to_string(const ScheduleSweepAllocation allocation)
+{
+    switch(allocation)
+    {
+        case ScheduleSweepAllocation::EARLIEST_AVAILABLE:
+            return "earliest_available";
+        case ScheduleSweepAllocation::INSERTION_EARLIEST_FINISH:
+            return "insertion_eft";
+        default: return "unknown";
+    }
+}
+}
+
+std::vector<ScheduleSweepConfig> ScheduleSweepGrid::expand() const
+{
+    std::vector<ScheduleSweepConfig> configs;
+    configs.reserve(
+        max_subtasks.size() * num_processors.size() *
+        priorities.size() * allocations.size()
+    );
+    for(auto &&s : max_subtasks)
+        for(auto &&p : num_processors)
+            for(auto &&pr : priorities)
+                for(auto &&a : allocations)
+                    configs.push_back({ s, p, pr, a });
+    return configs;
+}
+
+std::vector<ScheduleSweepResult> run_schedule_sweep(
+    std::span<const TaskGraph * const> graphs,
+    std::span<const ScheduleSweepConfig> configs,
+    std::size_t num_threads)
+{
+    const auto num_jobs = graphs.size() * configs.size();
+    std::vector<ScheduleSweepResult> results(num_jobs);
+
+    if(num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min(num_threads, num_jobs);
+
+    // jobs are claimed one by one since the cost of schedules varies a lot
+    // with the size of the graphs.
+    std::atomic<std::size_t> next_job = 0;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    const auto worker = [&] {
+        std::vector<std::byte> buffer(ArenaSize);
+        std::pmr::monotonic_buffer_resource arena(
+            buffer.data(), buffer.size());
+        // TaskGraph doesn't take an allocator. instead of copying the graph
+        // into every schedule, the worker keeps one copy and moves it in and
+        // out. the jobs of the same graph are adjacent, so it is only copied
+        // again when the worker moves on to another graph.
+        TaskGraph task_graph;
+        std::size_t loaded_graph = -1;
+
+        try
+        {
+            for(auto job = next_job++; job < num_jobs; job = next_job++)
+            {
+                const auto graph_idx = job / configs.size();
+                const auto config_idx = job % configs.size();
+                auto &result = results[job];
+
+                {
+                    if(loaded_graph != graph_idx)
+                    {
+                        task_graph = *graphs[graph_idx];
+                        loaded_graph = graph_idx;
+                    }
+
+                    ScheduleHomogeneousSplittable schedule(&arena);
+                    schedule.task_graph = std::move(task_graph);
+
+                    const auto begin = std::chrono::steady_clock::now();
+                    schedule_with_config(schedule, configs[config_idx]);
+                    const auto end = std::chrono::steady_clock::now();
+
+                    result.graph_index =
+                        static_cast<std::uint32_t>(graph_idx);
+                    result.config_index =
+                        static_cast<std::uint32_t>(config_idx);
+                    result.makespan = schedule.makespan();
+                    result.schedule_time =
+                        std::chrono::duration<double>(end - begin).count();
+                    result.num_vertices = schedule.vertices.size();
+                    result.num_edges = schedule.edges.size();
+
+                    // scheduling only reads the task graph.
+                    task_graph = std::move(schedule.task_graph);
+                }
+
+                // the schedule is gone. reuse the arena for the next one.
+                arena.release();
+            }
+        }
+        catch(...)
+        {
+            std::lock_guard lk(error_mutex);
+            if(!error) error = std::current_exception();
+            // stop other workers from claiming more jobs.
+            next_job = num_jobs;
+        }
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        threads.reserve(num_threads);
+        for(std::size_t i = 0; i < num_threads; ++i)
+            threads.emplace_back(worker);
+    }
+
+    if(error) std::rethrow_exception(error);
+
+    return results;
+}
+
+void write_schedule_sweep_csv(
+    std::ostream &out,
+    std::span<const std::string> graph_names,
+    std::span<const ScheduleSweepConfig> configs,
+    std::span<const ScheduleSweepResult> results)
+{
+    fmt::print(out, "graph,max_subtasks,num_processors,priority,allocation,"
+        "vertices,edges,makespan,schedule_time\n");
+
+    for(auto &&r : results)
+    {
+        const auto &config = configs[r.config_index];
+        fmt::print(out, "{},{},{},{},{},{},{},{},{}\n",
+            graph_names[r.graph_index],
+            config.max_subtasks,
+            config.num_processors,
+            to_string(config.priority),
+            to_string(config.allocation),
+            r.num_vertices,
+            r.num_edges,
+            r.makespan,
+            r.schedule_time
+        );
+    }
+}
+}
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <Usagi/Modules/Resources/ResTaskGraphs/TaskGraph.hpp>
+
+namespace usagi
+{
+enum class ScheduleSweepPriority : std::uint8_t
+{
+    UNIFORM,
+    UPWARD_RANK,
+    CRITICAL_PATH,
+};
+
+enum class ScheduleSweepAllocation : std::uint8_t
+{
+    EARLIEST_AVAILABLE,
+    INSERTION_EARLIEST_FINISH,
+};
+
+// One point in the parameter space of ScheduleHomogeneousSplittable.
+struct ScheduleSweepConfig
+{
+    std::uint32_t max_subtasks = 2;
+    std::uint8_t num_processors = 4;
+    ScheduleSweepPriority priority = ScheduleSweepPriority::UPWARD_RANK;
+    ScheduleSweepAllocation allocation =
+        ScheduleSweepAllocation::INSERTION_EARLIEST_FINISH;
+};
+
+struct ScheduleSweepGrid
+{
+    std::vector<std::uint32_t> max_subtasks { 2 };
+    std::vector<std::uint8_t> num_processors { 4 };
+    std::vector<ScheduleSweepPriority> priorities {
+        ScheduleSweepPriority::UPWARD_RANK
+    };
+    std::vector<ScheduleSweepAllocation> allocations {
+        ScheduleSweepAllocation::INSERTION_EARLIEST_FINISH
+    };
+
+    // cartesian product of the parameter values.
+    std::vector<ScheduleSweepConfig> expand() const;
+};
+
+struct ScheduleSweepResult
+{
+    std::uint32_t graph_index = -1;
+    std::uint32_t config_index = -1;
+    float makespan = 0;
+    // wall time spent on building the schedule, in seconds.
+    double schedule_time = 0;
+    std::uint64_t num_vertices = 0;
+    std::uint64_t num_edges = 0;
+};
+
+/**
+ * \brief Schedule each task graph with each configuration. The schedules are
+ * evaluated concurrently by a pool of worker threads. Each worker builds its
+ * schedules inside a reusable arena that is released after each schedule.
+ * \param graphs Task graphs to be scheduled. They must stay alive and must not
+ * be modified during the call.
+ * \param configs Configurations to be evaluated.
+ * \param num_threads Number of worker threads. 0 means hardware concurrency.
+ * \return One result per (graph, config) pair, in row-major order of
+ * (graph, config).
+ */
+std::vector<ScheduleSweepResult> run_schedule_sweep(
+    std::span<const TaskGraph * const> graphs,
+    std::span<const ScheduleSweepConfig> configs,
+    std::size_t num_threads = 0);
+
+// Write the results as CSV. Graph names are indexed by graph_index.
+void write_schedule_sweep_csv(
+    std::ostream &out,
+    std::span<const std::string> graph_names,
+    std::span<const ScheduleSweepConfig> configs,
+    std::span<const ScheduleSweepResult> results);
+}
@@ -1,17 +1,31 @@
 ﻿#include "ScheduleHomogeneousSplittable.hpp"
 
+#include <algorithm>
+
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Precedence/ScheduleModifierInsertPrecedenceConstraints.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Processors/ScheduleModifierCreateProcessors.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Root/ScheduleModifierInsertRoot.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Subtasks/ScheduleModifierInsertSubtasks.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/TaskPriority/ScheduleModifierAssignTaskPriorities.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/TaskQueue/ScheduleModifierListScheduler.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/TaskQueue/ScheduleModifierStartScheduling.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/ProcessorAllocation/ProcessorAllocationEarliestAvailable.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/ProcessorAllocation/ProcessorAllocationInsertionEarliestFinish.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityCriticalPath.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityUniform.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityUpwardRank.hpp>
 
 namespace usagi
 {
-constexpr auto max_subtasks = 2;
-constexpr auto num_proc = 4;
+ScheduleHomogeneousSplittable::ScheduleHomogeneousSplittable(
+    std::pmr::memory_resource *resource)
+    : ScheduleMixinTaskBarrierIndices(resource)
+    , ScheduleMixinTaskPriorities(resource)
+    , ScheduleMixinTaskQueue(resource)
+    , ScheduleMixinIncrementalTiming(resource)
+    , ScheduleConstraintGraph(resource)
+{
+}
 
 ScheduleMixinTaskGraph::TaskIndexT
 ScheduleHomogeneousSplittable::num_subtasks(TaskIndexT task_index) const
@@ -27,11 +41,34 @@ ScheduleHomogeneousSplittable::composed_task_id(
     return task_idx * max_subtasks + subtask_idx;
 }
 
+ScheduleMixinTaskGraph::TaskIndexT
+ScheduleHomogeneousSplittable::parent_task_id(
+    TaskIndexT composed_task_idx) const
+{
+    return composed_task_idx / max_subtasks;
+}
+
 float ScheduleHomogeneousSplittable::subtask_exec_time(
     TaskIndexT task_idx,
     TaskIndexT subtask_idx) const
 {
-    return 12;
+    // the computation is evenly split among the subtasks.
+    return static_cast<float>(
+        eval_vertex_weight(task_graph.vertex(task_idx)) / max_subtasks);
+}
+
+float ScheduleHomogeneousSplittable::makespan() const
+{
+    float makespan = 0;
+    for(auto &&v : vertices)
+    {
+        if(const auto exec = std::get_if<
+            ScheduleNodeExecuteTask<TaskIndexT>>(&v))
+        {
+            makespan = std::max(makespan, exec->finish_time);
+        }
+    }
+    return makespan;
 }
 
 void ScheduleHomogeneousSplittable::do_schedule()
@@ -46,12 +83,26 @@ void ScheduleHomogeneousSplittable::do_schedule()
     task_graph.add_edge(4, 5);
     task_graph.add_edge(3, 5);
     task_graph.add_edge(5, 6);
+    for(TaskIndexT i = 0; i < num_tasks(); ++i)
+        task_graph.vertex(i).base_comp_cost = 24;
+
+    schedule<
+        TaskPriorityUpwardRank,
+        ProcessorAllocationInsertionEarliestFinish
+    >();
+}
+
+template <typename PriorityPolicy, typename ProcAllocPolicy>
+void ScheduleHomogeneousSplittable::schedule()
+{
+    // rank the tasks
+    ScheduleModifierAssignTaskPriorities<PriorityPolicy>()(*this);
 
     // create schedule root node
     ScheduleModifierInsertRoot()(*this);
 
     // init processors
-    ScheduleModifierCreateProcessors()(*this, num_proc);
+    ScheduleModifierCreateProcessors()(*this, num_processors);
 
     // create task begin & finish barriers & precedence constraints 
     ScheduleModifierInsertPrecedenceConstraints()(*this);
@@ -63,6 +114,23 @@ void ScheduleHomogeneousSplittable::do_schedule()
     ScheduleModifierStartScheduling()(*this);
 
     // create the schedule
-    ScheduleModifierListScheduler<ProcessorAllocationEarliestAvailable>()(*this);
+    ScheduleModifierListScheduler<ProcAllocPolicy>()(*this);
+
+    // the index for incremental updates is built by the first update.
+    invalidate_timing_index();
 }
+
+// instantiate the combinations of provided policies
+template void ScheduleHomogeneousSplittable::schedule<
+    TaskPriorityUniform, ProcessorAllocationEarliestAvailable>();
+template void ScheduleHomogeneousSplittable::schedule<
+    TaskPriorityUniform, ProcessorAllocationInsertionEarliestFinish>();
+template void ScheduleHomogeneousSplittable::schedule<
+    TaskPriorityUpwardRank, ProcessorAllocationEarliestAvailable>();
+template void ScheduleHomogeneousSplittable::schedule<
+    TaskPriorityUpwardRank, ProcessorAllocationInsertionEarliestFinish>();
+template void ScheduleHomogeneousSplittable::schedule<
+    TaskPriorityCriticalPath, ProcessorAllocationEarliestAvailable>();
+template void ScheduleHomogeneousSplittable::schedule<
+    TaskPriorityCriticalPath, ProcessorAllocationInsertionEarliestFinish>();
 }
@@ -4,6 +4,7 @@
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Events/ScheduleEventHandlerFallbackNoop.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Execution/ScheduleNodeExecuteTask.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Execution/ScheduleNodeExecutionBarrier.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Incremental/ScheduleMixinIncrementalTiming.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Precedence/ScheduleEventHandlerPrecedenceConstraints.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Precedence/ScheduleMixinTaskBarrierIndices.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Processors/ScheduleMixinNodeVisitorAvailableProcessors.hpp>
@@ -11,6 +12,7 @@
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Root/ScheduleMixinRootNodeIndex.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Root/ScheduleNodeRoot.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/TaskGraph/ScheduleMixinTaskGraph.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/TaskPriority/ScheduleMixinTaskPriorities.hpp>
 #include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/TaskQueue/ScheduleMixinTaskQueue.hpp>
 
 namespace usagi
@@ -24,6 +26,9 @@ struct ScheduleHomogeneousSplittable
         ScheduleMixinTaskGraph::TaskIndexT,
         ScheduleVertexT
     >
+    , ScheduleMixinTaskPriorities<
+        ScheduleMixinTaskGraph::TaskIndexT
+    >
     , ScheduleMixinTaskQueue<
         ScheduleHomogeneousSplittable,
         ScheduleMixinTaskGraph::TaskIndexT,
@@ -32,6 +37,11 @@ struct ScheduleHomogeneousSplittable
     , ScheduleMixinNodeVisitorAvailableProcessors<
         ScheduleHomogeneousSplittable
     >
+    , ScheduleMixinIncrementalTiming<
+        ScheduleHomogeneousSplittable,
+        ScheduleMixinTaskGraph::TaskIndexT,
+        ScheduleVertexT
+    >
     , ScheduleEventHandlerPrecedenceConstraints<
         ScheduleHomogeneousSplittable,
         ScheduleVertexT,
@@ -55,6 +65,13 @@ struct ScheduleHomogeneousSplittable
 
     using VertexIndexT = ScheduleVertexT;
 
+    // number of subtasks each task is evenly split into.
+    TaskIndexT max_subtasks = 2;
+    std::uint8_t num_processors = 4;
+
+    explicit ScheduleHomogeneousSplittable(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+
     TaskIndexT num_subtasks(TaskIndexT task_index) const;
     TaskIndexT composed_task_id(
         TaskIndexT task_idx,
@@ -63,11 +80,29 @@ struct ScheduleHomogeneousSplittable
         TaskIndexT task_idx,
         TaskIndexT subtask_idx) const;
 
-    int task_priority(TaskIndexT task_idx)
+    TaskIndexT parent_task_id(TaskIndexT composed_task_idx) const;
+
+    // the subtasks inherit the priority of the task they belong to.
+    float task_priority(TaskIndexT composed_task_idx) const
     {
-        return 1;
+        return task_priorities[parent_task_id(composed_task_idx)];
     }
 
+    /**
+     * \brief Schedule the task graph currently stored in `task_graph`. Only
+     * call this once on a schedule object. After that, changes to the task
+     * costs can be applied incrementally with update_task_exec_time().
+     * \tparam PriorityPolicy Determines the order of ready tasks. See
+     * TaskPriority folder.
+     * \tparam ProcAllocPolicy Determines the processor used to execute the
+     * task. See ProcessorAllocation folder.
+     */
+    template <typename PriorityPolicy, typename ProcAllocPolicy>
+    void schedule();
+
+    // schedule a sample task graph using HEFT.
     void do_schedule();
+
+    float makespan() const;
 };
 }
@@ -0,0 +1,166 @@
+﻿#pragma once
+
+#include <cassert>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <variant>
+
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Execution/ScheduleNodeExecuteTask.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Processors/ScheduleNodeProcessorReady.hpp>
+#include <Usagi/Runtime/ErrorHandling.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Insertion-based earliest finish time processor allocation as used by
+ * HEFT. Besides the processors idling at the end of their timelines, the idle
+ * slots between two tasks already assigned to a processor are also considered.
+ * The slot giving the earliest finish time of the task is picked.
+ *
+ * An occupied processor ready node is followed by the task it executes, so
+ * the idle slot starts from the ready time of the node and ends at the ready
+ * time of that task. When a slot is picked, the processor ready node is
+ * released and the following task is relinked to the processor timeline after
+ * the inserted task in on_task_assigned().
+ */
+struct ProcessorAllocationInsertionEarliestFinish
+{
+    // the execution node after the idle slot picked by the last allocation.
+    std::optional<std::uint64_t> slot_successor;
+
+    template <typename Graph>
+    auto operator()(
+        Graph &&graph,
+        const typename std::decay_t<Graph>::VertexIndexT task_vertex_idx)
+    {
+        using VertexIndexT = typename std::decay_t<Graph>::VertexIndexT;
+        using TaskIndexT = typename std::decay_t<Graph>::TaskIndexT;
+        using Exec = ScheduleNodeExecuteTask<TaskIndexT>;
+        using Ready = ScheduleNodeProcessorReady;
+
+        assert(!slot_successor.has_value());
+
+        const auto &task = graph.template vertex<Exec>(task_vertex_idx);
+
+        struct Candidate
+        {
+            VertexIndexT proc_idx = -1;
+            Ready *proc = nullptr;
+            VertexIndexT successor_idx = -1;
+            float finish_time = 0;
+        };
+        std::optional<Candidate> best;
+
+        const auto is_proc_ready = [](auto &&idx_v_pair) {
+            return std::holds_alternative<Ready>(std::get<1>(idx_v_pair));
+        };
+
+        // todo: optimize time complexity
+        for(auto &&[proc_idx, proc] :
+            graph.filtered_vertices(is_proc_ready) |
+            graph.template func_get_vertices_as<Ready>())
+        {
+            const auto start = std::max(proc.ready_time, task.ready_time);
+            const auto finish = start + task.exec_time;
+            VertexIndexT successor_idx = -1;
+
+            if(proc.occupied)
+            {
+                const Exec *successor = nullptr;
+                graph.template visit_outgoing_edges<Ready>(
+                    proc_idx,
+                    [&]<typename FromVertex, typename ToVertex>(
+                        VertexIndexT from_idx,
+                        FromVertex &from_v,
+                        VertexIndexT to_idx,
+                        ToVertex &&to_v) {
+                        if constexpr(std::is_same_v<
+                            std::decay_t<ToVertex>, Exec>)
+                        {
+                            successor_idx = to_idx;
+                            successor = &to_v;
+                        }
+                    }
+                );
+                assert(successor);
+                // the task doesn't fit in the idle slot
+                if(finish > successor->ready_time)
+                    continue;
+            }
+
+            if(!best || finish < best->finish_time)
+            {
+                best = Candidate {
+                    .proc_idx = static_cast<VertexIndexT>(proc_idx),
+                    .proc = &proc,
+                    .successor_idx = successor_idx,
+                    .finish_time = finish
+                };
+            }
+        }
+
+        USAGI_ASSERT_THROW(
+            best.has_value(),
+            std::runtime_error("no available processor?")
+        );
+
+        // detach the task after the idle slot from the processor timeline.
+        if(best->proc->occupied)
+        {
+            graph.remove_edge(best->proc_idx, best->successor_idx);
+            best->proc->release();
+            slot_successor = best->successor_idx;
+        }
+
+        return std::tuple<VertexIndexT, Ready &> {
+            best->proc_idx, *best->proc
+        };
+    }
+
+    // relink the detached task after the processor ready node following the
+    // inserted task.
+    template <typename Graph>
+    void on_task_assigned(
+        Graph &&graph,
+        const typename std::decay_t<Graph>::VertexIndexT proc_idx,
+        const typename std::decay_t<Graph>::VertexIndexT task_vertex_idx)
+    {
+        using VertexIndexT = typename std::decay_t<Graph>::VertexIndexT;
+        using TaskIndexT = typename std::decay_t<Graph>::TaskIndexT;
+        using Exec = ScheduleNodeExecuteTask<TaskIndexT>;
+        using Ready = ScheduleNodeProcessorReady;
+
+        if(!slot_successor.has_value())
+            return;
+
+        VertexIndexT next_idx = -1;
+        Ready *next_ready = nullptr;
+        graph.template visit_outgoing_edges<Exec>(
+            task_vertex_idx,
+            [&]<typename FromVertex, typename ToVertex>(
+                VertexIndexT from_idx,
+                FromVertex &from_v,
+                VertexIndexT to_idx,
+                ToVertex &&to_v) {
+                if constexpr(std::is_same_v<std::decay_t<ToVertex>, Ready>)
+                {
+                    next_idx = to_idx;
+                    next_ready = &to_v;
+                }
+            }
+        );
+        assert(next_ready);
+
+        const auto successor_idx =
+            static_cast<VertexIndexT>(slot_successor.value());
+        slot_successor.reset();
+
+        // the inserted task must finish before the detached one starts.
+        assert(next_ready->ready_time <=
+            graph.template vertex<Exec>(successor_idx).ready_time);
+        next_ready->occupy();
+        graph.template add_edge_silently<Ready, Exec>(next_idx, successor_idx);
+    }
+};
+}
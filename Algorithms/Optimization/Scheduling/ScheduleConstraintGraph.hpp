@@ -1,8 +1,10 @@
 ﻿#pragma once
 
+#include <algorithm>
 #include <map>
 #include <variant>
 #include <deque>
+#include <memory_resource>
 #include <cassert>
 
 #include <range/v3/range.hpp>
@@ -17,6 +19,9 @@ namespace usagi
  * \tparam EventHandler The class that handles vertex & edge events. It should
  * inherit this base class as per CRTP idiom.
  * \tparam EnabledNodes Allowed type of vertices.
+ *
+ * The vertices & edges are allocated from the memory resource provided at
+ * construction, so a batch of schedules can be built using arenas.
  */
 template <
     typename VertexIndex,
@@ -29,8 +34,15 @@ struct ScheduleConstraintGraph
     using VertexIndexT = VertexIndex;
 
     // deque is used to keep references valid
-    std::deque<VertexT> vertices;
-    std::multimap<VertexIndexT, VertexIndexT> edges;
+    std::pmr::deque<VertexT> vertices;
+    std::pmr::multimap<VertexIndexT, VertexIndexT> edges;
+
+    explicit ScheduleConstraintGraph(
+        std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+        : vertices(resource)
+        , edges(resource)
+    {
+    }
 
     template <typename Vertex>
     Vertex & vertex(VertexIndexT index)
@@ -68,6 +80,32 @@ struct ScheduleConstraintGraph
         static_cast<EventHandler*>(this)->on_edge_added(from, vf, to, vt);
     }
 
+    // add an edge without notifying the event handler. used when relinking
+    // parts of the graph whose states are already propagated.
+    template <typename VertexFrom, typename VertexTo>
+    void add_edge_silently(const VertexIndexT from, const VertexIndexT to)
+    {
+        // validate the existence of vertices and their types
+        vertex<VertexFrom>(from);
+        vertex<VertexTo>(to);
+        edges.emplace(from, to);
+    }
+
+    // note that the event handler is not notified. the caller is responsible
+    // for keeping the states of the vertices consistent.
+    void remove_edge(const VertexIndexT from, const VertexIndexT to)
+    {
+        const auto [begin, end] = edges.equal_range(from);
+        const auto it = std::find_if(begin, end, [&](auto &&e) {
+            return e.second == to;
+        });
+        USAGI_ASSERT_THROW(
+            it != end,
+            std::runtime_error("removing an edge that does not exist.")
+        );
+        edges.erase(it);
+    }
+
     template <typename FromVertex>
     void visit_outgoing_edges(const VertexIndexT from_idx, auto &&visitor)
     {
@@ -0,0 +1,31 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "TaskRanks.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Prioritize tasks by the sum of their upward & downward ranks as in
+ * CPOP (Topcuoglu et al. 2002), which is the length of the longest path
+ * passing through the task. Tasks on the critical path have the highest
+ * priority.
+ *
+ * Note that only the prioritization phase of CPOP is covered. Dedicating a
+ * processor to the critical path is up to the processor allocation policy.
+ */
+struct TaskPriorityCriticalPath
+{
+    template <typename Graph>
+    std::vector<float> operator()(const Graph &graph)
+    {
+        const auto order = task_topological_order(graph);
+        auto ranks = task_upward_ranks(graph, order);
+        const auto downward = task_downward_ranks(graph, order);
+        for(std::size_t i = 0; i < ranks.size(); ++i)
+            ranks[i] += downward[i];
+        return ranks;
+    }
+};
+}
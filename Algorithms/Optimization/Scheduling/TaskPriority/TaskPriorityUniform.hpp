@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include <vector>
+
+namespace usagi
+{
+/**
+ * \brief All tasks share the same priority. The order of ready tasks is
+ * determined by the task queue implementation.
+ */
+struct TaskPriorityUniform
+{
+    template <typename Graph>
+    std::vector<float> operator()(const Graph &graph)
+    {
+        return std::vector<float>(graph.num_tasks(), 1);
+    }
+};
+}
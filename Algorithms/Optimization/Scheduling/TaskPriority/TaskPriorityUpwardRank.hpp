@@ -0,0 +1,21 @@
+﻿#pragma once
+
+#include <vector>
+
+#include "TaskRanks.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Prioritize tasks by their upward ranks as in HEFT (Topcuoglu et al.
+ * 2002). Tasks further away from the exit task are scheduled earlier.
+ */
+struct TaskPriorityUpwardRank
+{
+    template <typename Graph>
+    std::vector<float> operator()(const Graph &graph)
+    {
+        return task_upward_ranks(graph, task_topological_order(graph));
+    }
+};
+}
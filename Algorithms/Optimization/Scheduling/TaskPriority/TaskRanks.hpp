@@ -0,0 +1,126 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Aspects/Subtasks/SubtaskEnabledSchedule.hpp>
+#include <Usagi/Runtime/ErrorHandling.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Sort the tasks in topological order using Kahn's algorithm.
+ * \tparam Graph The schedule providing `num_tasks` & `descendant_tasks`.
+ * \return Task indices in topological order.
+ */
+template <typename Graph>
+auto task_topological_order(const Graph &graph)
+{
+    using TaskIndexT = typename std::decay_t<Graph>::TaskIndexT;
+
+    const auto num_tasks = graph.num_tasks();
+
+    std::vector<TaskIndexT> in_degrees(num_tasks, 0);
+    for(TaskIndexT i = 0; i < num_tasks; ++i)
+    {
+        for(auto &&out : graph.descendant_tasks(i))
+            ++in_degrees[out];
+    }
+
+    std::vector<TaskIndexT> order;
+    order.reserve(num_tasks);
+    for(TaskIndexT i = 0; i < num_tasks; ++i)
+    {
+        if(in_degrees[i] == 0)
+            order.push_back(i);
+    }
+    // the order vector also serves as the queue of ready tasks.
+    for(std::size_t head = 0; head < order.size(); ++head)
+    {
+        for(auto &&out : graph.descendant_tasks(order[head]))
+        {
+            if(--in_degrees[out] == 0)
+                order.push_back(out);
+        }
+    }
+
+    USAGI_ASSERT_THROW(
+        order.size() == num_tasks,
+        std::runtime_error("the task graph contains cycles.")
+    );
+
+    return order;
+}
+
+/**
+ * \brief The computation cost of a task is the total amount of work of its
+ * subtasks, i.e. its execution time on a single processor. Since the
+ * processors are homogeneous, this is also the average cost used by HEFT.
+ */
+template <typename Graph>
+float task_computation_cost(
+    const Graph &graph,
+    const typename std::decay_t<Graph>::TaskIndexT task)
+    requires SubtaskEnabledSchedule<std::decay_t<Graph>>
+{
+    using TaskIndexT = typename std::decay_t<Graph>::TaskIndexT;
+
+    float cost = 0;
+    for(TaskIndexT j = 0; j < graph.num_subtasks(task); ++j)
+        cost += graph.subtask_exec_time(task, j);
+    return cost;
+}
+
+// Communication costs are not modeled by the constraint graph yet, so they
+// are taken as zero in the rank calculations below.
+
+/**
+ * \brief Upward rank of a task is the length of the critical path from the
+ * task to the exit task, including the cost of the task itself:
+ * rank_u(i) = w(i) + max_{j in succ(i)} rank_u(j)
+ */
+template <typename Graph>
+std::vector<float> task_upward_ranks(
+    const Graph &graph,
+    const std::vector<typename std::decay_t<Graph>::TaskIndexT> &topo_order)
+{
+    std::vector<float> ranks(graph.num_tasks(), 0);
+
+    // visit the tasks in reversed topological order so that the ranks of
+    // all successors are available.
+    for(auto it = topo_order.rbegin(); it != topo_order.rend(); ++it)
+    {
+        float max_succ_rank = 0;
+        for(auto &&out : graph.descendant_tasks(*it))
+            max_succ_rank = std::max(max_succ_rank, ranks[out]);
+        ranks[*it] = task_computation_cost(graph, *it) + max_succ_rank;
+    }
+
+    return ranks;
+}
+
+/**
+ * \brief Downward rank of a task is the length of the longest path from the
+ * entry task to the task, excluding the cost of the task itself:
+ * rank_d(j) = max_{i in pred(j)} (rank_d(i) + w(i))
+ */
+template <typename Graph>
+std::vector<float> task_downward_ranks(
+    const Graph &graph,
+    const std::vector<typename std::decay_t<Graph>::TaskIndexT> &topo_order)
+{
+    std::vector<float> ranks(graph.num_tasks(), 0);
+
+    // push the ranks forward to the successors since the task graph only
+    // gives outgoing edges.
+    for(auto &&task : topo_order)
+    {
+        const auto finish = ranks[task] + task_computation_cost(graph, task);
+        for(auto &&out : graph.descendant_tasks(task))
+            ranks[out] = std::max(ranks[out], finish);
+    }
+
+    return ranks;
+}
+}
@@ -0,0 +1,131 @@
+﻿// Benchmark of list scheduling policies on Standard Task Graph (STG) instances.
+//
+// Usage: ScheduleBenchmarkStg <stg folder> <instance path>...
+//
+// Instance paths are relative to the STG folder, e.g. 50/rand0000.stg. For each
+// instance and each combination of task priority & processor allocation
+// policies, the makespan of the schedule and the median wall time spent on
+// building the schedule are reported as CSV.
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Facades/ScheduleHomogeneousSplittable.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/ProcessorAllocation/ProcessorAllocationEarliestAvailable.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/ProcessorAllocation/ProcessorAllocationInsertionEarliestFinish.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityCriticalPath.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityUniform.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityUpwardRank.hpp>
+#include <Usagi/Modules/Resources/ResTaskGraphs/RbStandardTaskGraph.hpp>
+#include <Usagi/Modules/Runtime/Asset/AssetManager2.hpp>
+#include <Usagi/Modules/Runtime/Asset/Package/AssetPackageFilesystem.hpp>
+#include <Usagi/Modules/Runtime/Executive/TaskExecutorSynchronized.hpp>
+#include <Usagi/Modules/Runtime/HeapManager/HeapManager.hpp>
+
+using namespace usagi;
+
+namespace
+{
+constexpr std::size_t NumRepetitions = 5;
+
+template <typename PriorityPolicy, typename ProcAllocPolicy>
+void run_policy(
+    const std::string &instance,
+    const TaskGraph &task_graph,
+    const char *priority_name,
+    const char *proc_alloc_name)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<double> times;
+    times.reserve(NumRepetitions);
+    float makespan = 0;
+
+    for(std::size_t i = 0; i < NumRepetitions; ++i)
+    {
+        ScheduleHomogeneousSplittable schedule;
+        schedule.task_graph = task_graph;
+
+        const auto begin = Clock::now();
+        schedule.schedule<PriorityPolicy, ProcAllocPolicy>();
+        const auto end = Clock::now();
+
+        times.push_back(
+            std::chrono::duration<double, std::milli>(end - begin).count());
+        makespan = schedule.makespan();
+    }
+
+    std::ranges::nth_element(times, times.begin() + times.size() / 2);
+
+    fmt::print("{},{},{},{},{},{:.4f}\n",
+        instance,
+        task_graph.num_vertices(),
+        priority_name,
+        proc_alloc_name,
+        makespan,
+        times[times.size() / 2]
+    );
+}
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 3)
+    {
+        fmt::print(
+            "Usage: {} <stg folder> <instance path>...\n", argv[0]);
+        return 1;
+    }
+
+    HeapManager heap_manager;
+    heap_manager.add_heap<AssetManager2>()->add_package(
+        std::make_unique<AssetPackageFilesystem>(argv[1]));
+    TaskExecutorSynchronized executor;
+
+    fmt::print("instance,tasks,priority,allocation,makespan,time_ms\n");
+
+    for(int i = 2; i < argc; ++i)
+    {
+        const std::string instance = argv[i];
+
+        const auto task_graph = heap_manager.resource<RbStandardTaskGraph>(
+            { },
+            &executor,
+            [instance] {
+                return std::make_tuple(AssetPath(instance), std::size_t(0));
+            }
+        ).make_request().await();
+
+        run_policy<
+            TaskPriorityUniform,
+            ProcessorAllocationEarliestAvailable
+        >(instance, *task_graph, "uniform", "earliest_available");
+        run_policy<
+            TaskPriorityUpwardRank,
+            ProcessorAllocationEarliestAvailable
+        >(instance, *task_graph, "upward_rank", "earliest_available");
+        run_policy<
+            TaskPriorityCriticalPath,
+            ProcessorAllocationEarliestAvailable
+        >(instance, *task_graph, "critical_path", "earliest_available");
+        run_policy<
+            TaskPriorityUniform,
+            ProcessorAllocationInsertionEarliestFinish
+        >(instance, *task_graph, "uniform", "insertion_eft");
+        run_policy<
+            TaskPriorityUpwardRank,
+            ProcessorAllocationInsertionEarliestFinish
+        >(instance, *task_graph, "upward_rank", "insertion_eft");
+        run_policy<
+            TaskPriorityCriticalPath,
+            ProcessorAllocationInsertionEarliestFinish
+        >(instance, *task_graph, "critical_path", "insertion_eft");
+    }
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+﻿// Benchmark of incremental retiming of schedules built from STG instances.
+//
+// Usage: ScheduleIncrementalStg <stg folder> <instance path>...
+//
+// Each instance is scheduled once. Then the cost of randomly picked tasks is
+// changed and the schedule is updated incrementally. The time spent on a full
+// rebuild is reported together with the median and worst time per update.
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Facades/ScheduleHomogeneousSplittable.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/ProcessorAllocation/ProcessorAllocationInsertionEarliestFinish.hpp>
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/TaskPriority/TaskPriorityUpwardRank.hpp>
+#include <Usagi/Modules/Resources/ResTaskGraphs/RbStandardTaskGraph.hpp>
+#include <Usagi/Modules/Runtime/Asset/AssetManager2.hpp>
+#include <Usagi/Modules/Runtime/Asset/Package/AssetPackageFilesystem.hpp>
+#include <Usagi/Modules/Runtime/Executive/TaskExecutorSynchronized.hpp>
+#include <Usagi/Modules/Runtime/HeapManager/HeapManager.hpp>
+
+using namespace usagi;
+
+namespace
+{
+constexpr std::size_t NumUpdates = 1000;
+
+void run_instance(const std::string &instance, const TaskGraph &task_graph)
+{
+    using Clock = std::chrono::steady_clock;
+
+    ScheduleHomogeneousSplittable schedule;
+    schedule.task_graph = task_graph;
+
+    const auto build_begin = Clock::now();
+    schedule.schedule<
+        TaskPriorityUpwardRank,
+        ProcessorAllocationInsertionEarliestFinish
+    >();
+    const auto build_end = Clock::now();
+    // so that the first update isn't charged for it.
+    schedule.build_timing_index();
+
+    // the dummy entry & exit tasks are left alone.
+    const auto num_tasks = schedule.task_graph.num_vertices();
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<std::size_t> pick_task(1, num_tasks - 2);
+    std::uniform_int_distribution<int> pick_cost(1, 100);
+
+    std::vector<double> times;
+    times.reserve(NumUpdates);
+    for(std::size_t i = 0; i < NumUpdates; ++i)
+    {
+        const auto task = pick_task(rng);
+        schedule.task_graph.vertex(task).base_comp_cost = pick_cost(rng);
+
+        const auto begin = Clock::now();
+        schedule.update_task_exec_time(task);
+        const auto end = Clock::now();
+
+        times.push_back(
+            std::chrono::duration<double, std::milli>(end - begin).count());
+    }
+
+    std::ranges::sort(times);
+
+    fmt::print("{},{},{:.4f},{:.4f},{:.4f}\n",
+        instance,
+        num_tasks,
+        std::chrono::duration<double, std::milli>(
+            build_end - build_begin).count(),
+        times[times.size() / 2],
+        times.back()
+    );
+}
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 3)
+    {
+        fmt::print(
+            "Usage: {} <stg folder> <instance path>...\n", argv[0]);
+        return 1;
+    }
+
+    HeapManager heap_manager;
+    heap_manager.add_heap<AssetManager2>()->add_package(
+        std::make_unique<AssetPackageFilesystem>(argv[1]));
+    TaskExecutorSynchronized executor;
+
+    fmt::print("instance,tasks,rebuild_ms,update_median_ms,update_max_ms\n");
+
+    for(int i = 2; i < argc; ++i)
+    {
+        const std::string instance = argv[i];
+
+        const auto task_graph = heap_manager.resource<RbStandardTaskGraph>(
+            { },
+            &executor,
+            [instance] {
+                return std::make_tuple(AssetPath(instance), std::size_t(0));
+            }
+        ).make_request().await();
+
+        run_instance(instance, *task_graph);
+    }
+
+    return 0;
+}
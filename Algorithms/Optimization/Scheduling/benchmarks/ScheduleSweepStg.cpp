@@ -0,0 +1,99 @@
+﻿// Parameter sweep of ScheduleHomogeneousSplittable over STG instances.
+//
+// Usage: ScheduleSweepStg <stg folder> <output csv> <instance path>...
+//
+// Every instance is scheduled with every configuration in the grid below. The
+// sweep is repeated with increasing number of worker threads to report how the
+// wall time scales with core count. Results of the last run are written to the
+// output CSV.
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Usagi/Modules/Algorithms/Optimization/Scheduling/Batch/ScheduleSweep.hpp>
+#include <Usagi/Modules/Resources/ResTaskGraphs/RbStandardTaskGraph.hpp>
+#include <Usagi/Modules/Runtime/Asset/AssetManager2.hpp>
+#include <Usagi/Modules/Runtime/Asset/Package/AssetPackageFilesystem.hpp>
+#include <Usagi/Modules/Runtime/Executive/TaskExecutorSynchronized.hpp>
+#include <Usagi/Modules/Runtime/HeapManager/HeapManager.hpp>
+
+using namespace usagi;
+
+int main(int argc, char *argv[])
+{
+    if(argc < 4)
+    {
+        fmt::print(
+            "Usage: {} <stg folder> <output csv> <instance path>...\n",
+            argv[0]);
+        return 1;
+    }
+
+    HeapManager heap_manager;
+    heap_manager.add_heap<AssetManager2>()->add_package(
+        std::make_unique<AssetPackageFilesystem>(argv[1]));
+    TaskExecutorSynchronized executor;
+
+    std::vector<std::string> names;
+    std::vector<RefCounted<TaskGraph>> graph_refs;
+    std::vector<const TaskGraph *> graphs;
+    for(int i = 3; i < argc; ++i)
+    {
+        names.emplace_back(argv[i]);
+        graph_refs.push_back(heap_manager.resource<RbStandardTaskGraph>(
+            { },
+            &executor,
+            [instance = names.back()] {
+                return std::make_tuple(AssetPath(instance), std::size_t(0));
+            }
+        ).make_request().await());
+        graphs.push_back(&*graph_refs.back());
+    }
+
+    ScheduleSweepGrid grid;
+    grid.max_subtasks = { 1, 2, 4 };
+    grid.num_processors = { 2, 4, 8, 16 };
+    grid.priorities = {
+        ScheduleSweepPriority::UNIFORM,
+        ScheduleSweepPriority::UPWARD_RANK,
+        ScheduleSweepPriority::CRITICAL_PATH,
+    };
+    grid.allocations = {
+        ScheduleSweepAllocation::EARLIEST_AVAILABLE,
+        ScheduleSweepAllocation::INSERTION_EARLIEST_FINISH,
+    };
+    const auto configs = grid.expand();
+
+    fmt::print("{} graphs x {} configs\n", graphs.size(), configs.size());
+    fmt::print("threads,wall_time_s,speedup\n");
+
+    const auto max_threads = std::max(1u, std::thread::hardware_concurrency());
+    double single_thread_time = 0;
+    std::vector<ScheduleSweepResult> results;
+    for(std::size_t threads = 1; ; threads = std::min<std::size_t>(
+        threads * 2, max_threads))
+    {
+        const auto begin = std::chrono::steady_clock::now();
+        results = run_schedule_sweep(graphs, configs, threads);
+        const auto end = std::chrono::steady_clock::now();
+
+        const auto wall_time =
+            std::chrono::duration<double>(end - begin).count();
+        if(threads == 1) single_thread_time = wall_time;
+        fmt::print("{},{:.4f},{:.2f}\n",
+            threads, wall_time, single_thread_time / wall_time);
+
+        if(threads == max_threads) break;
+    }
+
+    std::ofstream out(argv[2]);
+    write_schedule_sweep_csv(out, names, configs, results);
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <span>
+
+namespace usagi
+{
+/**
+ * \brief Philox4x32-10 counter-based random number generator. Each 128-bit
+ * counter value is mapped to four 32-bit outputs by a keyed bijection, so any
+ * position of the sequence can be computed independently. This makes it easy
+ * to give every (system, entity, update) its own reproducible stream and
+ * to fill large buffers without a sequential dependency.
+ *
+ * The engine satisfies UniformRandomBitGenerator. Only the lowest counter
+ * word is incremented while generating, so one stream gives 2^34 numbers
+ * before it wraps around. The other three words identify the stream.
+ *
+ * Reference: John K. Salmon et al. 2011. Parallel random numbers: as easy as
+ * 1, 2, 3.
+ */
+class Philox4x32
+{
+public:
+    using result_type = std::uint32_t;
+    using CounterT = std::array<std::uint32_t, 4>;
+    using KeyT = std::array<std::uint32_t, 2>;
+
+    constexpr static std::size_t NUM_ROUNDS = 10;
+
+private:
+    constexpr static std::uint32_t M0 = 0xD2511F53;
+    constexpr static std::uint32_t M1 = 0xCD9E8D57;
+    constexpr static std::uint32_t W0 = 0x9E3779B9;
+    constexpr static std::uint32_t W1 = 0xBB67AE85;
+
+    KeyT mKey;
+    CounterT mCounter;
+    CounterT mBuffer { };
+    // number of values in the buffer already consumed.
+    std::uint32_t mBufferPos = 4;
+
+    static void round(CounterT &ctr, const KeyT &key)
+    {
+        const auto p0 = static_cast<std::uint64_t>(M0) * ctr[0];
+        const auto p1 = static_cast<std::uint64_t>(M1) * ctr[2];
+        ctr = {
+            static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0],
+            static_cast<std::uint32_t>(p1),
+            static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1],
+            static_cast<std::uint32_t>(p0)
+        };
+    }
+
+public:
+    Philox4x32(const KeyT key, const CounterT counter = { })
+        : mKey(key)
+        , mCounter(counter)
+    {
+    }
+
+    // the keyed bijection from counter values to random values.
+    static CounterT generate(CounterT ctr, KeyT key)
+    {
+        for(std::size_t i = 0; i < NUM_ROUNDS; ++i)
+        {
+            round(ctr, key);
+            key[0] += W0;
+            key[1] += W1;
+        }
+        return ctr;
+    }
+
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        if(mBufferPos == 4)
+        {
+            mBuffer = generate(mCounter, mKey);
+            ++mCounter[0];
+            mBufferPos = 0;
+        }
+        return mBuffer[mBufferPos++];
+    }
+
+    void discard(unsigned long long n)
+    {
+        for(; n > 0 && mBufferPos < 4; --n)
+            ++mBufferPos;
+        mCounter[0] += static_cast<std::uint32_t>(n / 4);
+        if(const auto rem = n % 4)
+        {
+            (*this)();
+            mBufferPos += static_cast<std::uint32_t>(rem - 1);
+        }
+    }
+
+    /**
+     * \brief Fill the buffer with the same values that successive calls of
+     * operator() would return. Whole blocks are generated several at a time
+     * in a layout that compilers can vectorize.
+     */
+    void fill(std::span<std::uint32_t> out)
+    {
+        auto iter = out.begin();
+
+        // drain the values left from the last block
+        while(mBufferPos < 4 && iter != out.end())
+            *iter++ = mBuffer[mBufferPos++];
+
+        // wider batches make the interleaved stores of the outputs stall
+        // the reads that follow when filling small buffers.
+        constexpr std::size_t LANES = 4;
+        const auto remaining = static_cast<std::size_t>(out.end() - iter);
+        const auto num_batches = remaining / (4 * LANES);
+
+        for(std::size_t b = 0; b < num_batches; ++b)
+        {
+            // structure of arrays: one array per counter word
+            std::uint32_t c0[LANES], c1[LANES], c2[LANES], c3[LANES];
+            for(std::size_t l = 0; l < LANES; ++l)
+            {
+                c0[l] = mCounter[0] + static_cast<std::uint32_t>(l);
+                c1[l] = mCounter[1];
+                c2[l] = mCounter[2];
+                c3[l] = mCounter[3];
+            }
+
+            KeyT key = mKey;
+            for(std::size_t r = 0; r < NUM_ROUNDS; ++r)
+            {
+                for(std::size_t l = 0; l < LANES; ++l)
+                {
+                    const auto p0 = static_cast<std::uint64_t>(M0) * c0[l];
+                    const auto p1 = static_cast<std::uint64_t>(M1) * c2[l];
+                    const auto n0 =
+                        static_cast<std::uint32_t>(p1 >> 32) ^ c1[l] ^ key[0];
+                    const auto n2 =
+                        static_cast<std::uint32_t>(p0 >> 32) ^ c3[l] ^ key[1];
+                    c1[l] = static_cast<std::uint32_t>(p1);
+                    c3[l] = static_cast<std::uint32_t>(p0);
+                    c0[l] = n0;
+                    c2[l] = n2;
+                }
+                key[0] += W0;
+                key[1] += W1;
+            }
+
+            for(std::size_t l = 0; l < LANES; ++l)
+            {
+                *iter++ = c0[l];
+                *iter++ = c1[l];
+                *iter++ = c2[l];
+                *iter++ = c3[l];
+            }
+            mCounter[0] += static_cast<std::uint32_t>(LANES);
+        }
+
+        // the tail goes through the buffer
+        while(iter != out.end())
+            *iter++ = (*this)();
+    }
+
+    // fill with uniformly distributed values in [0, 1).
+    void fill_canonical(std::span<float> out)
+    {
+        std::uint32_t bits[256];
+        while(!out.empty())
+        {
+            const auto n = std::min(out.size(), std::size(bits));
+            fill({ bits, n });
+            // 24 bits fill the mantissa exactly
+            for(std::size_t i = 0; i < n; ++i)
+                out[i] = static_cast<float>(bits[i] >> 8) * 0x1.0p-24f;
+            out = out.subspan(n);
+        }
+    }
+
+    const CounterT & counter() const
+    {
+        return mCounter;
+    }
+
+    const KeyT & key() const
+    {
+        return mKey;
+    }
+};
+}
@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <typeinfo>
+#include <unordered_map>
+
+#include <Usagi/Entity/detail/EntityId.hpp>
+
+#include "Philox4x32.hpp"
+
+namespace usagi
+{
+// SplitMix64 finalizer. Used to derive well-mixed keys from structured ids.
+constexpr std::uint64_t splitmix64(std::uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+    return x ^ (x >> 31);
+}
+
+/**
+ * \brief The random streams of one update of a system. Each stream is a
+ * Philox4x32 engine keyed by the run seed and the system, and positioned by
+ * the entity and the update, so the numbers an entity receives do not depend
+ * on the order or the thread in which entities are processed.
+ */
+class SystemRandomStreams
+{
+    std::uint64_t mKey;
+    std::uint32_t mUpdate;
+
+public:
+    // entity key of streams not bound to a specific entity.
+    constexpr static std::uint64_t SYSTEM_WIDE = -1;
+
+    SystemRandomStreams(const std::uint64_t key, const std::uint32_t update)
+        : mKey(key)
+        , mUpdate(update)
+    {
+    }
+
+    Philox4x32 stream(const std::uint64_t entity_key) const
+    {
+        return Philox4x32(
+            {
+                static_cast<std::uint32_t>(mKey),
+                static_cast<std::uint32_t>(mKey >> 32)
+            },
+            {
+                0,
+                mUpdate,
+                static_cast<std::uint32_t>(entity_key),
+                static_cast<std::uint32_t>(entity_key >> 32)
+            }
+        );
+    }
+
+    Philox4x32 stream(const EntityId entity) const
+    {
+        static_assert(sizeof(EntityId) == sizeof(std::uint64_t));
+        return stream(std::bit_cast<std::uint64_t>(entity));
+    }
+
+    Philox4x32 stream() const
+    {
+        return stream(SYSTEM_WIDE);
+    }
+};
+
+/**
+ * \brief Source of reproducible random streams. A system calls
+ * next_update() once at the beginning of each update and draws all of its
+ * numbers from the returned streams. The service counts the updates of every
+ * system, so each update receives new numbers without anyone having to
+ * advance a counter.
+ */
+class RandomStreams
+{
+    // number of updates handed out to each system so far.
+    std::unordered_map<std::uint64_t, std::uint32_t> mUpdateCounts;
+    std::mutex mMutex;
+
+public:
+    // all streams are derived from the seed. set it to reproduce a run.
+    std::uint64_t seed = 0x5EED'0000'0000'0001;
+
+    // the type hash is stable within a build, which is what reproducing a
+    // run requires.
+    template <typename System>
+    static std::uint64_t system_key()
+    {
+        return typeid(System).hash_code();
+    }
+
+    // the streams of the given update of a system. doesn't advance anything.
+    SystemRandomStreams streams(
+        const std::uint64_t system_key,
+        const std::uint32_t update) const
+    {
+        return {
+            splitmix64(seed ^ splitmix64(system_key)),
+            update
+        };
+    }
+
+    // the streams of the next update of the system. systems running in
+    // parallel may call this concurrently.
+    template <typename System>
+    SystemRandomStreams next_update()
+    {
+        const auto key = system_key<System>();
+        std::uint32_t update;
+        {
+            std::lock_guard lock(mMutex);
+            update = mUpdateCounts[key]++;
+        }
+        return streams(key, update);
+    }
+
+    // start over from the first update of every system, e.g. to replay a run
+    // with the same seed.
+    void reset()
+    {
+        std::lock_guard lock(mMutex);
+        mUpdateCounts.clear();
+    }
+};
+}
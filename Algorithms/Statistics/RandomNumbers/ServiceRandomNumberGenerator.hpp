@@ -1,21 +1,28 @@
 ﻿#pragma once
 
-#include <random>
-
 #include <Usagi/Runtime/Service/ServiceAccess.hpp>
 
+#include "RandomStreams.hpp"
+
 namespace usagi
 {
-struct ServiceThreadLocalRNG
+/*
+ * Systems obtain their random engines from here instead of sharing a
+ * thread-local engine, so that the results are reproducible regardless of
+ * how the systems and entities are scheduled:
+ *
+ *     const auto streams = rt.random_streams().next_update<SystemFoo>();
+ *     auto rng = streams.stream(e.id());
+ */
+struct ServiceRandomStreams
 {
-    using ServiceT = std::mt19937;
+    using ServiceT = RandomStreams;
 
     static ServiceT & get_service()
     {
-        // todo make it determinative?
-        thread_local static std::mt19937 rng { std::random_device{}() };
-        return rng;
+        static RandomStreams streams;
+        return streams;
     }
 };
 }
-USAGI_DECL_SERVICE_ALIAS(usagi::ServiceThreadLocalRNG, thread_rng);
+USAGI_DECL_SERVICE_ALIAS(usagi::ServiceRandomStreams, random_streams);
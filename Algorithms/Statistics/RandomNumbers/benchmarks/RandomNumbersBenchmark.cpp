@@ -0,0 +1,119 @@
+﻿// Benchmark of random number generation.
+//
+// Usage: RandomNumbersBenchmark [count]
+//
+// Compares std::mt19937 with Philox4x32 drawn one by one and in bulk, for raw
+// 32-bit values and for floats in [0, 1). Also checks that the streams handed
+// out by RandomStreams are reproducible and independent of the order in which
+// entities are visited.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Usagi/Modules/Algorithms/Statistics/RandomNumbers/RandomStreams.hpp>
+
+using namespace usagi;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+template <typename Func>
+void measure(const char *name, const std::size_t count, Func &&func)
+{
+    const auto begin = Clock::now();
+    const auto checksum = func();
+    const auto end = Clock::now();
+
+    const auto ms =
+        std::chrono::duration<double, std::milli>(end - begin).count();
+    fmt::print("{},{:.3f},{:.3f},{}\n",
+        name, ms, count / ms / 1e3, checksum);
+}
+
+struct SystemBenchmark { };
+
+// every entity draws a few numbers from its own stream. the results must not
+// depend on the visiting order.
+bool check_order_independence(const SystemRandomStreams &streams)
+{
+    constexpr std::uint64_t NumEntities = 1000;
+
+    std::vector<std::uint32_t> forward(NumEntities), backward(NumEntities);
+    for(std::uint64_t e = 0; e < NumEntities; ++e)
+    {
+        auto rng = streams.stream(e);
+        rng.discard(e % 7);
+        forward[e] = rng();
+    }
+    for(std::uint64_t e = NumEntities; e-- > 0;)
+    {
+        auto rng = streams.stream(e);
+        rng.discard(e % 7);
+        backward[e] = rng();
+    }
+    return forward == backward;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t count = argc > 1 ? std::atoll(argv[1]) : 100000000;
+
+    std::vector<std::uint32_t> bits(count);
+    std::vector<float> floats(count);
+
+    const auto streams = RandomStreams().next_update<SystemBenchmark>();
+
+    fmt::print("count={}\n", count);
+    fmt::print("method,time_ms,million_per_s,checksum\n");
+
+    measure("mt19937", count, [&] {
+        std::mt19937 rng(1);
+        for(auto &&b : bits) b = rng();
+        return bits.back();
+    });
+    measure("philox", count, [&] {
+        auto rng = streams.stream();
+        for(auto &&b : bits) b = rng();
+        return bits.back();
+    });
+    measure("philox_fill", count, [&] {
+        auto rng = streams.stream();
+        rng.fill(bits);
+        return bits.back();
+    });
+    measure("mt19937_canonical", count, [&] {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<float> dist;
+        for(auto &&f : floats) f = dist(rng);
+        return floats.back();
+    });
+    measure("philox_fill_canonical", count, [&] {
+        auto rng = streams.stream();
+        rng.fill_canonical(floats);
+        return floats.back();
+    });
+
+    // the bulk path must give the same sequence as drawing one by one.
+    {
+        auto a = streams.stream();
+        auto b = streams.stream();
+        std::vector<std::uint32_t> filled(1000);
+        a();
+        b();
+        a.fill(filled);
+        const bool same = std::ranges::all_of(filled,
+            [&](const std::uint32_t v) { return v == b(); });
+        fmt::print("fill matches operator(): {}\n", same);
+    }
+    fmt::print("order independent: {}\n", check_order_independence(streams));
+
+    return 0;
+}
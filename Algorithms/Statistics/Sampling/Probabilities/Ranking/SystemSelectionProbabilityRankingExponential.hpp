@@ -1,8 +1,18 @@
 ﻿#pragma once
 
-#include <numbers>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <execution>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
 
 #include <Usagi/Entity/EntityDatabase.hpp>
+#include <Usagi/Entity/detail/EntityId.hpp>
 #include <Usagi/Runtime/Service/ServiceAccess.hpp>
 #include <Usagi/Modules/Common/Indexing/EntityIndexDescriptor.hpp>
 #include <Usagi/Modules/Common/Indexing/ServiceExternalEntityIndex.hpp>
@@ -17,52 +27,153 @@ namespace usagi
  * that worse the fitness has lower the ranking.
  * \tparam TargetProbabilityComponent The component where the probability
  * should be written to. It must has an arithmetic field called `probability`.
+ * \tparam RankScale When 0, the weight of rank r is 1 - e^-r, which is close
+ * to 1 for all but the worst few ranks, so the selection pressure fades as
+ * the population grows. Otherwise the ranks are mapped to (0, RankScale]
+ * first: the weight is 1 - e^-(RankScale * r / n) for n entities. Values
+ * around 1 give the best individual about 1.7 times the average
+ * probability regardless of n; smaller values approach linear ranking.
+ * \tparam ExecutionPolicy Execution policy used to compute the probabilities
+ * and to sort the writes. The probabilities are the same under any policy.
  */
 template <
     typename IndexDescriptor,
-    Component TargetProbabilityComponent
+    Component TargetProbabilityComponent,
+    double RankScale = 0,
+    typename ExecutionPolicy = std::execution::sequenced_policy
 >
 struct SystemSelectionProbabilityRankingExponential
 {
+    static_assert(RankScale >= 0);
+
     using WriteAccess = C<TargetProbabilityComponent>;
-    using ReadAccess = EntityIndexReadAccess<IndexDescriptor>;
+    using ReadAccess = EntityQueryReadAccess<IndexDescriptor>;
 
     using ServiceAccessT = ServiceAccess<
         ServiceExternalEntityIndex<IndexDescriptor>
     >;
 
+    using ProbabilityT = std::remove_cvref_t<
+        decltype(std::declval<TargetProbabilityComponent>().probability)
+    >;
+
+    // 1 - e^-r rounds to 1 in double precision for r >= 38, so only the
+    // first ranks need the exponential function. they are tabulated once.
+    constexpr static std::size_t NUM_TABULATED_RANKS = 40;
+
+    static const std::array<double, NUM_TABULATED_RANKS> & rank_weights()
+    {
+        static const auto weights = [] {
+            std::array<double, NUM_TABULATED_RANKS> w;
+            for(std::size_t i = 0; i < w.size(); ++i)
+                w[i] = 1.0 - std::exp(-static_cast<double>(i + 1));
+            return w;
+        }();
+        return weights;
+    }
+
+    // number of ranks whose weights are summed by one task.
+    constexpr static std::size_t BLOCK_SIZE = 4096;
+
     /**
-     * \brief
-     *   In[28]:= c[n_] = Sum[1 - E^-i, {i, 1, n}] // Simplify
-     *   Out[28]= (1 - E^-n + n - E n)/(1 - E)
-     *   bug: this numerically calculated value may cause the sum of probabilities to deviate a little bit from 1. either divide the probabilities by their accumulation or don't do the normalization? 
-     * \param n Number of candidate parents.
-     * \return Normalizing constant used in exponential probability scaling.
+     * \brief Compute the probabilities of all ranks at once. `out[i]` gets the
+     * weight of rank i + 1 divided by the actual sum of the weights, instead
+     * of the analytic normalizing constant, e.g.
+     * (1 - e^-n + n - e n) / (1 - e), which deviates from the sum by
+     * rounding errors. The weights are summed in fixed blocks, so the result
+     * does not depend on the execution policy.
      */
-    static double normalizing_constant(const std::size_t n)
+    template <typename Policy>
+    void ranking_probabilities(Policy &&policy, std::span<double> out)
     {
-        constexpr auto e = std::numbers::e;
-        const double x = static_cast<double>(n);
-        const double c = (1.0 - std::exp(-x) + x - e * x) / (1.0 - e);
-        assert(c != 0.0);
-        assert(!isnan(c));
-        assert(!isinf(c));
-        return c;
+        const auto n = out.size();
+        const auto num_blocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        if(blocks.size() != num_blocks)
+        {
+            blocks.resize(num_blocks);
+            std::iota(blocks.begin(), blocks.end(), 0);
+        }
+        block_sums.resize(num_blocks);
+
+        const auto &table = rank_weights();
+        const double rank_step = RankScale / static_cast<double>(n);
+
+        std::for_each(policy, blocks.begin(), blocks.end(),
+            [&](const std::size_t b) {
+                const auto begin = b * BLOCK_SIZE;
+                const auto end = std::min(n, begin + BLOCK_SIZE);
+                double sum = 0;
+                for(auto i = begin; i < end; ++i)
+                {
+                    if constexpr(RankScale == 0)
+                        out[i] = i < table.size() ? table[i] : 1.0;
+                    else
+                        out[i] = 1.0 - std::exp(
+                            -rank_step * static_cast<double>(i + 1));
+                    sum += out[i];
+                }
+                block_sums[b] = sum;
+            }
+        );
+
+        const double sum = std::accumulate(
+            block_sums.begin(), block_sums.end(), 0.0);
+        assert(n == 0 || sum > 0.0);
+        const double scale = 1.0 / sum;
+
+        std::for_each(policy, blocks.begin(), blocks.end(),
+            [&](const std::size_t b) {
+                const auto begin = b * BLOCK_SIZE;
+                const auto end = std::min(n, begin + BLOCK_SIZE);
+                for(auto i = begin; i < end; ++i)
+                    out[i] *= scale;
+            }
+        );
     }
 
+    // kept across updates to reuse the memory.
+    std::vector<double> probabilities;
+    std::vector<double> block_sums;
+    // 0, 1, 2... used to distribute the blocks via parallel algorithms.
+    std::vector<std::size_t> blocks;
+    std::vector<std::pair<EntityId, ProbabilityT>> assignments;
+
     void update(ServiceAccessT rt, auto &&db)
     {
+        ExecutionPolicy policy;
+
         auto &index = rt.entity_index(IndexDescriptor());
-        const auto c = normalizing_constant(index.index.size());
 
-        // todo: support multithreading
-        for(std::size_t order = 1; auto &&[sort_key, entity_id] : index.index)
+        probabilities.resize(index.index.size());
+        ranking_probabilities(policy, probabilities);
+
+        assignments.clear();
+        assignments.reserve(probabilities.size());
+        for(std::size_t i = 0; auto &&[sort_key, entity_id] : index.index)
+        {
+            assignments.emplace_back(
+                entity_id,
+                static_cast<ProbabilityT>(probabilities[i++])
+            );
+        }
+
+        // visit the entities in the order of their ids, which groups the
+        // entities of the same page together, instead of the order of the
+        // ranking, which jumps between pages.
+        std::sort(policy, assignments.begin(), assignments.end(),
+            [](auto &&lhs, auto &&rhs) {
+                return std::bit_cast<std::uint64_t>(lhs.first) <
+                    std::bit_cast<std::uint64_t>(rhs.first);
+            }
+        );
+
+        // adding components is not thread-safe. the writes stay serial.
+        for(auto &&[entity_id, probability] : assignments)
         {
             auto view = db.entity(entity_id);
             auto &prob = view.add_component(C<TargetProbabilityComponent>());
-            prob.probability = (1.0 - std::exp(-static_cast<double>(order))) / c;
-            assert(!isnan(prob.probability));
-            ++order;
+            prob.probability = probability;
+            assert(!std::isnan(prob.probability));
         }
     }
 };
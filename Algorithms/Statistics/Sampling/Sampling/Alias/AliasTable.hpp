@@ -0,0 +1,164 @@
+﻿#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <Usagi/Runtime/ErrorHandling.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Alias table for drawing independent samples from a fixed discrete
+ * distribution in O(1) time per draw. The table is built in O(n) time with
+ * Vose's method.
+ *
+ * Usage: clear() the table, push() the values with their weights, build(),
+ * then sample() as many times as needed. The storage is kept between builds
+ * so rebuilding a table of similar size does not allocate.
+ *
+ * Reference: Michael D. Vose. 1991. A linear algorithm for generating random
+ * numbers with a given distribution.
+ * \tparam ProbabilityT The floating point type of the weights.
+ * \tparam ValueT The type of values being sampled.
+ */
+template <std::floating_point ProbabilityT, typename ValueT>
+class AliasTable
+{
+    struct Bin
+    {
+        // probability of keeping the value of this bin instead of taking
+        // the alias. before build(), this is the weight of the value.
+        ProbabilityT threshold;
+        std::uint32_t alias;
+    };
+
+    std::vector<Bin> mBins;
+    std::vector<ValueT> mValues;
+    ProbabilityT mTotalWeight { };
+
+    // worklists used during building
+    std::vector<std::uint32_t> mSmall, mLarge;
+
+public:
+    void clear()
+    {
+        mBins.clear();
+        mValues.clear();
+        mTotalWeight = { };
+    }
+
+    void reserve(const std::size_t size)
+    {
+        mBins.reserve(size);
+        mValues.reserve(size);
+        mSmall.reserve(size);
+        mLarge.reserve(size);
+    }
+
+    // the weight only needs to be non-negative. it does not have to be
+    // normalized.
+    void push(ValueT value, const ProbabilityT weight)
+    {
+        assert(!std::isnan(weight));
+        assert(!std::isinf(weight));
+        assert(weight >= 0);
+
+        mBins.push_back({ weight, 0 });
+        mValues.push_back(std::move(value));
+        mTotalWeight += weight;
+    }
+
+    // throws if there is nothing to sample from, since sample() would read
+    // out of the table.
+    void build()
+    {
+        const auto n = static_cast<std::uint32_t>(mBins.size());
+        USAGI_ASSERT_THROW(
+            n > 0,
+            std::runtime_error("AliasTable: no value to sample from.")
+        );
+        USAGI_ASSERT_THROW(
+            mTotalWeight > 0,
+            std::runtime_error("AliasTable: the total weight is zero.")
+        );
+
+        mSmall.clear();
+        mLarge.clear();
+
+        // scale the weights so that the average is 1.
+        const ProbabilityT scale = n / mTotalWeight;
+        for(std::uint32_t i = 0; i < n; ++i)
+        {
+            auto &bin = mBins[i];
+            bin.threshold *= scale;
+            bin.alias = i;
+            (bin.threshold < 1 ? mSmall : mLarge).push_back(i);
+        }
+
+        // fill each underfull bin with the excess of an overfull one.
+        while(!mSmall.empty() && !mLarge.empty())
+        {
+            const auto s = mSmall.back();
+            mSmall.pop_back();
+            const auto l = mLarge.back();
+
+            mBins[s].alias = l;
+            auto &large = mBins[l].threshold;
+            large = (large + mBins[s].threshold) - 1;
+            if(large < 1)
+            {
+                mLarge.pop_back();
+                mSmall.push_back(l);
+            }
+        }
+
+        // whatever remains is only off from 1 by rounding errors.
+        for(auto &&i : mLarge)
+            mBins[i].threshold = 1;
+        for(auto &&i : mSmall)
+            mBins[i].threshold = 1;
+    }
+
+    std::size_t size() const
+    {
+        return mValues.size();
+    }
+
+    bool empty() const
+    {
+        return mValues.empty();
+    }
+
+    ProbabilityT total_weight() const
+    {
+        return mTotalWeight;
+    }
+
+    // the index of the sampled value. only valid after a successful build().
+    template <typename URBG>
+    std::uint32_t sample_index(URBG &rng) const
+    {
+        assert(!mBins.empty());
+
+        std::uniform_int_distribution<std::uint32_t> pick_bin {
+            0, static_cast<std::uint32_t>(mBins.size() - 1)
+        };
+        std::uniform_real_distribution<ProbabilityT> flip_coin { 0, 1 };
+
+        const auto i = pick_bin(rng);
+        const auto &bin = mBins[i];
+        return flip_coin(rng) < bin.threshold ? i : bin.alias;
+    }
+
+    template <typename URBG>
+    const ValueT & sample(URBG &rng) const
+    {
+        return mValues[sample_index(rng)];
+    }
+};
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <Usagi/Entity/EntityDatabase.hpp>
+#include <Usagi/Entity/detail/EntityId.hpp>
+#include <Usagi/Runtime/Service/ServiceAccess.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/RandomNumbers/ServiceRandomNumberGenerator.hpp>
+#include <Usagi/Modules/Runtime/KeyValueStorage/ServiceRuntimeKeyValueStorage.hpp>
+
+#include "AliasTable.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Pick samples independently with replacement using an alias table
+ * built from the probability distribution. Building the table takes a single
+ * pass over the sample space, after which each sample costs O(1) regardless
+ * of the population size. Unlike stochastic universal sampling, the number of
+ * copies of an entity in the samples is not bounded by its expected value.
+ * \tparam Query The entity query defining the sample space.
+ * \tparam ProbabilityDistribution The component storing the probability
+ * distribution values.
+ * \tparam SampleArchetype The archetype type used to store entity samples.
+ * \tparam SampleIdentity The component storing the EntityId of samples.
+ */
+template <
+    SimpleComponentQuery Query,
+    Component ProbabilityDistribution,
+    typename SampleArchetype,
+    Component SampleIdentity
+>
+requires QueryIncludeComponent<Query, ProbabilityDistribution> &&
+    ArchetypeHasComponent<SampleArchetype, SampleIdentity>
+struct SystemAliasSamplingUnordered
+{
+    using WriteAccess = typename SampleArchetype::ComponentFilterT;
+    using ReadAccess = typename Query::ReadAccess;
+
+    using ServiceAccessT = ServiceAccess<
+        ServiceRuntimeKeyValueStorage,
+        ServiceRandomStreams
+    >;
+
+    using ProbabilityT = std::remove_cvref_t<
+        decltype(std::declval<ProbabilityDistribution>().probability)
+    >;
+
+    SampleArchetype sample_archetype;
+    // kept across updates to reuse the memory.
+    AliasTable<ProbabilityT, EntityId> table;
+
+    void update(ServiceAccessT rt, auto &&db)
+    {
+        const auto target_sample_size =
+            rt.kv_storage().require<std::size_t>("target_sample_size");
+
+        // the probabilities don't have to be normalized.
+        table.clear();
+        for(auto &&e : db.view(Query()))
+        {
+            table.push(
+                e.id(),
+                e(C<ProbabilityDistribution>()).probability
+            );
+        }
+        table.build();
+
+        auto rng = rt.random_streams().next_update<
+            SystemAliasSamplingUnordered>().stream();
+        for(std::size_t i = 0; i < target_sample_size; ++i)
+        {
+            sample_archetype(C<SampleIdentity>()).id = table.sample(rng);
+            db.insert(sample_archetype);
+        }
+    }
+};
+}
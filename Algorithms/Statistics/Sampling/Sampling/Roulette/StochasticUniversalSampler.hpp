@@ -0,0 +1,239 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <concepts>
+#include <execution>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include <Usagi/Runtime/ErrorHandling.hpp>
+
+namespace usagi
+{
+/**
+ * \brief Stochastic universal sampling over a gathered population, evaluated
+ * in fixed-size blocks so that the work can be split among threads.
+ *
+ * The cumulative probability of each individual is defined as the offset of
+ * its block plus the running sum inside the block, and the k-th pointer is
+ * placed at `start + k * interval`. Since neither depends on how the blocks
+ * are distributed to threads, the samples are identical for any execution
+ * policy.
+ *
+ * Usage: clear(), push() the population, accumulate() to get the size of the
+ * wheel, then sample() with a starting position in [0, total / n).
+ * \tparam ProbabilityT The floating point type of the probabilities.
+ * \tparam ValueT The type of values being sampled.
+ */
+template <std::floating_point ProbabilityT, typename ValueT>
+class StochasticUniversalSampler
+{
+public:
+    constexpr static std::size_t BLOCK_SIZE = 4096;
+
+private:
+    std::vector<ValueT> mValues;
+    std::vector<ProbabilityT> mProbabilities;
+    // the cumulative probability before each block, followed by the total.
+    std::vector<ProbabilityT> mBlockOffsets;
+    // the first pointer falling into each block, followed by the number of
+    // pointers.
+    std::vector<std::size_t> mBlockFirstPointers;
+    std::vector<ValueT> mSamples;
+    // 0, 1, 2... used to distribute the blocks via parallel algorithms.
+    std::vector<std::size_t> mBlockIndices;
+
+    ProbabilityT mStart { };
+    ProbabilityT mInterval { };
+    std::size_t mSampleSize = 0;
+
+    std::size_t num_blocks() const
+    {
+        return (mValues.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+    std::size_t block_begin(const std::size_t block) const
+    {
+        return block * BLOCK_SIZE;
+    }
+
+    std::size_t block_end(const std::size_t block) const
+    {
+        return std::min(mValues.size(), (block + 1) * BLOCK_SIZE);
+    }
+
+    ProbabilityT pointer(const std::size_t k) const
+    {
+        return mStart + static_cast<ProbabilityT>(k) * mInterval;
+    }
+
+    // the number of pointers placed before the position.
+    std::size_t count_pointers_before(const ProbabilityT position) const
+    {
+        // estimate, then correct the rounding errors by comparing with the
+        // exact pointer positions.
+        const auto estimate = std::ceil((position - mStart) / mInterval);
+        auto k = static_cast<std::size_t>(std::clamp<ProbabilityT>(
+            estimate, 0, static_cast<ProbabilityT>(mSampleSize)));
+        while(k > 0 && pointer(k - 1) >= position) --k;
+        while(k < mSampleSize && pointer(k) < position) ++k;
+        return k;
+    }
+
+    const std::vector<std::size_t> & block_indices()
+    {
+        const auto old_size = mBlockIndices.size();
+        if(old_size != num_blocks())
+        {
+            mBlockIndices.resize(num_blocks());
+            if(mBlockIndices.size() > old_size)
+                std::iota(
+                    mBlockIndices.begin() + old_size,
+                    mBlockIndices.end(),
+                    old_size
+                );
+        }
+        return mBlockIndices;
+    }
+
+public:
+    void clear()
+    {
+        mValues.clear();
+        mProbabilities.clear();
+    }
+
+    void reserve(const std::size_t size)
+    {
+        mValues.reserve(size);
+        mProbabilities.reserve(size);
+    }
+
+    // the probability only needs to be non-negative. it does not have to be
+    // normalized.
+    void push(ValueT value, const ProbabilityT probability)
+    {
+        assert(!std::isnan(probability));
+        assert(!std::isinf(probability));
+        assert(probability >= 0);
+
+        mValues.push_back(std::move(value));
+        mProbabilities.push_back(probability);
+    }
+
+    std::size_t size() const
+    {
+        return mValues.size();
+    }
+
+    /**
+     * \brief Compute the block offsets of the cumulative probability
+     * distribution.
+     * \return The total of the probabilities, i.e. the size of the wheel.
+     */
+    template <typename ExecutionPolicy>
+    ProbabilityT accumulate(ExecutionPolicy &&policy)
+    {
+        const auto &blocks = block_indices();
+        mBlockOffsets.resize(num_blocks() + 1);
+
+        // sum of each block, stored one slot later to be turned into
+        // exclusive prefix sums.
+        std::for_each(policy, blocks.begin(), blocks.end(),
+            [&](const std::size_t b) {
+                ProbabilityT sum { };
+                for(auto i = block_begin(b); i < block_end(b); ++i)
+                    sum += mProbabilities[i];
+                mBlockOffsets[b + 1] = sum;
+            }
+        );
+
+        // there are few blocks. scan them serially.
+        mBlockOffsets[0] = { };
+        for(std::size_t b = 1; b < mBlockOffsets.size(); ++b)
+            mBlockOffsets[b] += mBlockOffsets[b - 1];
+
+        return mBlockOffsets.back();
+    }
+
+    /**
+     * \brief Place the pointers on the wheel and collect the individuals under
+     * them. accumulate() must be called after the last push().
+     * \param start Position of the first pointer. Should be in
+     * [0, total / sample_size).
+     * \param sample_size Number of pointers.
+     * \return The samples, ordered by the positions of their pointers. The
+     * storage is reused by the next call. Empty if sample_size is zero.
+     * \throw std::runtime_error If the population is empty or the total
+     * probability is zero.
+     */
+    template <typename ExecutionPolicy>
+    std::span<const ValueT> sample(
+        ExecutionPolicy &&policy,
+        const ProbabilityT start,
+        const std::size_t sample_size)
+    {
+        assert(mBlockOffsets.size() == num_blocks() + 1);
+
+        // otherwise every pointer would fall past the end of the wheel and
+        // pick a value that doesn't exist.
+        USAGI_ASSERT_THROW(
+            !mValues.empty(),
+            std::runtime_error(
+                "StochasticUniversalSampler: no value to sample from.")
+        );
+        USAGI_ASSERT_THROW(
+            mBlockOffsets.back() > 0,
+            std::runtime_error(
+                "StochasticUniversalSampler: the total probability is zero.")
+        );
+
+        mSampleSize = sample_size;
+        mSamples.resize(sample_size);
+        if(sample_size == 0) return mSamples;
+
+
+        mStart = start;
+        mInterval = mBlockOffsets.back() / sample_size;
+
+        const auto &blocks = block_indices();
+
+        // find the range of pointers falling into each block
+        mBlockFirstPointers.resize(num_blocks() + 1);
+        std::for_each(policy, blocks.begin(), blocks.end(),
+            [&](const std::size_t b) {
+                mBlockFirstPointers[b] = count_pointers_before(
+                    mBlockOffsets[b]);
+            }
+        );
+        mBlockFirstPointers.back() = sample_size;
+
+        // each block writes the disjoint range of samples of its pointers
+        std::for_each(policy, blocks.begin(), blocks.end(),
+            [&](const std::size_t b) {
+                auto k = mBlockFirstPointers[b];
+                const auto k_end = mBlockFirstPointers[b + 1];
+                const auto offset = mBlockOffsets[b];
+                ProbabilityT local_p { };
+                for(auto i = block_begin(b); i < block_end(b); ++i)
+                {
+                    local_p += mProbabilities[i];
+                    const auto accumulated_p = offset + local_p;
+                    while(k < k_end && pointer(k) < accumulated_p)
+                        mSamples[k++] = mValues[i];
+                }
+                // only the last block may have pointers left, when rounding
+                // errors put them past the end of the wheel.
+                for(; k < k_end; ++k)
+                    mSamples[k] = mValues[block_end(b) - 1];
+            }
+        );
+
+        return mSamples;
+    }
+};
+}
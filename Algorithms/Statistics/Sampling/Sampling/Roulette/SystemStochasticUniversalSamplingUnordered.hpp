@@ -1,12 +1,16 @@
 ﻿#pragma once
 
-#include <range/v3/numeric/accumulate.hpp>
+#include <algorithm>
+#include <execution>
 
 #include <Usagi/Entity/EntityDatabase.hpp>
+#include <Usagi/Entity/detail/EntityId.hpp>
 #include <Usagi/Runtime/Service/ServiceAccess.hpp>
 #include <Usagi/Modules/Algorithms/Statistics/RandomNumbers/ServiceRandomNumberGenerator.hpp>
 #include <Usagi/Modules/Runtime/KeyValueStorage/ServiceRuntimeKeyValueStorage.hpp>
 
+#include "StochasticUniversalSampler.hpp"
+
 namespace usagi
 {
 /**
@@ -16,12 +20,16 @@ namespace usagi
  * distribution values.
  * \tparam SampleArchetype The archetype type used to store entity samples.
  * \tparam SampleIdentity The component storing the EntityId of samples.
+ * \tparam ExecutionPolicy Execution policy used to evaluate the wheel, e.g.
+ * std::execution::parallel_policy for large populations. The samples are the
+ * same under any policy for the same random seed.
  */
 template <
     SimpleComponentQuery Query,
     Component ProbabilityDistribution,
     typename SampleArchetype,
-    Component SampleIdentity
+    Component SampleIdentity,
+    typename ExecutionPolicy = std::execution::sequenced_policy
 >
 requires QueryIncludeComponent<Query, ProbabilityDistribution> &&
     ArchetypeHasComponent<SampleArchetype, SampleIdentity>
@@ -32,19 +40,30 @@ struct SystemStochasticUniversalSamplingUnordered
 
     using ServiceAccessT = ServiceAccess<
         ServiceRuntimeKeyValueStorage,
-        ServiceThreadLocalRNG
+        ServiceRandomStreams
+    >;
+
+    using ProbabilityT = std::remove_cvref_t<
+        decltype(std::declval<ProbabilityDistribution>().probability)
+    >;
+
+    // the random stream does not depend on the execution policy.
+    using RandomStreamKey = SystemStochasticUniversalSamplingUnordered<
+        Query,
+        ProbabilityDistribution,
+        SampleArchetype,
+        SampleIdentity
     >;
 
     SampleArchetype sample_archetype;
+    // kept across updates to reuse the memory.
+    StochasticUniversalSampler<ProbabilityT, EntityId> sampler;
 
     void update(ServiceAccessT rt, auto &&db)
     {
         const auto target_sample_size =
             rt.kv_storage().require<std::size_t>("target_sample_size");
-
-        using ProbabilityT = std::remove_cvref_t<
-            decltype(std::declval<ProbabilityDistribution>().probability)
-        >;
+        if(target_sample_size == 0) return;
 
         // Introduction to Evolutionary Computing p.84
         //
@@ -56,29 +75,28 @@ struct SystemStochasticUniversalSamplingUnordered
         //     OD
         //     set i = i + 1;
         // OD
+        //
+        // the wheel is evaluated in blocks by StochasticUniversalSampler so
+        // that it can be parallelized. see there for details.
+
+        // gather the sample space
+        sampler.clear();
+        for(auto &&e : db.view(Query()))
+        {
+            sampler.push(
+                e.id(),
+                e(C<ProbabilityDistribution>()).probability
+            );
+        }
 
         // calculate spin wheel size
         // i.e. the integral of probability density function
         // or say the max value of cumulative probability distribution
         // this impl only requires that all p are non-negative. it does not
         // require that the sum of PDF to be 1.
-        const ProbabilityT cpd_max =
-            ranges::accumulate(
-                db.view(Query()), ProbabilityT { }, ranges::plus(), 
-                [](auto &&e) {
-                    const auto p = e(C<ProbabilityDistribution>()).probability;
-                    assert(!isnan(p));
-                    assert(!isinf(p));
-                    assert(p >= 0);
-                    return p;
-                }
-            );
+        const ProbabilityT cpd_max = sampler.accumulate(ExecutionPolicy());
 
         // todo normalized probabilities cause precision issues
-        // todo: can the pointer finally go past the end of the wheel?
-        // since std::uniform_real_distribution generates samples on a
-        // [,) range, so in principle multiple added samples won't get to
-        // cpd_max;
 
         const ProbabilityT pointer_interval = cpd_max / target_sample_size;
         ProbabilityT pointer_position;
@@ -90,40 +108,25 @@ struct SystemStochasticUniversalSamplingUnordered
                 0, pointer_interval
             };
             // and use it to set the starting pointer position randomly
-            pointer_position = dist(rt.thread_rng());
+            auto rng = rt.random_streams().next_update<
+                RandomStreamKey>().stream();
+            pointer_position = dist(rng);
         }
 
-        // group of entities to draw samples from
-        auto range = db.view(Query());
-        // value of cumulative probability distribution wrt positions in the
-        // entity range
-        ProbabilityT accumulated_p { };
-        // number of sample drawn up to now
-        std::size_t current_sample_size = 0;
-
-        // iterate over the sample space of candidate individuals
-        // note that one individual might be chosen as parent for multiple times
-        for(auto iter = range.begin(); iter != range.end(); ++iter)
+        const auto samples = sampler.sample(
+            ExecutionPolicy(), pointer_position, target_sample_size);
+
+        // the database is not thread-safe. insert the samples afterwards in
+        // one pass. copies of the same individual are adjacent, so the
+        // archetype only needs to be updated once for each of them.
+        for(auto run = samples.begin(); run != samples.end();)
         {
-            auto entity = *iter;
-
-            // update cumulative selection probability to the current
-            // individual
-            accumulated_p += entity(C<ProbabilityDistribution>()).probability;
-
-            // compare the pointer position against CPD value. add the current
-            // individual to the samples until that the pointer position
-            // go pasts the current CPD value, in which case move on to the
-            // next individual.
-            while(pointer_position < accumulated_p)
-            {
-                sample_archetype(C<SampleIdentity>()).id = entity.id();
+            const auto run_end = std::find_if(run, samples.end(),
+                [&](const EntityId &id) { return id != *run; });
+            sample_archetype(C<SampleIdentity>()).id = *run;
+            for(; run != run_end; ++run)
                 db.insert(sample_archetype);
-                ++current_sample_size;
-                pointer_position += pointer_interval;
-            }
         }
-        assert(current_sample_size == target_sample_size);
     }
 };
 }
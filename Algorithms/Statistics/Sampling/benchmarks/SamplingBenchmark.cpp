@@ -0,0 +1,223 @@
+﻿// Benchmark of weighted sampling with replacement.
+//
+// Usage: SamplingBenchmark [population size] [sample size]
+//
+// Compares the alias method against stochastic universal sampling and roulette
+// wheel sampling on a plain array of random weights, so the cost of entity
+// iteration is excluded. Building & sampling times are reported separately as
+// the median of several runs. The blocked SUS is run both serially and in
+// parallel and the samples are checked to be identical.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <execution>
+#include <random>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Usagi/Modules/Algorithms/Statistics/Sampling/Sampling/Alias/AliasTable.hpp>
+#include <Usagi/Modules/Algorithms/Statistics/Sampling/Sampling/Roulette/StochasticUniversalSampler.hpp>
+
+using namespace usagi;
+
+namespace
+{
+constexpr std::size_t NumRepetitions = 5;
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ms(const Clock::time_point begin, const Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+double median(std::vector<double> &times)
+{
+    std::ranges::nth_element(times, times.begin() + times.size() / 2);
+    return times[times.size() / 2];
+}
+
+// keeps the samples alive so they are not optimized away.
+std::size_t gChecksum = 0;
+
+void report(const char *method, std::vector<double> &build_times,
+    std::vector<double> &sample_times)
+{
+    const auto build = median(build_times);
+    const auto sample = median(sample_times);
+    fmt::print("{},{:.3f},{:.3f},{:.3f}\n",
+        method, build, sample, build + sample);
+}
+
+void bench_alias(const std::vector<float> &weights, const std::size_t samples)
+{
+    std::vector<double> build_times, sample_times;
+    std::vector<std::uint32_t> out(samples);
+    AliasTable<float, std::uint32_t> table;
+    std::mt19937 rng(1);
+
+    for(std::size_t r = 0; r < NumRepetitions; ++r)
+    {
+        const auto t0 = Clock::now();
+        table.clear();
+        for(std::uint32_t i = 0; i < weights.size(); ++i)
+            table.push(i, weights[i]);
+        table.build();
+        const auto t1 = Clock::now();
+        for(auto &&o : out)
+            o = table.sample_index(rng);
+        const auto t2 = Clock::now();
+
+        build_times.push_back(elapsed_ms(t0, t1));
+        sample_times.push_back(elapsed_ms(t1, t2));
+        gChecksum += out.back();
+    }
+
+    report("alias", build_times, sample_times);
+}
+
+// same algorithm as SystemStochasticUniversalSamplingUnordered.
+void bench_sus(const std::vector<float> &weights, const std::size_t samples)
+{
+    std::vector<double> build_times, sample_times;
+    std::vector<std::uint32_t> out(samples);
+    std::mt19937 rng(1);
+
+    for(std::size_t r = 0; r < NumRepetitions; ++r)
+    {
+        const auto t0 = Clock::now();
+        float cpd_max = 0;
+        for(auto &&w : weights)
+            cpd_max += w;
+        const auto t1 = Clock::now();
+
+        const float pointer_interval = cpd_max / samples;
+        float pointer_position =
+            std::uniform_real_distribution<float>(0, pointer_interval)(rng);
+        float accumulated_p = 0;
+        std::size_t current = 0;
+        for(std::uint32_t i = 0; i < weights.size(); ++i)
+        {
+            accumulated_p += weights[i];
+            while(pointer_position < accumulated_p && current < samples)
+            {
+                out[current++] = i;
+                pointer_position += pointer_interval;
+            }
+        }
+        const auto t2 = Clock::now();
+
+        build_times.push_back(elapsed_ms(t0, t1));
+        sample_times.push_back(elapsed_ms(t1, t2));
+        gChecksum += out[current - 1];
+    }
+
+    report("sus", build_times, sample_times);
+}
+
+// the implementation used by SystemStochasticUniversalSamplingUnordered.
+template <typename ExecutionPolicy>
+std::vector<std::uint32_t> bench_sus_blocked(
+    const char *method,
+    ExecutionPolicy policy,
+    const std::vector<float> &weights,
+    const std::size_t samples)
+{
+    std::vector<double> build_times, sample_times;
+    std::vector<std::uint32_t> out;
+    StochasticUniversalSampler<float, std::uint32_t> sampler;
+    std::mt19937 rng(1);
+
+    for(std::size_t r = 0; r < NumRepetitions; ++r)
+    {
+        const auto t0 = Clock::now();
+        sampler.clear();
+        for(std::uint32_t i = 0; i < weights.size(); ++i)
+            sampler.push(i, weights[i]);
+        const auto cpd_max = sampler.accumulate(policy);
+        const auto t1 = Clock::now();
+
+        // reseed so that each run gives the same samples.
+        rng.seed(1);
+        const auto start = std::uniform_real_distribution<float>(
+            0, cpd_max / samples)(rng);
+        const auto result = sampler.sample(policy, start, samples);
+        const auto t2 = Clock::now();
+
+        build_times.push_back(elapsed_ms(t0, t1));
+        sample_times.push_back(elapsed_ms(t1, t2));
+        out.assign(result.begin(), result.end());
+        gChecksum += out.back();
+    }
+
+    report(method, build_times, sample_times);
+
+    return out;
+}
+
+// independent spins of the wheel, each located by binary search over the
+// cumulative distribution.
+void bench_roulette(
+    const std::vector<float> &weights,
+    const std::size_t samples)
+{
+    std::vector<double> build_times, sample_times;
+    std::vector<std::uint32_t> out(samples);
+    std::vector<double> cpd(weights.size());
+    std::mt19937 rng(1);
+
+    for(std::size_t r = 0; r < NumRepetitions; ++r)
+    {
+        const auto t0 = Clock::now();
+        double accumulated_p = 0;
+        for(std::size_t i = 0; i < weights.size(); ++i)
+            cpd[i] = accumulated_p += weights[i];
+        const auto t1 = Clock::now();
+
+        std::uniform_real_distribution<double> spin(0, accumulated_p);
+        for(auto &&o : out)
+        {
+            const auto it = std::ranges::upper_bound(cpd, spin(rng));
+            o = static_cast<std::uint32_t>(std::min<std::size_t>(
+                it - cpd.begin(), cpd.size() - 1));
+        }
+        const auto t2 = Clock::now();
+
+        build_times.push_back(elapsed_ms(t0, t1));
+        sample_times.push_back(elapsed_ms(t1, t2));
+        gChecksum += out.back();
+    }
+
+    report("roulette", build_times, sample_times);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t population = argc > 1 ? std::atoll(argv[1]) : 1000000;
+    const std::size_t samples = argc > 2 ? std::atoll(argv[2]) : population;
+
+    std::vector<float> weights(population);
+    std::mt19937 rng(0);
+    std::exponential_distribution<float> dist;
+    for(auto &&w : weights)
+        w = dist(rng);
+
+    fmt::print("population={} samples={}\n", population, samples);
+    fmt::print("method,build_ms,sample_ms,total_ms\n");
+
+    bench_alias(weights, samples);
+    bench_sus(weights, samples);
+    const auto seq = bench_sus_blocked(
+        "sus_blocked_seq", std::execution::seq, weights, samples);
+    const auto par = bench_sus_blocked(
+        "sus_blocked_par", std::execution::par, weights, samples);
+    bench_roulette(weights, samples);
+
+    fmt::print("checksum={}\n", gChecksum);
+    fmt::print("blocked sus seq == par: {}\n", seq == par);
+
+    return 0;
+}
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <any>
+#include <execution>
+#include <iterator>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace usagi
+{
+namespace detail
+{
+template <typename ExecutionPolicy>
+constexpr bool IsSequencedPolicy = std::is_same_v<
+    std::remove_cvref_t<ExecutionPolicy>,
+    std::execution::sequenced_policy
+>;
+}
+
+// number of entities handed to a worker at once. large enough to amortize the
+// scheduling, small enough to balance the load of 32 cores with 10^5 entities.
+constexpr std::size_t ENTITY_BLOCK_SIZE = 512;
+
+/**
+ * \brief Storage reused by for_each_entity_block() across updates. Keep one
+ * as a member of the system so that the parallel path doesn't allocate once
+ * the buffers have grown to the size of the view. The type of the entity views
+ * is only known when visiting, so the gathered views are kept type-erased.
+ */
+class EntityBlockBuffers
+{
+    std::any mEntities;
+    std::vector<std::size_t> mBlocks;
+
+public:
+    // the gathered entity views, emptied but keeping their capacity.
+    template <typename EntityViewT>
+    std::vector<EntityViewT> & entities()
+    {
+        using VectorT = std::vector<EntityViewT>;
+        auto *entities = std::any_cast<VectorT>(&mEntities);
+        if(!entities) entities = &mEntities.emplace<VectorT>();
+        entities->clear();
+        return *entities;
+    }
+
+    // the indices of `num_blocks` blocks.
+    std::span<const std::size_t> blocks(const std::size_t num_blocks)
+    {
+        if(mBlocks.size() < num_blocks)
+        {
+            mBlocks.reserve(num_blocks);
+            while(mBlocks.size() < num_blocks)
+                mBlocks.push_back(mBlocks.size());
+        }
+        return std::span(mBlocks).first(num_blocks);
+    }
+};
+
+/**
+ * \brief Process the entities of a database view in blocks under the execution
+ * policy. `func` is called with a range of entity views and is responsible
+ * for creating its own per-block state, such as visitor instances or random
+ * streams, so that no state is shared between workers.
+ *
+ * With the sequenced policy the view is passed to `func` directly. Otherwise
+ * the entity views are gathered into `buffers` first, because the database
+ * view cannot be split, and the blocks are distributed via std::for_each.
+ * Only the components of the visited entities may be accessed in parallel.
+ * Adding or removing components or entities is not thread-safe.
+ */
+template <typename ExecutionPolicy, typename View, typename Func>
+void for_each_entity_block(
+    ExecutionPolicy &&policy,
+    View &&view,
+    EntityBlockBuffers &buffers,
+    Func &&func,
+    const std::size_t block_size = ENTITY_BLOCK_SIZE)
+{
+    if constexpr(detail::IsSequencedPolicy<ExecutionPolicy>)
+    {
+        func(view);
+    }
+    else
+    {
+        using std::begin;
+        using EntityViewT = std::remove_cvref_t<decltype(*begin(view))>;
+
+        auto &entities = buffers.entities<EntityViewT>();
+        for(auto &&e : view)
+            entities.push_back(e);
+
+        const auto blocks = buffers.blocks(
+            (entities.size() + block_size - 1) / block_size);
+
+        std::for_each(policy, blocks.begin(), blocks.end(),
+            [&](const std::size_t b) {
+                const auto first = b * block_size;
+                func(std::span<EntityViewT>(entities).subspan(
+                    first, std::min(block_size, entities.size() - first)));
+            }
+        );
+    }
+}
+}
@@ -1,8 +1,14 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <execution>
+
 #include <Usagi/Entity/EntityDatabase.hpp>
 #include <Usagi/Runtime/Service/ServiceAccess.hpp>
 
+#include "ForEachEntityBlock.hpp"
+
 namespace usagi
 {
 /**
@@ -12,12 +18,15 @@ namespace usagi
  * \tparam Visitor The callable that will be applied to visited entities.
  * It must accept the entity view and the sorted key defined by the index
  * descriptor as arguments.
- *
- * todo: thread safety
+ * \tparam ExecutionPolicy Execution policy used to visit the entities. Under
+ * a parallel policy, the entities are visited in blocks and each block gets
+ * its own Visitor instance, so the visitor must not rely on seeing all the
+ * entities, nor add or remove components.
  */
 template <
     SimpleComponentQuery Query,
-    typename Visitor
+    typename Visitor,
+    typename ExecutionPolicy = std::execution::sequenced_policy
 >
 struct SystemVisitEntities
 {
@@ -27,15 +36,29 @@ struct SystemVisitEntities
     // declare access to entity index
     using ServiceAccessT = ServiceAccess<>;
 
+    // number of entities visited by the last update, for profiling.
+    std::uint64_t entities_visited = 0;
+    EntityBlockBuffers block_buffers;
+
     void update(ServiceAccessT rt, auto &&db)
     {
-        Visitor visitor;
+        ExecutionPolicy policy;
+
+        auto view = db.view(Query());
 
-        // todo: multithreading
-        for(auto &&entity_view : db.view(Query()))
-        {
-            visitor(entity_view);
-        }
+        std::uint64_t count = 0;
+        for_each_entity_block(policy, view, block_buffers, [&](auto &&block) {
+            Visitor visitor;
+            std::uint64_t visited = 0;
+            for(auto &&entity_view : block)
+            {
+                visitor(entity_view);
+                ++visited;
+            }
+            std::atomic_ref(count).fetch_add(
+                visited, std::memory_order_relaxed);
+        });
+        entities_visited = count;
     }
 };
 }
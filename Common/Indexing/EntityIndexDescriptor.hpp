@@ -17,7 +17,12 @@ namespace usagi
  * by the comparator.
  * \tparam Comparator The comparator which gives a total order of the projected
  * values.
- * \tparam SortedValueContainer The container used to store the 
+ * \tparam OrderedContainer The container used to store the sorted keys and
+ * the entity ids. Use FlatSortedMap for indices rebuilt every frame to avoid
+ * per-element allocations.
+ * \tparam ContainerArgs Extra template arguments of OrderedContainer after
+ * the comparator, e.g. the execution policy used by FlatSortedMap to sort:
+ * `FlatSortedMap, std::execution::parallel_policy`.
  */
 template <
     SimpleComponentQuery Query,
@@ -26,7 +31,8 @@ template <
     template <typename Key>
     typename Comparator,
     template <typename Key, typename Value, typename Comp, typename...>
-    typename OrderedContainer = std::map
+    typename OrderedContainer = std::map,
+    typename... ContainerArgs
 >
 // requires
 //     /*std::totally_ordered_with<Projection, Comparator<
@@ -46,7 +52,8 @@ struct EntityIndexDescriptor
     using SortedKeyContainer = OrderedContainer<
         ProjectedKey,
         EntityId,
-        Comparator<ProjectedKey>
+        Comparator<ProjectedKey>,
+        ContainerArgs...
     >;
 
     // note that in order to use aggregates the ProjectedKey must be
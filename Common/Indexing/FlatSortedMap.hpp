@@ -0,0 +1,180 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <execution>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace usagi
+{
+/**
+ * \brief An ordered key-value container stored in a flat vector, meant to be
+ * used as the OrderedContainer of EntityIndexDescriptor for indices that are
+ * rebuilt from scratch frequently.
+ *
+ * Instead of placing each element on insertion, elements are appended by
+ * emplace() and ordered all at once by sort(), which must be called before
+ * the container is iterated. clear() keeps the capacity so rebuilding an
+ * index of the same size does not allocate.
+ *
+ * Same as std::map, the keys must be unique and the elements are visited in
+ * ascending order under the comparator as std::pair<Key, Value>.
+ * \tparam ExecutionPolicy Execution policy used for sorting. Note that the
+ * parallel sorts of some standard libraries allocate temporary buffers.
+ */
+template <
+    typename Key,
+    typename Value,
+    typename Comp = std::less<Key>,
+    typename ExecutionPolicy = std::execution::sequenced_policy
+>
+class FlatSortedMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using key_compare = Comp;
+    using size_type = std::size_t;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+    using iterator = const_iterator;
+
+private:
+    std::vector<value_type> mElements;
+    std::vector<value_type> mMergeBuffer;
+    bool mSorted = true;
+
+public:
+    void clear()
+    {
+        mElements.clear();
+        mSorted = true;
+    }
+
+    void reserve(const size_type size)
+    {
+        mElements.reserve(size);
+    }
+
+    // unlike std::map, the uniqueness of the key is only checked by sort()
+    // in debug builds.
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args &&... args)
+    {
+        mElements.emplace_back(std::forward<Args>(args)...);
+        mSorted = false;
+        return { std::prev(mElements.cend()), true };
+    }
+
+    void sort()
+    {
+        if(mSorted) return;
+
+        ExecutionPolicy policy;
+        std::sort(
+            policy,
+            mElements.begin(), mElements.end(),
+            [](const value_type &lhs, const value_type &rhs) {
+                return Comp()(lhs.first, rhs.first);
+            }
+        );
+
+        assert(std::adjacent_find(
+            mElements.begin(), mElements.end(),
+            [](const value_type &lhs, const value_type &rhs) {
+                return !Comp()(lhs.first, rhs.first);
+            }
+        ) == mElements.end() && "duplicated index key?");
+
+        mSorted = true;
+    }
+
+    /**
+     * \brief Erase the elements with the given keys and insert new elements
+     * in a single merging pass. The memory used by the merge is kept for the
+     * next call. The arguments are sorted in place.
+     */
+    void apply_changes(
+        std::span<Key> erased_keys,
+        std::span<value_type> inserted)
+    {
+        assert(mSorted);
+
+        const auto key_comp = [](const value_type &lhs, const value_type &rhs) {
+            return Comp()(lhs.first, rhs.first);
+        };
+        std::sort(erased_keys.begin(), erased_keys.end(), Comp());
+        std::sort(inserted.begin(), inserted.end(), key_comp);
+
+        mMergeBuffer.clear();
+        mMergeBuffer.reserve(
+            mElements.size() - erased_keys.size() + inserted.size());
+
+        auto erased_iter = erased_keys.begin();
+        auto inserted_iter = inserted.begin();
+        for(auto &&e : mElements)
+        {
+            // skip erased keys
+            while(erased_iter != erased_keys.end() &&
+                Comp()(*erased_iter, e.first))
+                ++erased_iter;
+            if(erased_iter != erased_keys.end() &&
+                !Comp()(e.first, *erased_iter))
+            {
+                ++erased_iter;
+                continue;
+            }
+            while(inserted_iter != inserted.end() &&
+                key_comp(*inserted_iter, e))
+                mMergeBuffer.push_back(*inserted_iter++);
+            mMergeBuffer.push_back(e);
+        }
+        mMergeBuffer.insert(mMergeBuffer.end(), inserted_iter, inserted.end());
+        assert(erased_iter == erased_keys.end() && "erasing absent key?");
+
+        std::swap(mElements, mMergeBuffer);
+
+        assert(std::adjacent_find(
+            mElements.begin(), mElements.end(),
+            [](const value_type &lhs, const value_type &rhs) {
+                return !Comp()(lhs.first, rhs.first);
+            }
+        ) == mElements.end() && "duplicated index key?");
+    }
+
+    bool sorted() const
+    {
+        return mSorted;
+    }
+
+    const_iterator begin() const
+    {
+        assert(mSorted && "sort() must be called before iterating.");
+        return mElements.cbegin();
+    }
+
+    const_iterator end() const
+    {
+        return mElements.cend();
+    }
+
+    size_type size() const
+    {
+        return mElements.size();
+    }
+
+    bool empty() const
+    {
+        return mElements.empty();
+    }
+
+    size_type capacity() const
+    {
+        return mElements.capacity();
+    }
+};
+}
@@ -1,13 +1,43 @@
 ﻿#pragma once
 
+#include <bit>
+#include <cassert>
+#include <cstdint>
 #include <type_traits>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include <Usagi/Entity/detail/EntityId.hpp>
 #include <Usagi/Runtime/Service/ServiceAccess.hpp>
 #include <Usagi/Runtime/Service/SimpleService.hpp>
 
 namespace usagi
 {
+namespace detail
+{
+// hash & compare entity ids by their bits.
+struct EntityIdBitsHash
+{
+    static_assert(sizeof(EntityId) == sizeof(std::uint64_t));
+
+    std::size_t operator()(const EntityId id) const
+    {
+        return std::hash<std::uint64_t>()(std::bit_cast<std::uint64_t>(id));
+    }
+};
+
+struct EntityIdBitsEqual
+{
+    bool operator()(const EntityId lhs, const EntityId rhs) const
+    {
+        return std::bit_cast<std::uint64_t>(lhs) ==
+            std::bit_cast<std::uint64_t>(rhs);
+    }
+};
+}
+
 template <
     typename IndexDescriptor
 >
@@ -19,23 +49,140 @@ struct ServiceExternalEntityIndex
     using Projection = typename IndexDescriptor::Projection;
     using ProjectedKey = typename IndexDescriptor::ProjectedKey;
 
+    using KeyCompare = typename SortedKeyContainer::key_compare;
+
     SortedKeyContainer index;
     AggregateContainer aggregates;
 
+    // state of incremental updates. the last projected key of each indexed
+    // entity is remembered to detect the changes.
+    struct TrackedKey
+    {
+        ProjectedKey key;
+        std::uint64_t update_stamp;
+    };
+    std::unordered_map<
+        EntityId,
+        TrackedKey,
+        detail::EntityIdBitsHash,
+        detail::EntityIdBitsEqual
+    > tracked_keys;
+    std::uint64_t update_stamp = 0;
+    std::size_t num_visited = 0;
+    // whether the index was built by incremental updates. the two ways of
+    // building the index can't be mixed, since the entities inserted by
+    // visit() are not tracked and would be inserted again.
+    bool incremental = false;
+    // changes collected during an update. kept to reuse the memory.
+    std::vector<ProjectedKey> erased_keys;
+    std::vector<std::pair<ProjectedKey, EntityId>> inserted_entries;
+
     void reset_index()
     {
-        // todo perf avoid allocation overhead?
+        // use a container like FlatSortedMap to avoid the allocation overhead
         index.clear();
+        tracked_keys.clear();
+        incremental = false;
     }
 
     template <typename EntityView>
     void visit(EntityView e)
     {
+        assert(!incremental && "call reset_index() before visit()");
         const auto projected = Projection()(e(C<SortKey>()));
         const auto [iter, inserted] = index.emplace(projected, e.id());
         assert(inserted && "duplicated index key? index should be cleared?");
     }
 
+    // called after all entities are visited. containers deferring the
+    // ordering of elements are sorted here.
+    void finish_index()
+    {
+        if constexpr(requires { index.sort(); })
+            index.sort();
+    }
+
+    /*
+     * Incremental update: call begin_update(), visit_incremental() every
+     * entity matching the query, then finish_update(). Only the entities
+     * whose projected key has changed, and those appeared or disappeared
+     * since the last update, are removed from or inserted into the index.
+     * The first update after the index was built by visit() starts over from
+     * an empty index.
+     */
+
+    void begin_update()
+    {
+        if(!incremental)
+        {
+            reset_index();
+            incremental = true;
+        }
+        ++update_stamp;
+        num_visited = 0;
+        erased_keys.clear();
+        inserted_entries.clear();
+    }
+
+    template <typename EntityView>
+    void visit_incremental(EntityView e)
+    {
+        const auto projected = Projection()(e(C<SortKey>()));
+        const auto [iter, inserted] = tracked_keys.try_emplace(
+            e.id(), TrackedKey { projected, update_stamp });
+        ++num_visited;
+
+        if(inserted)
+        {
+            inserted_entries.emplace_back(projected, e.id());
+            return;
+        }
+
+        auto &tracked = iter->second;
+        assert(tracked.update_stamp != update_stamp && "entity visited twice?");
+        tracked.update_stamp = update_stamp;
+
+        const KeyCompare comp;
+        if(!comp(tracked.key, projected) && !comp(projected, tracked.key))
+            return;
+
+        erased_keys.push_back(tracked.key);
+        inserted_entries.emplace_back(projected, e.id());
+        tracked.key = projected;
+    }
+
+    void finish_update()
+    {
+        // entities not visited are either destroyed or no longer matching
+        // the query.
+        if(num_visited != tracked_keys.size())
+        {
+            std::erase_if(tracked_keys, [&](auto &&kv) {
+                if(kv.second.update_stamp == update_stamp) return false;
+                erased_keys.push_back(kv.second.key);
+                return true;
+            });
+        }
+
+        if constexpr(requires {
+            index.apply_changes(erased_keys, inserted_entries);
+        })
+        {
+            index.apply_changes(erased_keys, inserted_entries);
+        }
+        else
+        {
+            // erase first since the keys may be swapped between entities.
+            for(auto &&key : erased_keys)
+                index.erase(key);
+            for(auto &&[key, id] : inserted_entries)
+            {
+                const auto [iter, inserted] = index.emplace(key, id);
+                assert(inserted && "duplicated index key?");
+            }
+        }
+    }
+
     // todo thread safety
     auto & reset_aggregate(std::string_view key)
     {
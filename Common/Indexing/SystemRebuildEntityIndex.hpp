@@ -7,9 +7,17 @@
 
 namespace usagi
 {
+/**
+ * \brief Keep the entity index in sync with the entity database.
+ * \tparam IndexDescriptor The index to be maintained.
+ * \tparam Incremental When false, the index is rebuilt from scratch on every
+ * update. When true, the projected keys of entities are compared against the
+ * ones seen in the last update and only the changed entities are reinserted.
+ * This costs one hash table entry per indexed entity.
+ */
 template <
-    typename IndexDescriptor
-// todo: visit dirty entities only
+    typename IndexDescriptor,
+    bool Incremental = false
 >
 struct SystemRebuildEntityIndex
 {
@@ -23,12 +31,28 @@ struct SystemRebuildEntityIndex
     void update(ServiceAccessT rt, auto &&db)
     {
         auto &index = rt.entity_index(IndexDescriptor());
+
+        // todo: use change tracking of the entity database when available to
+        // skip unchanged pages.
+        if constexpr(Incremental)
+        {
+            index.begin_update();
+            for(auto &&e : db.view(typename IndexDescriptor::Query()))
+            {
+                index.visit_incremental(e);
+            }
+            index.finish_update();
+            return;
+        }
+
         index.reset_index();
 
         for(auto &&e : db.view(typename IndexDescriptor::Query()))
         {
             index.visit(e);
         }
+
+        index.finish_index();
     }
 };
 }
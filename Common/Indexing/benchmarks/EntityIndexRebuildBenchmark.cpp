@@ -0,0 +1,229 @@
+﻿// Benchmark of rebuilding an entity index from scratch.
+//
+// Usage: EntityIndexRebuildBenchmark [number of entities]
+//
+// Simulates SystemRebuildEntityIndex on a fitness ranking: each generation the
+// index is reset and every (fitness, entity id) pair is inserted again. The
+// median rebuild time and the number of heap allocations in the last rebuild
+// are reported for std::map and FlatSortedMap.
+//
+// Then the steady state of ServiceExternalEntityIndex is measured when 0.1% of
+// the entities change their fitness per frame, comparing full rebuilds with
+// incremental updates.
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Usagi/Entity/detail/ComponentFilter.hpp>
+#include <Usagi/Entity/detail/EntityId.hpp>
+#include <Usagi/Modules/Common/Indexing/FlatSortedMap.hpp>
+#include <Usagi/Modules/Common/Indexing/ServiceExternalEntityIndex.hpp>
+
+using namespace usagi;
+
+namespace
+{
+std::atomic<std::size_t> gNumAllocations = 0;
+}
+
+void * operator new(const std::size_t size)
+{
+    ++gNumAllocations;
+    if(void *p = std::malloc(size)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+constexpr std::size_t NumGenerations = 10;
+
+using EntityIdT = std::uint64_t;
+
+template <typename Container>
+void run(const char *name, const std::vector<float> &fitness)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Container index;
+    std::vector<double> times;
+    std::mt19937 rng(1);
+    auto keys = fitness;
+    std::size_t allocations = 0;
+    std::size_t checksum = 0;
+
+    for(std::size_t g = 0; g < NumGenerations; ++g)
+    {
+        // the population changes between generations
+        std::ranges::shuffle(keys, rng);
+
+        const auto allocations_before = gNumAllocations.load();
+        const auto begin = Clock::now();
+
+        index.clear();
+        for(std::size_t i = 0; i < keys.size(); ++i)
+            index.emplace(keys[i], static_cast<EntityIdT>(i));
+        if constexpr(requires { index.sort(); })
+            index.sort();
+
+        const auto end = Clock::now();
+        allocations = gNumAllocations.load() - allocations_before;
+
+        times.push_back(
+            std::chrono::duration<double, std::milli>(end - begin).count());
+        checksum += index.begin()->second;
+    }
+
+    std::ranges::nth_element(times, times.begin() + times.size() / 2);
+    fmt::print("{},{:.3f},{},{}\n",
+        name, times[times.size() / 2], allocations, checksum);
+}
+
+struct ComponentFitness
+{
+    float fitness;
+};
+
+struct ProjectFitness
+{
+    float operator()(const ComponentFitness &c) const
+    {
+        return c.fitness;
+    }
+};
+
+// stands in for the entity views produced by db.view().
+struct MockEntityView
+{
+    ComponentFitness *component;
+    EntityId entity_id;
+
+    ComponentFitness & operator()(C<ComponentFitness>) const
+    {
+        return *component;
+    }
+
+    EntityId id() const
+    {
+        return entity_id;
+    }
+};
+
+template <template <typename, typename, typename, typename...> typename
+    OrderedContainer>
+struct MockIndexDescriptor
+{
+    using SortKey = ComponentFitness;
+    using Projection = ProjectFitness;
+    using ProjectedKey = float;
+    using SortedKeyContainer =
+        OrderedContainer<float, EntityId, std::greater<float>>;
+    using AggregateContainer = std::map<std::string, float>;
+};
+
+template <typename IndexDescriptor, bool Incremental>
+void run_steady_state(const char *name, const std::size_t size)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<ComponentFitness> components(size);
+    std::vector<MockEntityView> views(size);
+    for(std::size_t i = 0; i < size; ++i)
+    {
+        components[i].fitness = static_cast<float>(i);
+        views[i] = {
+            &components[i],
+            std::bit_cast<EntityId>(static_cast<std::uint64_t>(i))
+        };
+    }
+
+    ServiceExternalEntityIndex<IndexDescriptor> index;
+    const auto num_changes = std::max<std::size_t>(1, size / 1000);
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<std::size_t> pick(0, size - 1);
+    // new keys are above all existing ones so they stay unique.
+    float next_key = static_cast<float>(size);
+    std::vector<double> times;
+
+    // frame 0 builds the index in either mode
+    for(std::size_t g = 0; g <= NumGenerations; ++g)
+    {
+        for(std::size_t c = 0; g > 0 && c < num_changes; ++c)
+            components[pick(rng)].fitness = next_key++;
+
+        const auto begin = Clock::now();
+        if constexpr(Incremental)
+        {
+            index.begin_update();
+            for(auto &&e : views)
+                index.visit_incremental(e);
+            index.finish_update();
+        }
+        else
+        {
+            index.reset_index();
+            for(auto &&e : views)
+                index.visit(e);
+            index.finish_index();
+        }
+        const auto end = Clock::now();
+
+        if(g > 0)
+            times.push_back(std::chrono::duration<double, std::milli>(
+                end - begin).count());
+    }
+
+    std::ranges::nth_element(times, times.begin() + times.size() / 2);
+    fmt::print("{},{},{:.3f}\n",
+        name, num_changes, times[times.size() / 2]);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t size = argc > 1 ? std::atoll(argv[1]) : 1000000;
+
+    // unique keys as required by the index
+    std::vector<float> fitness(size);
+    for(std::size_t i = 0; i < size; ++i)
+        fitness[i] = static_cast<float>(i) * 0.5f;
+
+    fmt::print("entities={}\n", size);
+    fmt::print("container,rebuild_ms,allocations,checksum\n");
+
+    run<std::map<float, EntityIdT, std::greater<float>>>("std_map", fitness);
+    run<FlatSortedMap<float, EntityIdT, std::greater<float>>>(
+        "flat_sorted_map", fitness);
+
+    using MapIndex = MockIndexDescriptor<std::map>;
+    using FlatIndex = MockIndexDescriptor<FlatSortedMap>;
+
+    fmt::print("steady_state,changes_per_frame,update_ms\n");
+    run_steady_state<MapIndex, false>("std_map_rebuild", size);
+    run_steady_state<MapIndex, true>("std_map_incremental", size);
+    run_steady_state<FlatIndex, false>("flat_sorted_map_rebuild", size);
+    run_steady_state<FlatIndex, true>("flat_sorted_map_incremental", size);
+
+    return 0;
+}
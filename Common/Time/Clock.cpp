@@ -1,38 +1,42 @@
 ﻿#include "Clock.hpp"
 
-// #include "Logging.hpp"
+#include "MonotonicClock.hpp"
+
+namespace
+{
+usagi::TimeDuration to_seconds(const std::uint64_t ns)
+{
+    return static_cast<double>(ns) /
+        static_cast<double>(usagi::NANOSECONDS_PER_SECOND);
+}
+}
 
 usagi::Clock::Clock()
 {
-    // if constexpr(!ClockT::is_steady)
-        // LOG(warn, "std::chrono::high_resolution_clock is not steady!");
     reset();
 }
 
 void usagi::Clock::reset()
 {
-    mCreation = mLastTick = ClockT::now();
-    mTotalFrameTime = mLastFrameTime = mLastTick - mCreation;
+    mCreation = mLastTick = monotonic_now_ns();
+    mTotalFrameTime = mLastFrameTime = 0;
 }
 
 usagi::TimeDuration usagi::Clock::realtime_elapsed() const
 {
-    const Duration d = ClockT::now() - mLastTick;
-    return d.count();
+    return to_seconds(monotonic_now_ns() - mLastTick);
 }
 
 usagi::TimeDuration usagi::Clock::realtime_total_elapsed() const
 {
-    const Duration d = ClockT::now() - mCreation;
-    return d.count();
+    return to_seconds(monotonic_now_ns() - mCreation);
 }
 
 usagi::TimeDuration usagi::Clock::tick()
 {
-    const auto this_tick = ClockT::now();
+    const auto this_tick = monotonic_now_ns();
     mLastFrameTime = this_tick - mLastTick;
 
-    using namespace std::chrono_literals;
     // if(mSinceLastTick > 1s)
     // {
     //     mSinceLastTick = 16ms;
@@ -45,10 +49,10 @@ usagi::TimeDuration usagi::Clock::tick()
 
 usagi::TimeDuration usagi::Clock::last_frame_time() const
 {
-    return mLastFrameTime.count();
+    return to_seconds(mLastFrameTime);
 }
 
 usagi::TimeDuration usagi::Clock::total_frame_time() const
 {
-    return mTotalFrameTime.count();
+    return to_seconds(mTotalFrameTime);
 }
@@ -1,20 +1,20 @@
 ﻿#pragma once
 
-#include <chrono>
+#include <cstdint>
 
 namespace usagi
 {
 using TimeDuration = double;
 using TimePoint = double;
 
+// Frame clock on the monotonic time base. See MonotonicClock.hpp.
 class Clock
 {
-    using ClockT = std::chrono::high_resolution_clock;
-    ClockT::time_point mCreation;
-    ClockT::time_point mLastTick;
-    using Duration = std::chrono::duration<double>;
-    Duration mLastFrameTime;
-    Duration mTotalFrameTime;
+    // nanoseconds on the monotonic time base
+    std::uint64_t mCreation = 0;
+    std::uint64_t mLastTick = 0;
+    std::uint64_t mLastFrameTime = 0;
+    std::uint64_t mTotalFrameTime = 0;
 
 public:
     Clock();
@@ -37,5 +37,12 @@ public:
 
     // Time since start to last tick.
     TimeDuration total_frame_time() const;
+
+
+    // Same as above in nanoseconds, for fixed timesteps & timestamps.
+
+    std::uint64_t last_frame_time_ns() const { return mLastFrameTime; }
+    std::uint64_t total_frame_time_ns() const { return mTotalFrameTime; }
+    std::uint64_t last_tick_ns() const { return mLastTick; }
 };
 }
@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+namespace usagi
+{
+/**
+ * \brief Accumulates frame time and tells how many simulation steps of a
+ * fixed length should be run this frame. Time is accumulated in integer
+ * nanoseconds so the simulation does not drift from the frame clock however
+ * long the program runs.
+ */
+class FixedTimestep
+{
+    std::uint64_t mStep;
+    std::uint64_t mAccumulated = 0;
+    // steps beyond this are dropped when the frames cannot keep up, so that
+    // a long stall is not followed by ever longer frames.
+    std::uint32_t mMaxSteps;
+
+public:
+    explicit FixedTimestep(
+        const std::uint64_t step_ns,
+        const std::uint32_t max_steps_per_frame = 8)
+        : mStep(step_ns)
+        , mMaxSteps(max_steps_per_frame)
+    {
+        assert(step_ns > 0);
+        assert(max_steps_per_frame > 0);
+    }
+
+    // Add the time of the last frame and return the number of steps to run.
+    std::uint32_t advance(const std::uint64_t elapsed_ns)
+    {
+        mAccumulated += elapsed_ns;
+        const auto steps = mAccumulated / mStep;
+        if(steps > mMaxSteps)
+        {
+            mAccumulated %= mStep;
+            return mMaxSteps;
+        }
+        mAccumulated -= steps * mStep;
+        return static_cast<std::uint32_t>(steps);
+    }
+
+    // Fraction of a step left over, for interpolating between the last two
+    // simulated states.
+    double alpha() const
+    {
+        return static_cast<double>(mAccumulated) / static_cast<double>(mStep);
+    }
+
+    std::uint64_t step_ns() const
+    {
+        return mStep;
+    }
+
+    void reset()
+    {
+        mAccumulated = 0;
+    }
+};
+}
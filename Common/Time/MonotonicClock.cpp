@@ -0,0 +1,64 @@
+﻿#include "MonotonicClock.hpp"
+
+#include <cassert>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <Windows.h>
+#else
+#   include <time.h>
+#endif
+
+namespace usagi
+{
+namespace
+{
+#ifdef _WIN32
+// the frequency of the performance counter is fixed at system boot.
+const std::uint64_t COUNTER_FREQUENCY = [] {
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+    return static_cast<std::uint64_t>(freq.QuadPart);
+}();
+
+std::uint64_t read_counter_ns()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    const auto ticks = static_cast<std::uint64_t>(counter.QuadPart);
+    // split the ticks to avoid overflowing the multiplication.
+    const auto whole = ticks / COUNTER_FREQUENCY;
+    const auto part = ticks % COUNTER_FREQUENCY;
+    return whole * NANOSECONDS_PER_SECOND +
+        part * NANOSECONDS_PER_SECOND / COUNTER_FREQUENCY;
+}
+#else
+std::uint64_t read_counter_ns()
+{
+    timespec ts;
+    [[maybe_unused]]
+    const auto ret = clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    assert(ret == 0);
+    return static_cast<std::uint64_t>(ts.tv_sec) * NANOSECONDS_PER_SECOND +
+        static_cast<std::uint64_t>(ts.tv_nsec);
+}
+#endif
+}
+
+std::uint64_t monotonic_now_ns()
+{
+    static const std::uint64_t epoch = read_counter_ns();
+    return read_counter_ns() - epoch;
+}
+
+void to_timestamps(
+    const std::span<const std::uint64_t> ns,
+    const std::span<ComponentTimestamp> out)
+{
+    assert(out.size() >= ns.size());
+
+    for(std::size_t i = 0; i < ns.size(); ++i)
+        out[i] = to_timestamp(ns[i]);
+}
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "ComponentTimestamp.hpp"
+
+namespace usagi
+{
+/*
+ * Time base shared by the frame clock, input events, and profilers. Time is
+ * measured in 64-bit nanoseconds since the first reading in the process,
+ * taken from a monotonic counter that is not adjusted by the system time
+ * (QueryPerformanceCounter on Windows, CLOCK_MONOTONIC_RAW elsewhere). Both
+ * are read in user mode without a system call, so the clock is cheap to read
+ * from any thread.
+ */
+
+// Nanoseconds since the time base was initialized.
+std::uint64_t monotonic_now_ns();
+
+constexpr std::uint64_t NANOSECONDS_PER_SECOND = 1'000'000'000;
+
+constexpr ComponentTimestamp to_timestamp(const std::uint64_t ns)
+{
+    return {
+        .seconds = static_cast<std::uint32_t>(ns / NANOSECONDS_PER_SECOND),
+        .nanoseconds = static_cast<std::uint32_t>(ns % NANOSECONDS_PER_SECOND)
+    };
+}
+
+constexpr std::uint64_t to_nanoseconds(const ComponentTimestamp &timestamp)
+{
+    return timestamp.seconds * NANOSECONDS_PER_SECOND + timestamp.nanoseconds;
+}
+
+// Convert nanoseconds to timestamps in one loop without branches, which
+// compilers can vectorize. `out` must be at least as large as `ns`.
+void to_timestamps(
+    std::span<const std::uint64_t> ns,
+    std::span<ComponentTimestamp> out);
+}
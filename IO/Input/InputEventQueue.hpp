@@ -1,14 +1,19 @@
 ﻿#pragma once
 
-#include <Usagi/Entity/EntityDatabase.hpp>
+#include <vector>
 
-#include "ArchetypeInputEvent.hpp"
+#include <Usagi/Runtime/Service/SimpleService.hpp>
+
+#include "InputEventRecord.hpp"
 
 namespace usagi
 {
-using InputEventQueue = EntityDatabase<
-    entity::EntityDatabaseConfiguration<>,
-    ComponentTimestamp,
-    ComponentInputEvent
->;
+// Input events received during the last frame in the order they happened.
+// Refilled by SystemInputEventPump at the start of each frame.
+struct InputEventQueue
+{
+    std::vector<InputEventRecord> events;
+};
+
+using ServiceInputEventQueue = SimpleService<InputEventQueue>;
 }
@@ -0,0 +1,15 @@
+﻿#pragma once
+
+#include <Usagi/Modules/Common/Time/ComponentTimestamp.hpp>
+
+#include "ComponentInputEvent.hpp"
+
+namespace usagi
+{
+// Packed form of an input event passed from the input thread to the frame.
+struct InputEventRecord
+{
+    ComponentTimestamp timestamp;
+    ComponentInputEvent event;
+};
+}
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <span>
+
+#include <Usagi/Library/Memory/Noncopyable.hpp>
+
+#include "InputEventRecord.hpp"
+
+namespace usagi
+{
+/**
+ * \brief Fixed-capacity single-producer single-consumer queue of input events.
+ * The platform input thread pushes events as they arrive and the frame drains
+ * all of them at once, so input can be sampled more often than frames are
+ * produced without any lock or allocation on either side.
+ *
+ * The read & write positions only increase and are mapped to slots by
+ * masking, so the capacity must be a power of 2. When the queue is full, new
+ * events are dropped and counted.
+ */
+class InputEventRingBuffer : Noncopyable
+{
+    // keep the positions written by each side on separate cache lines
+    constexpr static std::size_t CACHE_LINE_SIZE = 64;
+
+    std::unique_ptr<InputEventRecord[]> mRecords;
+    const std::size_t mMask;
+
+    // producer side
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mWrite { 0 };
+    // last read position seen by the producer, which saves loading mRead
+    // until the queue looks full.
+    std::size_t mReadCached = 0;
+    std::atomic<std::size_t> mNumDropped { 0 };
+
+    // consumer side
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mRead { 0 };
+
+public:
+    // enough for an 8 kHz mouse at 30 frames per second with some headroom.
+    constexpr static std::size_t DEFAULT_CAPACITY = 1024;
+
+    explicit InputEventRingBuffer(
+        const std::size_t capacity = DEFAULT_CAPACITY)
+        : mRecords(std::make_unique<InputEventRecord[]>(capacity))
+        , mMask(capacity - 1)
+    {
+        assert(std::has_single_bit(capacity));
+    }
+
+    std::size_t capacity() const
+    {
+        return mMask + 1;
+    }
+
+    // Number of events dropped because the queue was full.
+    std::size_t num_dropped() const
+    {
+        return mNumDropped.load(std::memory_order_relaxed);
+    }
+
+    // Producer only. Returns false if the event is dropped.
+    bool push(const InputEventRecord &record)
+    {
+        const auto write = mWrite.load(std::memory_order_relaxed);
+        if(write - mReadCached > mMask)
+        {
+            mReadCached = mRead.load(std::memory_order_acquire);
+            if(write - mReadCached > mMask)
+            {
+                mNumDropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+        mRecords[write & mMask] = record;
+        mWrite.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Consumer only. Pass all queued events to `func` as at most two
+     * contiguous `std::span<const InputEventRecord>`s in the order they were
+     * pushed, then release their slots to the producer. Events pushed while
+     * draining are left for the next call.
+     * \return The number of drained events.
+     */
+    template <typename Func>
+    std::size_t drain(Func &&func)
+    {
+        const auto read = mRead.load(std::memory_order_relaxed);
+        const auto write = mWrite.load(std::memory_order_acquire);
+        const auto count = write - read;
+        if(count == 0) return 0;
+
+        const auto begin = read & mMask;
+        const auto first = std::min(count, capacity() - begin);
+        func(std::span<const InputEventRecord>(&mRecords[begin], first));
+        if(first < count)
+        {
+            func(std::span<const InputEventRecord>(
+                &mRecords[0], count - first));
+        }
+
+        mRead.store(write, std::memory_order_release);
+        return count;
+    }
+};
+}
@@ -1,6 +1,6 @@
 ﻿#pragma once
 
-#include "InputEventInserter.hpp"
+#include "InputEventRingBuffer.hpp"
 
 namespace usagi
 {
@@ -9,7 +9,12 @@ class InputEventSource
 public:
     virtual ~InputEventSource() = default;
 
+    // Called on the frame thread before the events are drained. Sources
+    // without an input thread may read platform events here.
     virtual void collect_events() = 0;
-    virtual void process_events(InputEventInserter &input_event_sink) = 0;
+
+    // The queue the source pushes its events into. The frame thread is the
+    // only consumer.
+    virtual InputEventRingBuffer & event_buffer() = 0;
 };
 }
@@ -1,52 +1,43 @@
 ﻿#pragma once
 
+#include <span>
+
 #include <Usagi/Entity/EntityDatabase.hpp>
 #include <Usagi/Runtime/Service/Service.hpp>
 
-#include "InputEventInserter.hpp"
+#include "InputEventQueue.hpp"
 #include "ServiceInputSource.hpp"
 
 namespace usagi
 {
+/**
+ * \brief Move the input events produced since the last frame from the ring
+ * buffer of the input source into the input event queue of this frame. The
+ * events are copied in bulk, one or two contiguous blocks per frame.
+ */
 struct SystemInputEventPump
 {
-    using WriteAccess = ArchetypeInputEvent::ComponentFilterT;
+    using WriteAccess = C<>;
     using ReadAccess = C<>;
 
-    ArchetypeInputEvent archetype;
-
     template <typename RuntimeServices, typename EntityDatabaseAccess>
     auto update(RuntimeServices &&rt, EntityDatabaseAccess &&db)
     {
         auto &source = USAGI_SERVICE(rt, ServiceInputSource);
+        auto &queue = USAGI_SERVICE(rt, ServiceInputEventQueue);
 
-        class Inserter : public InputEventInserter
-        {
-            ArchetypeInputEvent &mArchetype;
-            EntityDatabaseAccess mAccess;
-
-        public:
-            Inserter(
-                ArchetypeInputEvent &archetype,
-                EntityDatabaseAccess access)
-                : mArchetype(archetype)
-                , mAccess(access)
-            {
-            }
-
-            ArchetypeInputEvent & archetype() override
-            {
-                return mArchetype;
-            }
+        source.collect_events();
 
-            void insert() override
-            {
-                mAccess.insert(mArchetype);
+        queue.events.clear();
+        source.event_buffer().drain(
+            [&](const std::span<const InputEventRecord> records) {
+                queue.events.insert(
+                    queue.events.end(),
+                    records.begin(),
+                    records.end()
+                );
             }
-        } visitor { archetype, db };
-
-        source.collect_events();
-        source.process_events(visitor);
+        );
     }
 };
 }
@@ -1,7 +1,8 @@
 ﻿#include "InputEventSourceWin32RawInput.hpp"
 
-#include <vector>
+#include <exception>
 
+#include <Usagi/Modules/Common/Time/MonotonicClock.hpp>
 #include <Usagi/Modules/Platforms/WinCommon/Win32.hpp>
 #include <Usagi/Runtime/Memory/WeakSingleton.hpp>
 
@@ -25,8 +26,22 @@ POINT convert_from_absolute_position(const Vector2f &pos)
 
 namespace usagi
 {
+void InputEventSourceWin32RawInput::push_event(
+    const ComponentInputEvent &event)
+{
+    // the input thread handles each message right after it is posted, so the
+    // time of handling is used, which shares the time base with the frame
+    // clock and is more precise than the message time in milliseconds.
+    InputEventRecord record;
+    record.timestamp = to_timestamp(monotonic_now_ns());
+    record.event = event;
+
+    // if the frame stalls long enough to fill the buffer, the newest events
+    // are dropped and counted by the buffer.
+    mEvents.push(record);
+}
+
 bool InputEventSourceWin32RawInput::raw_input__handle_keyboard(
-    InputEventInserter &inserter,
     const tagRAWKEYBOARD &keyboard,
     const win32::MessageInfo &info)
 {
@@ -36,37 +51,25 @@ bool InputEventSourceWin32RawInput::raw_input__handle_keyboard(
     if(key == InputAxis::UNKNOWN)
         return false;
 
-    auto &archetype = inserter.archetype();
-
-    // todo: timestamp
-
-    auto &evt = archetype.component<ComponentInputEvent>();
+    ComponentInputEvent evt;
     const auto pressed = (keyboard.Flags & RI_KEY_BREAK) == 0;
     evt.axis = key;
     evt.absolute = { 0, pressed };
     evt.relative = { 0, pressed ? 1 : -1 };
 
-    inserter.insert();
+    push_event(evt);
 
     return true;
 }
 
 bool InputEventSourceWin32RawInput::raw_input__handle_mouse(
-    InputEventInserter &inserter,
     const tagRAWMOUSE &mouse,
     const win32::MessageInfo &info)
 {
-    // todo: timestamp
-
-
     [[maybe_unused]]
     static Vector2f last_position;
 
-    auto &archetype = inserter.archetype();
-    auto &event = archetype.component<ComponentInputEvent>();
-    auto &time = archetype.component<ComponentTimestamp>();
-
-    time.seconds = mSink->tick_to_clock(info.time).count();
+    ComponentInputEvent event;
 
     Vector2f cursor_rel;
     const Vector2f cursor_abs = { info.cursor.x, info.cursor.y };
@@ -116,7 +119,7 @@ bool InputEventSourceWin32RawInput::raw_input__handle_mouse(
         event.axis = InputAxis::MOUSE_CURSOR;
         event.absolute = cursor_abs;
         event.relative = cursor_rel;
-        inserter.insert();
+        push_event(event);
     }
 
     auto btn_pressed = [&](int flag, InputAxis code) {
@@ -125,7 +128,7 @@ bool InputEventSourceWin32RawInput::raw_input__handle_mouse(
             event.axis = code;
             event.absolute = { 0, 1 };
             event.relative = { 0, 1 };
-            inserter.insert();
+            push_event(event);
         }
     };
 
@@ -135,7 +138,7 @@ bool InputEventSourceWin32RawInput::raw_input__handle_mouse(
             event.axis = code;
             event.absolute = { 0, 0 };
             event.relative = { 0, -1 };
-            inserter.insert();
+            push_event(event);
         }
     };
     // process mouse buttons & scrolling
@@ -168,7 +171,7 @@ bool InputEventSourceWin32RawInput::raw_input__handle_mouse(
             event.axis = InputAxis::MOUSE_WHEEL_Y;
             event.absolute = { 0, 0 };
             event.relative = { 0, wheel_delta };
-            inserter.insert();
+            push_event(event);
         }
         // horizontal scrolling, which seems to be undocumented.
         // found here: https://stackoverflow.com/questions/7942307/horizontal-mouse-wheel-messages-from-windows-raw-input
@@ -177,7 +180,7 @@ bool InputEventSourceWin32RawInput::raw_input__handle_mouse(
             event.axis = InputAxis::MOUSE_WHEEL_X;
             event.absolute = { 0, 0 };
             event.relative = { wheel_delta, 0 };
-            inserter.insert();
+            push_event(event);
         }
     }
 
@@ -186,20 +189,79 @@ bool InputEventSourceWin32RawInput::raw_input__handle_mouse(
 
 InputEventSourceWin32RawInput::InputEventSourceWin32RawInput()
 {
-    mSink = WeakSingleton<RawInputSink>::try_lock_construct();
+    std::promise<void> ready;
+    auto started = ready.get_future();
+
+    mInputThread = std::thread([this, ready = std::move(ready)]() mutable {
+        input_thread(std::move(ready));
+    });
+    mInputThreadId = GetThreadId(mInputThread.native_handle());
+
+    // rethrow the error if the input thread failed to create the sink
+    try
+    {
+        started.get();
+    }
+    catch(...)
+    {
+        mInputThread.join();
+        throw;
+    }
+}
+
+InputEventSourceWin32RawInput::~InputEventSourceWin32RawInput()
+{
+    USAGI_WIN32_CHECK_ASSERT(
+        PostThreadMessageW,
+        mInputThreadId, WM_QUIT, 0, 0
+    );
+    mInputThread.join();
+}
+
+void InputEventSourceWin32RawInput::input_thread(std::promise<void> ready)
+{
+    try
+    {
+        // raw input is delivered to the thread owning the sink window.
+        mSink = WeakSingleton<RawInputSink>::try_lock_construct();
+
+        // create the message queue of the thread so that WM_QUIT can be
+        // posted to it once the constructor returns.
+        MSG msg;
+        PeekMessageW(&msg, nullptr, 0, 0, PM_NOREMOVE);
+    }
+    catch(...)
+    {
+        ready.set_exception(std::current_exception());
+        return;
+    }
+    ready.set_value();
+
+    // block until input arrives instead of polling. GetMessage returns 0 on
+    // WM_QUIT posted by the destructor.
+    MSG msg;
+    while(GetMessageW(&msg, nullptr, 0, 0) > 0)
+    {
+        DispatchMessageW(&msg);
+        translate_messages();
+    }
+
+    // the window must be destroyed by the thread that created it.
+    mSink.reset();
 }
 
 void InputEventSourceWin32RawInput::collect_events()
 {
+    // raw input is handled by the input thread. only the messages of the
+    // windows created by the frame thread are processed here.
     win32::receive_messages();
 }
 
-void InputEventSourceWin32RawInput::process_events(
-    InputEventInserter &input_event_sink)
+void InputEventSourceWin32RawInput::translate_messages()
 {
     using namespace win32;
 
-    auto queue = mSink->message_queue;
+    auto &queue = mSink->message_queue;
     auto head = reinterpret_cast<RAWINPUT*>(queue.data());
     const auto end = reinterpret_cast<std::size_t>(queue.data()) + queue.size();
 
@@ -210,19 +272,11 @@ void InputEventSourceWin32RawInput::process_events(
         switch(head->header.dwType)
         {
             case RIM_TYPEKEYBOARD:
-                raw_input__handle_keyboard(
-                    input_event_sink,
-                    head->data.keyboard,
-                    info
-                );
+                raw_input__handle_keyboard(head->data.keyboard, info);
                 break;
 
             case RIM_TYPEMOUSE:
-                raw_input__handle_mouse(
-                    input_event_sink,
-                    head->data.mouse,
-                    info
-                );
+                raw_input__handle_mouse(head->data.mouse, info);
                 break;
 
             case RIM_TYPEHID:
@@ -234,6 +288,6 @@ void InputEventSourceWin32RawInput::process_events(
         );
     }
 
-    mSink->message_queue.clear();
+    queue.clear();
 }
 }
@@ -1,30 +1,47 @@
 ﻿#pragma once
 
+#include <future>
 #include <memory>
+#include <thread>
 
 #include <Usagi/Modules/IO/Input/ServiceInputSource.hpp>
 #include <Usagi/Modules/Platforms/WinCommon/WindowMessageTarget.hpp>
 
 namespace usagi
 {
-// Not thread-safe.
+// Raw input is received by a message-only window owned by a dedicated input
+// thread, which translates each message as soon as it arrives and pushes the
+// events into the ring buffer. The frame thread only drains the buffer.
 class InputEventSourceWin32RawInput : public InputEventSource
 {
+    InputEventRingBuffer mEvents;
+
+    // only accessed by the input thread
     std::shared_ptr<struct RawInputSink> mSink;
 
+    std::thread mInputThread;
+    DWORD mInputThreadId = 0;
+
+    void input_thread(std::promise<void> ready);
+    void translate_messages();
+    void push_event(const ComponentInputEvent &event);
+
     bool raw_input__handle_keyboard(
-        InputEventInserter &inserter,
         const tagRAWKEYBOARD &keyboard,
         const win32::MessageInfo &info);
     bool raw_input__handle_mouse(
-        InputEventInserter &inserter,
         const tagRAWMOUSE &mouse,
         const win32::MessageInfo &info);
 
 public:
     InputEventSourceWin32RawInput();
+    ~InputEventSourceWin32RawInput() override;
 
     void collect_events() override;
-    void process_events(InputEventInserter &input_event_sink) override;
+
+    InputEventRingBuffer & event_buffer() override
+    {
+        return mEvents;
+    }
 };
 }
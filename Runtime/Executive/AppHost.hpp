@@ -60,8 +60,12 @@ public:
 
     void update(auto &&observer)
     {
+        if constexpr(requires { observer.begin_frame(); })
+            observer.begin_frame();
         mSystems.update(mServices, mDatabaseWorld, observer);
         mDatabaseWorld.reclaim_pages();
+        if constexpr(requires { observer.end_frame(); })
+            observer.end_frame();
     }
 
     void update()
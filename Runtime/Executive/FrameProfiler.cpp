@@ -0,0 +1,97 @@
+﻿#include "FrameProfiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <fmt/format.h>
+
+#include <Usagi/Runtime/ErrorHandling.hpp>
+
+namespace usagi
+{
+FrameProfiler::FrameProfiler(const std::size_t capacity)
+    : mRecords(capacity)
+{
+    USAGI_ASSERT_THROW(
+        capacity > 0,
+        std::runtime_error("FrameProfiler: capacity must be positive.")
+    );
+}
+
+std::vector<SystemProfileRecord> FrameProfiler::records() const
+{
+    const auto capacity = mRecords.size();
+    const auto count = std::min<std::uint64_t>(mNumRecorded, capacity);
+
+    std::vector<SystemProfileRecord> ret;
+    ret.reserve(count);
+    for(auto i = mNumRecorded - count; i < mNumRecorded; ++i)
+        ret.push_back(mRecords[i % capacity]);
+    return ret;
+}
+
+std::string FrameProfiler::chrome_trace_json() const
+{
+    std::string json;
+    auto out = std::back_inserter(json);
+
+    fmt::format_to(out, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    bool first = true;
+    for(auto &&r : records())
+    {
+        const bool is_frame = std::strcmp(r.name, "frame") == 0;
+
+        // complete events. timestamps are in microseconds.
+        fmt::format_to(out,
+            "{}\n{{\"name\":\"",
+            first ? "" : ","
+        );
+        // type names may contain quotes or backslashes in some ABIs
+        for(auto p = r.name; *p; ++p)
+        {
+            if(*p == '"' || *p == '\\') json.push_back('\\');
+            json.push_back(*p);
+        }
+        fmt::format_to(out,
+            "\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":{},"
+            "\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{\"frame\":{}",
+            is_frame ? "frame" : "system",
+            is_frame ? 0 : 1,
+            r.begin / 1e3,
+            (r.end - r.begin) / 1e3,
+            r.frame
+        );
+        if(!is_frame)
+        {
+            fmt::format_to(out,
+                ",\"entities_visited\":{}",
+                r.entities_visited
+            );
+        }
+        fmt::format_to(out, "}}}}");
+        first = false;
+    }
+
+    fmt::format_to(out,
+        "\n],\"metadata\":{{\"frames\":{},\"records\":{}}}}}\n",
+        mFrame,
+        mNumRecorded
+    );
+    return json;
+}
+
+void FrameProfiler::write_chrome_trace(
+    const std::filesystem::path &path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    USAGI_ASSERT_THROW(
+        file,
+        std::runtime_error("FrameProfiler: failed to open the trace file.")
+    );
+    const auto json = chrome_trace_json();
+    file.write(json.data(), static_cast<std::streamsize>(json.size()));
+}
+}
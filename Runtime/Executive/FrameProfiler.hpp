@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <Usagi/Modules/Common/Time/MonotonicClock.hpp>
+
+namespace usagi
+{
+struct SystemProfileRecord
+{
+    // name of the system type, or "frame" for the records of whole frames.
+    const char *name;
+    std::uint64_t frame;
+    // nanoseconds on the monotonic time base
+    std::uint64_t begin;
+    std::uint64_t end;
+    // reported by the system, 0 if it doesn't.
+    std::uint64_t entities_visited;
+};
+
+/**
+ * \brief Records the wall time of each frame and each system for finding the
+ * systems that exceed the frame budget. Pass it as the observer of
+ * AppHost::update() or SystemTaskList::update(), which call begin_frame(),
+ * begin_system(), the call operator after each system, and end_frame().
+ *
+ * Systems can report the work they did by providing a public member
+ * `entities_visited`. It is reset to 0 before each update and recorded after
+ * it. The number of pages touched is not recorded, because the entity views
+ * don't tell which page they are on.
+ *
+ * The records are written into a preallocated ring buffer which keeps the
+ * last `capacity` records, so recording never locks or allocates. The
+ * profiler must be fed from the thread running the systems. Export the
+ * records in Chrome trace event format to view them in chrome://tracing or
+ * ui.perfetto.dev.
+ */
+class FrameProfiler
+{
+    std::vector<SystemProfileRecord> mRecords;
+    // total number of records written. the next one goes to
+    // mNumRecorded % capacity.
+    std::uint64_t mNumRecorded = 0;
+    std::uint64_t mFrame = 0;
+    std::uint64_t mFrameBegin = 0;
+    std::uint64_t mSystemBegin = 0;
+
+    void record(
+        const char *name,
+        std::uint64_t begin,
+        std::uint64_t end,
+        std::uint64_t entities_visited)
+    {
+        mRecords[mNumRecorded++ % mRecords.size()] = {
+            .name = name,
+            .frame = mFrame,
+            .begin = begin,
+            .end = end,
+            .entities_visited = entities_visited,
+        };
+    }
+
+public:
+    constexpr static std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+    explicit FrameProfiler(std::size_t capacity = DEFAULT_CAPACITY);
+
+    void begin_frame()
+    {
+        mFrameBegin = monotonic_now_ns();
+    }
+
+    void end_frame()
+    {
+        record("frame", mFrameBegin, monotonic_now_ns(), 0);
+        ++mFrame;
+    }
+
+    template <typename System>
+    void begin_system(System &sys)
+    {
+        if constexpr(requires { sys.entities_visited = 0; })
+            sys.entities_visited = 0;
+        mSystemBegin = monotonic_now_ns();
+    }
+
+    template <typename System>
+    void operator()(System &sys, auto &&)
+    {
+        const auto end = monotonic_now_ns();
+        std::uint64_t entities = 0;
+        if constexpr(requires { sys.entities_visited; })
+            entities = sys.entities_visited;
+        record(typeid(System).name(), mSystemBegin, end, entities);
+    }
+
+    // The kept records from the oldest to the newest.
+    std::vector<SystemProfileRecord> records() const;
+
+    std::uint64_t num_frames() const
+    {
+        return mFrame;
+    }
+
+    void clear()
+    {
+        mNumRecorded = 0;
+    }
+
+    // Chrome trace event JSON. Frames and systems are shown as two tracks.
+    std::string chrome_trace_json() const;
+    void write_chrome_trace(const std::filesystem::path &path) const;
+};
+}
@@ -28,6 +28,10 @@ struct SystemTaskList
         >;
         auto access = db.template create_access<AccessT>();
         auto &sys = std::get<I>(systems);
+        // observers measuring the systems, such as FrameProfiler, are
+        // notified before the update, too.
+        if constexpr(requires { observer.begin_system(sys); })
+            observer.begin_system(sys);
         if constexpr(std::is_same_v<void, decltype(sys.update(rt, access))>)
         {
             sys.update(rt, access);
@@ -0,0 +1,250 @@
+﻿#include "SamplingProfiler.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <iterator>
+
+// clang-format off
+#include <sqvm.h>
+#include <sqstate.h>
+#include <sqstring.h>
+#include <sqfuncproto.h>
+#include <sqclosure.h>
+// clang-format on
+
+#include <Usagi/Runtime/Exceptions/Exceptions.hpp>
+
+namespace usagi::scripting::quirrel::debugging
+{
+namespace
+{
+std::string string_or(const SQObjectPtr & str, const char * fallback)
+{
+    if(sq_type(str) != OT_STRING) return fallback;
+    return { _stringval(str), static_cast<std::size_t>(_string(str)->_len) };
+}
+} // namespace
+
+SamplingProfiler::SamplingProfiler(const std::size_t capacity)
+    : mFrames(capacity * MAX_DEPTH)
+    , mHeaders(capacity)
+{
+}
+
+SamplingProfiler::~SamplingProfiler()
+{
+    stop();
+}
+
+void SamplingProfiler::attach(HSQUIRRELVM v)
+{
+    // Shio: Shared by the coroutine threads, unlike the foreign pointer,
+    // which the VirtualMachine already uses.
+    sq_setsharedforeignptr(v, this);
+    if(v->_debughook_native != &safepoint)
+        mPreviousHook = v->_debughook_native;
+    sq_setnativedebughook(v, &safepoint);
+}
+
+void SamplingProfiler::detach(HSQUIRRELVM v)
+{
+    sq_setsharedforeignptr(v, nullptr);
+    sq_setnativedebughook(v, mPreviousHook);
+}
+
+void SamplingProfiler::start(const std::chrono::nanoseconds interval)
+{
+    stop();
+    mTimer = std::jthread([this, interval](const std::stop_token token) {
+        using Clock = std::chrono::steady_clock;
+        auto next   = Clock::now();
+        while(!token.stop_requested())
+        {
+            // Shio: Don't try to catch up after oversleeping. A pending
+            // request is only taken once anyway.
+            next = std::max(next + interval, Clock::now());
+            std::this_thread::sleep_until(next);
+            mSampleRequested.store(true, std::memory_order_relaxed);
+            mNumRequested.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+}
+
+void SamplingProfiler::stop()
+{
+    if(!mTimer.joinable()) return;
+    mTimer.request_stop();
+    mTimer.join();
+    mSampleRequested.store(false, std::memory_order_relaxed);
+}
+
+void SamplingProfiler::safepoint(
+    HSQUIRRELVM    v,
+    SQInteger      event_type,
+    const SQChar * source_file,
+    SQInteger      line,
+    const SQChar * func_name
+)
+{
+    const auto profiler =
+        static_cast<SamplingProfiler *>(sq_getsharedforeignptr(v));
+    if(!profiler) return;
+    if(profiler->mPreviousHook)
+        profiler->mPreviousHook(v, event_type, source_file, line, func_name);
+    // Shio: This is all the hook does between samples.
+    if(!profiler->mSampleRequested.load(std::memory_order_relaxed)) return;
+    profiler->mSampleRequested.store(false, std::memory_order_relaxed);
+    profiler->sample(v);
+}
+
+void SamplingProfiler::sample(HSQUIRRELVM v)
+{
+    const auto slot   = mNumRecorded++ % mHeaders.size();
+    const auto frames = mFrames.data() + slot * MAX_DEPTH;
+
+    // Shio: Walk from the innermost frame like `sq_stackinfos()`, but keep
+    // the prototypes instead of formatting their names.
+    std::uint32_t depth = 0;
+    SQInteger     level = v->_callsstacksize - 1;
+    for(; level >= 0 && depth < MAX_DEPTH; --level)
+    {
+        const SQVM::CallInfo & ci = v->_callsstack[level];
+        switch(sq_type(ci._closure))
+        {
+            case OT_CLOSURE:
+            {
+                const auto proto = _closure(ci._closure)->_function;
+                frames[depth++]  = { proto, proto->GetLine(ci._ip) };
+                if(!mSymbols.contains(proto))
+                {
+                    mSymbols.emplace(
+                        proto,
+                        Symbol {
+                            string_or(proto->_name, "<anonymous>"),
+                            string_or(proto->_sourcename, "<unknown>"),
+                        }
+                    );
+                }
+                break;
+            }
+            case OT_NATIVECLOSURE:
+            {
+                const auto native = _nativeclosure(ci._closure);
+                frames[depth++]   = { native, -1 };
+                if(!mSymbols.contains(native))
+                {
+                    mSymbols.emplace(
+                        native,
+                        Symbol { string_or(native->_name, "<native>"), { } }
+                    );
+                }
+                break;
+            }
+            default: break;
+        }
+    }
+    mHeaders[slot] = { depth, level >= 0 };
+}
+
+void SamplingProfiler::append_frame(
+    std::string & stack, const Frame & frame
+) const
+{
+    const auto it = mSymbols.find(frame.function);
+    if(it == mSymbols.end())
+    {
+        std::format_to(
+            std::back_inserter(stack), "<forgotten {:p}>", frame.function
+        );
+    }
+    else if(it->second.source.empty())
+    {
+        std::format_to(
+            std::back_inserter(stack), "{} [native]", it->second.name
+        );
+    }
+    else
+    {
+        std::format_to(
+            std::back_inserter(stack), "{} ({}:{})", it->second.name,
+            it->second.source, frame.line
+        );
+    }
+}
+
+std::size_t SamplingProfiler::collect()
+{
+    const auto capacity = mHeaders.size();
+    if(mNumRecorded - mNumCollected > capacity)
+    {
+        mNumDropped   += mNumRecorded - mNumCollected - capacity;
+        mNumCollected  = mNumRecorded - capacity;
+    }
+
+    const auto  begin = mNumCollected;
+    std::string stack;
+    for(; mNumCollected < mNumRecorded; ++mNumCollected)
+    {
+        const auto   slot   = mNumCollected % capacity;
+        const auto & header = mHeaders[slot];
+        const auto   frames = mFrames.data() + slot * MAX_DEPTH;
+
+        stack.clear();
+        if(header.truncated) stack += "[truncated]";
+        for(auto i = header.depth; i-- > 0;)
+        {
+            if(!stack.empty()) stack += ';';
+            append_frame(stack, frames[i]);
+        }
+        if(stack.empty()) stack = "[no script]";
+
+        if(const auto it = mFoldedStacks.find(stack);
+            it != mFoldedStacks.end())
+            ++it->second;
+        else
+            mFoldedStacks.emplace(stack, 1);
+    }
+    return mNumCollected - begin;
+}
+
+void SamplingProfiler::clear()
+{
+    mNumCollected = mNumRecorded;
+    mFoldedStacks.clear();
+}
+
+std::string SamplingProfiler::folded_stacks() const
+{
+    std::vector<const decltype(mFoldedStacks)::value_type *> sorted;
+    sorted.reserve(mFoldedStacks.size());
+    for(auto && entry : mFoldedStacks) sorted.push_back(&entry);
+    std::ranges::sort(sorted, { }, [](auto && entry) -> const std::string & {
+        return entry->first;
+    });
+
+    std::string folded;
+    for(auto && entry : sorted)
+    {
+        std::format_to(
+            std::back_inserter(folded), "{} {}\n", entry->first, entry->second
+        );
+    }
+    return folded;
+}
+
+void SamplingProfiler::write_folded_stacks(
+    const std::filesystem::path & path
+) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if(!file)
+    {
+        throw usagi::runtime::RuntimeError(
+            "Failed to open {} for the folded stacks.", path.string()
+        );
+    }
+    const auto folded = folded_stacks();
+    file.write(folded.data(), static_cast<std::streamsize>(folded.size()));
+}
+} // namespace usagi::scripting::quirrel::debugging
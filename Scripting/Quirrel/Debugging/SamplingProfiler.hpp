@@ -0,0 +1,161 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <squirrel.h>
+
+namespace usagi::scripting::quirrel::debugging
+{
+/**
+ * \brief Samples the script call stacks of a VM for flame graphs.
+ *
+ * \details A timer thread requests a sample every interval by setting a flag.
+ * The flag is checked by a native debug hook, which the VM calls on function
+ * calls and returns, and on every line of scripts compiled with debug info.
+ * The hook passes every event on to the hook it replaced, so a
+ * `DebuggingInterface` keeps receiving them, and otherwise only loads the
+ * flag. When it is set, the hook copies
+ * the call stack of the thread it runs on into a preallocated ring buffer,
+ * which keeps the last `capacity` samples. Each frame is stored as the
+ * function prototype (or native closure) and the current line. Nothing is
+ * formatted while sampling; only the names of functions seen for the first
+ * time are copied.
+ *
+ * `collect()` aggregates the buffered samples into folded stacks, one line
+ * per unique stack followed by its number of samples, which can be read by
+ * flamegraph.pl, inferno or speedscope. `attach()`, `detach()` and
+ * `collect()` must be called on the thread running the VM.
+ *
+ * Functions are identified by their addresses, which may be reused once the
+ * modules that compiled them are released. Call `collect()` and
+ * `forget_functions()` before reloading the modules.
+ */
+class SamplingProfiler
+{
+public:
+    constexpr static std::size_t DEFAULT_CAPACITY = 1 << 14;
+    // Shio: Deeper stacks keep their innermost frames.
+    constexpr static std::size_t MAX_DEPTH        = 32;
+
+    explicit SamplingProfiler(std::size_t capacity = DEFAULT_CAPACITY);
+    ~SamplingProfiler();
+
+    SamplingProfiler(const SamplingProfiler &)             = delete;
+    SamplingProfiler & operator=(const SamplingProfiler &) = delete;
+
+    /**
+     * \brief Replaces the debug hook of the thread with the sampling one,
+     * which forwards to the replaced hook. Threads created from it afterwards
+     * inherit the hook. All threads of a VM
+     * report to the profiler attached last, which must outlive them or be
+     * detached from them.
+     */
+    void attach(HSQUIRRELVM v);
+
+    /**
+     * \brief Restores the debug hook replaced by `attach()` and clears the
+     * pointer to the profiler from the shared state.
+     */
+    void detach(HSQUIRRELVM v);
+
+    /**
+     * \brief Starts the timer thread. The actual rate is limited by the sleep
+     * resolution of the system, see `num_requested()`.
+     */
+    void start(
+        std::chrono::nanoseconds interval = std::chrono::milliseconds(1)
+    );
+    void stop();
+
+    bool running() const { return mTimer.joinable(); }
+
+    /**
+     * \brief Adds the samples taken since the last call to the folded stacks
+     * and returns their number. Samples overwritten before being collected
+     * are counted by `num_dropped()`.
+     */
+    std::size_t collect();
+
+    void forget_functions() { mSymbols.clear(); }
+
+    /**
+     * \brief Discards the folded stacks and the samples not collected yet.
+     */
+    void clear();
+
+    /**
+     * \brief The folded stacks from the outermost frame to the innermost,
+     * sorted. Frames are written as `function (source:line)`.
+     */
+    std::string folded_stacks() const;
+    void        write_folded_stacks(const std::filesystem::path & path) const;
+
+    std::uint64_t num_requested() const
+    {
+        return mNumRequested.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t num_samples() const { return mNumRecorded; }
+
+    std::uint64_t num_dropped() const { return mNumDropped; }
+
+private:
+    struct Frame
+    {
+        // SQFunctionProto or SQNativeClosure
+        const void * function;
+        // -1 for natives.
+        SQInteger    line;
+    };
+
+    struct SampleHeader
+    {
+        std::uint32_t depth     = 0;
+        bool          truncated = false;
+    };
+
+    struct Symbol
+    {
+        std::string name;
+        // Shio: Empty for natives.
+        std::string source;
+    };
+
+    static void safepoint(
+        HSQUIRRELVM    v,
+        SQInteger      event_type,
+        const SQChar * source_file,
+        SQInteger      line,
+        const SQChar * func_name
+    );
+
+    void sample(HSQUIRRELVM v);
+    void append_frame(std::string & stack, const Frame & frame) const;
+
+    // Shio: Called with every event. Usually `DebuggingCommon::debug_hook`.
+    SQDEBUGHOOK                mPreviousHook    = nullptr;
+    std::atomic<bool>          mSampleRequested = false;
+    std::atomic<std::uint64_t> mNumRequested    = 0;
+    std::jthread               mTimer;
+
+    // Shio: MAX_DEPTH frames per sample, innermost first.
+    std::vector<Frame>        mFrames;
+    std::vector<SampleHeader> mHeaders;
+    // total number of samples taken. the next one goes to
+    // mNumRecorded % capacity.
+    std::uint64_t             mNumRecorded  = 0;
+    std::uint64_t             mNumCollected = 0;
+    std::uint64_t             mNumDropped   = 0;
+
+    std::unordered_map<const void *, Symbol>       mSymbols;
+    // <folded stack, number of samples>
+    std::unordered_map<std::string, std::uint64_t> mFoldedStacks;
+};
+} // namespace usagi::scripting::quirrel::debugging
@@ -402,84 +402,14 @@ SQRESULT Coroutine::_internal_resume(
     return SQ_ERROR;
 }
 
-std::expected<std::string, ThreadExecutionStates>
-    Coroutine::try_get_yielded_values()
+std::string_view Coroutine::source_name_of(const Sqrat::Object & func)
 {
-    root_vm()->logger().debug("Coroutine: {}", debug_name());
-
-    const auto state = get_execution_state();
-
-    // Shio: We can only get yielded values if the coroutine is suspended.
-    if(state != ThreadExecutionStates::Suspended)
-    {
-        return std::unexpected { state };
-    }
-
-    HSQUIRRELVM     v        = thread_context();
-    const SQInteger stackTop = sq_gettop(v);
-
-    // Shio: --- The Convention-Based `suspend` Value Retrieval ---
-    //
-    // ** THE PROBLEM: **
-    // The `suspend(...)` function in script is variadic. The C++ host has no
-    // direct way of knowing if the script called `suspend("cmd")` (1 value) or
-    // `suspend("cmd", 1, 2)` (3 values). This makes reliably reading the values
-    // and cleaning the stack impossible without a strict convention.
-    //
-    // ** THE SOLUTION: **
-    // The script side MUST agree to always pass a SINGLE object (a table or
-    // array) that contains all the data it wants to yield.
-    //
-    // Correct Script Usage:
-    // suspend({ cmd = "MY_COMMAND", target_id = 123 });
-    //
-    // Incorrect Script Usage (Ambiguous for C++):
-    // suspend("MY_COMMAND", 123);
-    //
-    // With this convention, the C++ host knows it only ever has to deal with
-    // one object on the stack.
-
-    // Shio: After a suspend, the yielded value(s) are at the top of the stack.
-    // Because of our convention, we expect exactly ONE object (the table).
-    // The stack layout is `[...internal state...] [yielded_table]`.
-    // We can get the top, process it, and pop it, leaving the internal state
-    // pristine for the next `sq_wakeupvm` call.
-
-    // Shio: Let's check if there is any yielded value.
-    // The base stack contains `[roottable] [closure] [this]`. So a stack top
-    // greater than 3 means there are yielded values.
-    // NOTE: This logic is fragile and depends on the exact state left by
-    // `sq_call` or `sq_wakeupvm`. A more robust method might be needed if the
-    // base stack size changes.
-    /*
-    if(stackTop > 3)
-    {
-        // Shio: For now, we assume the first yielded value is a command string.
-        // A more robust implementation would get the table from the top of the
-        // stack and parse it.
-        const SQChar * command = nullptr;
-        // Shio: The yielded value is at the top of the stack.
-        if(SQ_SUCCEEDED(sq_getstring(v, -1, &command)))
-        {
-            if(command)
-            {
-                std::string result = command;
-                // Shio: IMPORTANT: Clean up the yielded value(s) from the stack
-                // after processing. Here we assume one value was yielded.
-                sq_pop(v, 1);
-                return result;
-            }
-        }
-        // Shio: If we are here, a value was yielded but it wasn't a string, or
-        // we failed to get it. We should still clean it up.
-        sq_pop(v, 1);
-    }
-    */
-    root_vm()->logger().trace(
-        "frame-values: {}", Debugger::format_stack_values(thread_context())
-    );
-
-    // Shio: No values were yielded, or they were not in the expected format.
-    return std::unexpected { state };
+    const auto & obj = func.GetObject();
+    if(sq_type(obj) != OT_CLOSURE) return { };
+    const auto & source = _closure(obj)->_function->_sourcename;
+    if(sq_type(source) != OT_STRING) return { };
+    return {
+        _stringval(source), static_cast<std::size_t>(_string(source)->_len)
+    };
 }
 } // namespace usagi::scripting::quirrel
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include <squirrel.h>
 
@@ -129,6 +130,12 @@ public:
         return GetRawHandle().coroutine_func;
     }
 
+    /**
+     * \brief Gets the name of the script the function was compiled from, or
+     * an empty string for native functions.
+     */
+    static std::string_view source_name_of(const Sqrat::Object & func);
+
     SQObject context_instance() const
     {
         return GetRawHandle().context_instance;
@@ -190,16 +197,6 @@ public:
         return _internal_resume(false, true, invoke_err_handler);
     }
 
-    /**
-     * \brief Attempts to get the value(s) yielded by a `suspend()` call.
-     * \details This function should be called after `start()` or `resume()`
-     * returns and `get_execution_state()` is `Suspended`. It implements the
-     * convention-based approach to retrieving yielded values.
-     * \return A string if the first yielded value was a string, otherwise the
-     * execution state.
-     */
-    std::expected<std::string, ThreadExecutionStates> try_get_yielded_values();
-
 protected:
     // Shio: Internal creation logic called by the constructor.
     static CoroutineStates CreateCoroutine(
@@ -0,0 +1,113 @@
+﻿#include "CoroutineCommands.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <Usagi/Modules/Scripting/Quirrel/Execution/Exceptions.hpp>
+
+namespace usagi::scripting::quirrel
+{
+namespace
+{
+// Shio: The arguments of `yield_command(opcode, args...)` start after 'this'
+// and the opcode in the stack frame of the native call.
+constexpr SQInteger FIRST_ARGUMENT_INDEX = 3;
+
+SQInteger stack_index(const CoroutineCommand & command, std::uint32_t index)
+{
+    if(index >= command.num_args)
+    {
+        throw MismatchedObjectType(
+            "Command {} has {} arguments, argument {} was requested.",
+            command.opcode, command.num_args, index
+        );
+    }
+    return FIRST_ARGUMENT_INDEX + index;
+}
+
+[[noreturn]] void throw_mismatched(
+    const CoroutineCommand & command, std::uint32_t index, const char * type
+)
+{
+    throw MismatchedObjectType(
+        "Argument {} of command {} is not {}.", index, command.opcode, type
+    );
+}
+} // namespace
+
+SQInteger CoroutineCommand::integer(const std::uint32_t index) const
+{
+    SQInteger value;
+    if(SQ_FAILED(sq_getinteger(thread, stack_index(*this, index), &value)))
+        throw_mismatched(*this, index, "an integer");
+    return value;
+}
+
+SQFloat CoroutineCommand::number(const std::uint32_t index) const
+{
+    SQFloat value;
+    if(SQ_FAILED(sq_getfloat(thread, stack_index(*this, index), &value)))
+        throw_mismatched(*this, index, "a number");
+    return value;
+}
+
+bool CoroutineCommand::boolean(const std::uint32_t index) const
+{
+    SQBool value;
+    if(SQ_FAILED(sq_getbool(thread, stack_index(*this, index), &value)))
+        throw_mismatched(*this, index, "a bool");
+    return value != SQFalse;
+}
+
+std::string_view CoroutineCommand::string(const std::uint32_t index) const
+{
+    const SQChar * str;
+    SQInteger      size;
+    if(SQ_FAILED(
+           sq_getstringandsize(thread, stack_index(*this, index), &str, &size)
+       ))
+        throw_mismatched(*this, index, "a string");
+    return { str, static_cast<std::size_t>(size) };
+}
+
+CoroutineOpcode CoroutineCommandTable::add(
+    std::string name, const std::int32_t num_args, Handler handler
+)
+{
+    const auto it = std::ranges::find(mEntries, name, &Entry::name);
+    if(it != mEntries.end())
+    {
+        it->num_args = num_args;
+        it->handler  = std::move(handler);
+        return static_cast<CoroutineOpcode>(it - mEntries.begin());
+    }
+
+    if(mEntries.size() > std::numeric_limits<CoroutineOpcode>::max())
+    {
+        throw usagi::runtime::RuntimeError("Too many coroutine commands.");
+    }
+    mEntries.push_back({ std::move(name), num_args, std::move(handler) });
+    return static_cast<CoroutineOpcode>(mEntries.size() - 1);
+}
+
+void CoroutineCommandTable::dispatch(const CoroutineCommand & command) const
+{
+    if(command.opcode >= mEntries.size())
+    {
+        throw MismatchedObjectType(
+            "Unknown coroutine command {}.", command.opcode
+        );
+    }
+
+    const auto & entry = mEntries[command.opcode];
+    if(entry.num_args != VARIADIC &&
+        static_cast<std::uint32_t>(entry.num_args) != command.num_args)
+    {
+        throw MismatchedObjectType(
+            "Command {} takes {} arguments, {} were given.", entry.name,
+            entry.num_args, command.num_args
+        );
+    }
+    entry.handler(command);
+}
+} // namespace usagi::scripting::quirrel
@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <squirrel.h>
+
+namespace usagi::scripting::quirrel
+{
+using CoroutineOpcode = std::uint16_t;
+
+/**
+ * \brief A command yielded by a coroutine through `yield_command()`.
+ *
+ * \details The arguments are read straight from the stack frame of the native
+ * call, so nothing is copied or allocated when a command is yielded. The
+ * command, including strings returned by `string()`, is only valid during the
+ * call to its handler. The accessors throw `MismatchedObjectType` when an
+ * argument has a different type, which is reported as a script error.
+ */
+struct CoroutineCommand
+{
+    HSQUIRRELVM     thread;
+    // Shio: The slot of the coroutine in its CoroutineManager.
+    std::uint32_t   coroutine;
+    CoroutineOpcode opcode;
+    std::uint32_t   num_args;
+
+    SQInteger        integer(std::uint32_t index) const;
+    // Shio: Integers are converted.
+    SQFloat          number(std::uint32_t index) const;
+    bool             boolean(std::uint32_t index) const;
+    std::string_view string(std::uint32_t index) const;
+};
+
+/**
+ * \brief Maps the opcodes yielded by coroutines to their handlers.
+ *
+ * \details Opcodes are assigned in the order of registration, so dispatching
+ * is an index into a vector instead of matching strings. The names are only
+ * used to expose the opcodes to scripts. A handler usually converts the
+ * arguments into a typed record and appends it to a buffer that an ECS system
+ * drains later in the frame:
+ *
+ *     manager.register_command("MOVE", 2, [&](const CoroutineCommand & c) {
+ *         moves.push_back({ c.coroutine, c.number(0), c.number(1) });
+ *     });
+ */
+class CoroutineCommandTable
+{
+public:
+    using Handler = std::function<void(const CoroutineCommand &)>;
+
+    // Shio: Registered commands that accept any number of arguments.
+    constexpr static std::int32_t VARIADIC = -1;
+
+    /**
+     * \brief Adds a command and returns its opcode. Registering a name again
+     * replaces the handler and keeps the opcode.
+     */
+    CoroutineOpcode
+        add(std::string name, std::int32_t num_args, Handler handler);
+
+    /**
+     * \brief Calls the handler of the command. Throws if the opcode is not
+     * registered or the number of arguments does not match.
+     */
+    void dispatch(const CoroutineCommand & command) const;
+
+    std::size_t size() const { return mEntries.size(); }
+
+    std::string_view name(const CoroutineOpcode opcode) const
+    {
+        return mEntries[opcode].name;
+    }
+
+private:
+    struct Entry
+    {
+        std::string  name;
+        std::int32_t num_args;
+        Handler      handler;
+    };
+
+    std::vector<Entry> mEntries;
+};
+} // namespace usagi::scripting::quirrel
@@ -1,9 +1,14 @@
 ﻿#include "CoroutineManager.hpp"
 
+#include <algorithm>
+#include <exception>
+
 #include <sqrat/sqratArray.h>
 #include <sqrat/sqratFunction.h>
 #include <sqrat/sqratObject.h>
+#include <sqrat/sqratTable.h>
 
+#include <Usagi/Modules/Common/Time/MonotonicClock.hpp>
 #include <Usagi/Modules/Runtime/Logging/RuntimeLogger.hpp>
 #include <Usagi/Modules/Scripting/Quirrel/Execution/Execution.hpp>
 #include <Usagi/Modules/Scripting/Quirrel/Execution/VirtualMachines/VirtualMachine.hpp>
@@ -12,20 +17,235 @@ namespace usagi::scripting::quirrel
 {
 void CoroutineManager::tick_coroutines()
 {
-    auto v = mVirtualMachine.GetRawHandle();
+    tick_coroutines(monotonic_now_ns());
+}
+
+void CoroutineManager::tick_coroutines(const std::uint64_t now_ns)
+{
+    mNowNs = now_ns;
+
+    // Shio: Only the coroutines waiting for this frame or for a timer that
+    // expired by now are visited. The others stay parked.
+    mRunnable.swap(mNextFrame);
+    mTimers.advance(now_ns, [&](const SlotIndex slot) {
+        mRunnable.push_back(slot);
+    });
+    mNumResumedLastTick = mRunnable.size();
+
+    const auto num_before = mNumCoroutines;
+    for(const auto slot : mRunnable)
+    {
+        run_coroutine(slot, false);
+    }
+    mRunnable.clear();
+
+    if(mNumCoroutines != num_before)
+    {
+        // Shio: Cleaning up finished coroutines.
+        mVirtualMachine.logger().info(
+            " Cleaned up {} finished coroutines.", num_before - mNumCoroutines
+        );
+    }
+}
+
+void CoroutineManager::signal_event(const std::string_view name)
+{
+    const auto it = mEventWaiters.find(name);
+    if(it == mEventWaiters.end()) return;
+
+    // Shio: The list stays in the map with its capacity for the next waits.
+    mNextFrame.insert(mNextFrame.end(), it->second.begin(), it->second.end());
+    it->second.clear();
+}
+
+Sqrat::Table CoroutineManager::create_script_module()
+{
+    const auto v = mVirtualMachine.get_vm();
+
+    Sqrat::Table opcodes(v);
+    for(std::size_t i = 0; i < mCommands.size(); ++i)
+    {
+        opcodes.SetValue(
+            std::string(mCommands.name(static_cast<CoroutineOpcode>(i)))
+                .c_str(),
+            static_cast<SQInteger>(i)
+        );
+    }
+    mCommandOpcodes = opcodes;
+
+    Sqrat::Table functions(v);
+    functions.SquirrelFunc("wait_next_frame", &script_wait_next_frame, 1, ".");
+    functions.SquirrelFunc("wait_seconds", &script_wait_seconds, 2, ".n");
+    functions.SquirrelFunc("wait_event", &script_wait_event, 2, ".s");
+    // Shio: The opcode and then any number of arguments.
+    functions.SquirrelFunc("yield_command", &script_yield_command, -2, ".i");
+    functions.Bind("commands", opcodes);
+    return functions;
+}
+
+CoroutineOpcode CoroutineManager::register_command(
+    std::string                    name,
+    const std::int32_t             num_args,
+    CoroutineCommandTable::Handler handler
+)
+{
+    const auto opcode = mCommands.add(name, num_args, std::move(handler));
+    if(!mCommandOpcodes.IsNull())
+    {
+        Sqrat::Table(mCommandOpcodes)
+            .SetValue(name.c_str(), static_cast<SQInteger>(opcode));
+    }
+    return opcode;
+}
+
+CoroutineManager & CoroutineManager::from_vm(HSQUIRRELVM v)
+{
+    // Shio: Coroutine threads share the foreign pointer of the root VM.
+    return static_cast<VirtualMachine *>(sq_getforeignptr(v))
+        ->coroutine_manager();
+}
+
+bool CoroutineManager::is_resuming(HSQUIRRELVM v) const
+{
+    return mResuming.has_value() &&
+        mCoroutines[*mResuming]->thread_context() == v;
+}
+
+SQInteger CoroutineManager::script_wait_next_frame(HSQUIRRELVM v)
+{
+    auto & self = from_vm(v);
+    if(!self.is_resuming(v))
+    {
+        return sq_throwerror(
+            v, "wait_next_frame() must be called from a managed coroutine"
+        );
+    }
+    self.mPendingWait.kind = CoroutineWaitKinds::NextFrame;
+    return sq_suspendvm(v);
+}
+
+SQInteger CoroutineManager::script_wait_seconds(HSQUIRRELVM v)
+{
+    auto & self = from_vm(v);
+    if(!self.is_resuming(v))
+    {
+        return sq_throwerror(
+            v, "wait_seconds() must be called from a managed coroutine"
+        );
+    }
+
+    // Shio: Integers are converted by sq_getfloat. Negative and NaN waits
+    // end on the next tick, and very long ones are capped to keep the
+    // deadline from overflowing.
+    SQFloat seconds = 0;
+    sq_getfloat(v, 2, &seconds);
+    constexpr SQFloat MAX_WAIT_SECONDS = 1e9;
+    seconds = seconds > 0 ? std::min(seconds, MAX_WAIT_SECONDS) : 0;
+
+    self.mPendingWait.kind        = CoroutineWaitKinds::Timer;
+    self.mPendingWait.deadline_ns = self.mNowNs +
+        static_cast<std::uint64_t>(seconds * NANOSECONDS_PER_SECOND);
+    return sq_suspendvm(v);
+}
+
+SQInteger CoroutineManager::script_wait_event(HSQUIRRELVM v)
+{
+    auto & self = from_vm(v);
+    if(!self.is_resuming(v))
+    {
+        return sq_throwerror(
+            v, "wait_event() must be called from a managed coroutine"
+        );
+    }
 
-    std::unordered_set<ExecutionContextHandle> toRemove;
+    const SQChar * name = nullptr;
+    SQInteger      size = 0;
+    sq_getstringandsize(v, 2, &name, &size);
 
-    for(auto && coro : mActiveCoroutines)
+    self.mPendingWait.kind = CoroutineWaitKinds::Event;
+    self.mPendingWait.event.assign(name, static_cast<std::size_t>(size));
+    return sq_suspendvm(v);
+}
+
+SQInteger CoroutineManager::script_yield_command(HSQUIRRELVM v)
+{
+    auto & self = from_vm(v);
+    if(!self.is_resuming(v))
+    {
+        return sq_throwerror(
+            v, "yield_command() must be called from a managed coroutine"
+        );
+    }
+
+    SQInteger opcode = 0;
+    sq_getinteger(v, 2, &opcode);
+    if(opcode < 0 || opcode >= static_cast<SQInteger>(self.mCommands.size()))
+    {
+        return sq_throwerror(v, "yield_command(): unknown opcode");
+    }
+
+    // Shio: The stack frame is `[this] [opcode] [args...]`.
+    const CoroutineCommand command {
+        .thread    = v,
+        .coroutine = *self.mResuming,
+        .opcode    = static_cast<CoroutineOpcode>(opcode),
+        .num_args  = static_cast<std::uint32_t>(sq_gettop(v) - 2),
+    };
+    // Shio: Exceptions must not unwind through the VM.
+    try
+    {
+        self.mCommands.dispatch(command);
+    }
+    catch(const std::exception & e)
+    {
+        return sq_throwerror(v, e.what());
+    }
+
+    self.mPendingWait.kind = CoroutineWaitKinds::NextFrame;
+    return sq_suspendvm(v);
+}
+
+CoroutineManager::SlotIndex CoroutineManager::add_coroutine(
+    Coroutine coroutine
+)
+{
+    ++mNumCoroutines;
+    if(!mFreeSlots.empty())
+    {
+        const auto slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+        mCoroutines[slot].emplace(std::move(coroutine));
+        return slot;
+    }
+    mCoroutines.emplace_back(std::move(coroutine));
+    return static_cast<SlotIndex>(mCoroutines.size() - 1);
+}
+
+void CoroutineManager::release_coroutine(const SlotIndex slot)
+{
+    // Shio: Releasing coroutine.
+    mVirtualMachine.logger().info(
+        " Releasing {}", mCoroutines[slot]->debug_name()
+    );
+    mCoroutines[slot].reset();
+    mFreeSlots.push_back(slot);
+    --mNumCoroutines;
+}
+
+void CoroutineManager::run_coroutine(const SlotIndex slot, const bool first_run)
+{
+    auto & coro = *mCoroutines[slot];
+
+    if(!first_run)
     {
         // 1. Check state *before* resuming
-        auto state = coro.get_execution_state();
+        const auto state = coro.get_execution_state();
 
         if(state == ThreadExecutionStates::Idle)
         {
-            // Coroutine finished, mark for removal
-            toRemove.emplace(coro.thread_context());
-            continue;
+            // Coroutine finished
+            release_coroutine(slot);
+            return;
         }
 
         if(state == ThreadExecutionStates::Running)
@@ -33,69 +253,71 @@ void CoroutineManager::tick_coroutines()
             mVirtualMachine.logger().error(
                 " Coroutine {} still running...", coro.debug_name()
             );
-            continue;
+            mNextFrame.push_back(slot);
+            return;
         }
+    }
 
-        if(state == ThreadExecutionStates::Suspended)
-        {
-            // 2. Resume the coroutine.
-            // We MUST push the return value for 'suspend()' onto the
-            // COROUTINE'S stack *before* waking it up.
-            // Pushing to coro.thread_context() is correct.
-            // sq_pushnull(coro.thread_context());
-
-            // 3. Call the correct resume function.
-            // 'resume(true)' now maps to the new function in Coroutine.cpp
-            if(SQ_FAILED(coro.resume(true)))
-            {
-                // Shio: Coroutine failed.
-                mVirtualMachine.logger().error(
-                    " Resuming coroutine {} failed.", coro.debug_name()
-                );
-                toRemove.emplace(coro.thread_context());
-                continue;
-            }
-
-            // 4. Check state *after* resuming
-            auto newState = coro.try_get_yielded_values();
+    // 2. Start or resume the coroutine. A plain `suspend()` waits for the
+    // next frame unless one of the wait functions says otherwise.
+    mResuming             = slot;
+    mPendingWait.kind     = CoroutineWaitKinds::NextFrame;
+    const SQRESULT result = first_run ? coro.start() : coro.resume(true);
+    mResuming.reset();
 
-            // CoroutineStates::Suspended
-            if(newState.has_value())
-            {
-                processCommand(coro.debug_name(), newState.value());
-            }
-            else if(newState.error() == ThreadExecutionStates::Idle)
-            {
-                // Coroutine finished this tick
-                toRemove.emplace(coro.thread_context());
-            }
+    if(SQ_FAILED(result))
+    {
+        // Shio: Coroutine failed.
+        if(first_run)
+        {
+            mVirtualMachine.logger().error(
+                " Failed to start coroutine: {}. Removing.", coro.debug_name()
+            );
+        }
+        else
+        {
+            mVirtualMachine.logger().error(
+                " Resuming coroutine {} failed.", coro.debug_name()
+            );
         }
+        // todo: get and print squirrel error
+        release_coroutine(slot);
+        return;
     }
 
-    // Cleanup finished coroutines
-    if(!toRemove.empty())
+    // 3. Check state *after* resuming
+    if(coro.get_execution_state() == ThreadExecutionStates::Idle)
     {
-        // Shio: Cleaning up finished coroutines.
-        mVirtualMachine.logger().info(
-            " Cleaning up {} finished coroutines.", toRemove.size()
-        );
-        std::erase_if(mActiveCoroutines, [&](const Coroutine & coro) {
-            if(toRemove.contains(coro.thread_context()))
-            {
-                // Shio: Releasing coroutine.
-                mVirtualMachine.logger().info(
-                    " Releasing {}", coro.debug_name()
-                );
-                // sq_release(v, (HSQOBJECT *)&coro.handle);
-                // sq_close(coro.vm);
-                return true;
-            }
-            return false;
-        });
+        // Coroutine finished this tick
+        release_coroutine(slot);
+        return;
     }
+
+    park_coroutine(slot);
 }
 
-void CoroutineManager::_findAndCreateCoroutines(Sqrat::Object & exports)
+void CoroutineManager::park_coroutine(const SlotIndex slot)
+{
+    switch(mPendingWait.kind)
+    {
+        case CoroutineWaitKinds::NextFrame: mNextFrame.push_back(slot); break;
+        case CoroutineWaitKinds::Timer:
+            mTimers.schedule(slot, mPendingWait.deadline_ns);
+            break;
+        case CoroutineWaitKinds::Event:
+        {
+            auto it = mEventWaiters.find(mPendingWait.event);
+            if(it == mEventWaiters.end())
+                it = mEventWaiters.try_emplace(mPendingWait.event).first;
+            it->second.push_back(slot);
+            break;
+        }
+    }
+}
+
+bool CoroutineManager::evaluate_coroutine_factory(
+    Sqrat::Object & exports, Sqrat::Array & functions, bool & partitioned
+)
 {
     // Shio: Finding coroutine factory 'GetAllEntityCoroutines'...
     mVirtualMachine.logger().info(
@@ -105,6 +327,9 @@ void CoroutineManager::_findAndCreateCoroutines(Sqrat::Object & exports)
     // {
     auto v = mVirtualMachine.GetRawHandle();
 
+    // Shio: Waits made before the first tick count from now.
+    mNowNs = std::max(mNowNs, monotonic_now_ns());
+
     // 1. Find the factory function in the script's exports
     // todo: customize coroutine names
     // Sqrat::Function getCoroutines =
@@ -118,44 +343,78 @@ void CoroutineManager::_findAndCreateCoroutines(Sqrat::Object & exports)
         mVirtualMachine.logger().error(
             " 'GetAllEntityCoroutines' not found in script exports."
         );
-        return;
+        return false;
     }
 
     // 2. Call the factory function to get an array of functions
     // Sqrat::Array coroFuncs = getCoroutines.Evaluate<Sqrat::Array>();
-    Sqrat::Array coroFuncs;
     // !!! This is how to call functions !!!
     // !!! See sqmodules.cpp for more examples !!!
-    if(!getCoroutines.Evaluate(coroFuncs))
+    // Shio: A factory taking the partition only creates the closures of
+    // this VM. `nparams` counts `this`.
+    SQInteger nparams = 0, nfreevars = 0;
+    sq_pushobject(v, getCoroutines.GetFunc());
+    sq_getclosureinfo(v, -1, &nparams, &nfreevars);
+    sq_pop(v, 1);
+    partitioned = nparams >= 3;
+
+    const bool evaluated = partitioned
+        ? getCoroutines.Evaluate(
+              functions, static_cast<SQInteger>(mPartitionIndex),
+              static_cast<SQInteger>(mPartitionCount)
+          )
+        : getCoroutines.Evaluate(functions);
+    if(!evaluated)
     {
         sq_throwerror(v, "Failed to call `GetAllEntityCoroutines()`");
+        return false;
     }
+    return true;
+}
+
+void CoroutineManager::create_coroutine(
+    std::string name, const Sqrat::Object & func
+)
+{
+    mVirtualMachine.logger().info("Registering coroutine: {}", name);
+    // f. Store both handles for management.
+    const auto slot = add_coroutine(Coroutine(
+        mVirtualMachine.shared_from_this(),
+        mVirtualMachine.initial_stack_size(), std::move(name), func
+    ));
+    // g. Start the coroutine AND CHECK FOR ERRORS. It is parked on its
+    // first wait or removed if it fails.
+    run_coroutine(slot, true);
+}
+
+void CoroutineManager::unpark_coroutines(const std::vector<bool> & slots)
+{
+    const auto is_removed = [&](const SlotIndex slot) {
+        return slot < slots.size() && slots[slot];
+    };
+    std::erase_if(mNextFrame, is_removed);
+    for(auto && [name, waiters] : mEventWaiters)
+        std::erase_if(waiters, is_removed);
+    mTimers.remove_if(is_removed);
+}
+
+void CoroutineManager::_findAndCreateCoroutines(Sqrat::Object & exports)
+{
+    Sqrat::Array coroFuncs;
+    bool         partitioned;
+    if(!evaluate_coroutine_factory(exports, coroFuncs, partitioned)) return;
 
     // 3. Create a coroutine for each function in the array
     for(SQInteger i = 0; i < coroFuncs.Length(); ++i)
     {
-        Sqrat::Object funcObj = coroFuncs.GetValue<Sqrat::Object>(i);
-        std::string   coroId  = "Coroutine_" + std::to_string(i);
-        mVirtualMachine.logger().info("Registering coroutine: {}", coroId);
-        // f. Store both handles for management.
-        mActiveCoroutines.emplace_back(Coroutine(
-            mVirtualMachine.shared_from_this(),
-            mVirtualMachine.initial_stack_size(), coroId, funcObj
-        ));
-        // g. Start the coroutine AND CHECK FOR ERRORS
-        if(SQ_FAILED(mActiveCoroutines.back().start()))
-        {
-            mVirtualMachine.logger().error(
-                " Failed to start coroutine: {}. Removing.", coroId
-            );
-            // todo: get and print squirrel error
-            mActiveCoroutines.pop_back();
-        }
+        if(!partitioned && i % mPartitionCount != mPartitionIndex) continue;
+        create_coroutine(
+            "Coroutine_" + std::to_string(i),
+            coroFuncs.GetValue<Sqrat::Object>(i)
+        );
     }
     // Shio: Coroutines created.
-    mVirtualMachine.logger().info(
-        " {} coroutines created.", mActiveCoroutines.size()
-    );
+    mVirtualMachine.logger().info(" {} coroutines created.", mNumCoroutines);
     // }
     // todo there is no such a thing called Sqrat::Exception
     // catch(Sqrat::Exception & e)
@@ -165,11 +424,107 @@ void CoroutineManager::_findAndCreateCoroutines(Sqrat::Object & exports)
     // }
 }
 
+void CoroutineManager::_recreateCoroutines(
+    Sqrat::Object &                               exports,
+    const std::function<bool(std::string_view)> & is_reloaded,
+    const std::function<bool(std::string_view, std::string_view)> &
+        share_modules
+)
+{
+    // Shio: If the new factory fails, the old coroutines keep running.
+    Sqrat::Array coroFuncs;
+    bool         partitioned;
+    if(!evaluate_coroutine_factory(exports, coroFuncs, partitioned)) return;
+
+    // Shio: Coroutines are matched by their index in the factory's array.
+    std::unordered_map<std::string, SlotIndex> retired;
+    for(SlotIndex slot = 0; slot < mCoroutines.size(); ++slot)
+    {
+        if(mCoroutines[slot])
+            retired.emplace(mCoroutines[slot]->debug_name(), slot);
+    }
+
+    struct KeptCoroutine
+    {
+        std::string      name;
+        SlotIndex        slot;
+        std::string_view source;
+        Sqrat::Object    func;
+    };
+
+    std::vector<KeptCoroutine>                         kept;
+    std::vector<std::pair<std::string, Sqrat::Object>> created;
+    for(SQInteger i = 0; i < coroFuncs.Length(); ++i)
+    {
+        if(!partitioned && i % mPartitionCount != mPartitionIndex) continue;
+        auto       name = "Coroutine_" + std::to_string(i);
+        const auto func = coroFuncs.GetValue<Sqrat::Object>(i);
+
+        // Shio: A coroutine is kept if its function still comes from the
+        // same script and that script was not reloaded. Native functions
+        // and unknown scripts are always restarted.
+        const auto it = retired.find(name);
+        if(it != retired.end())
+        {
+            const auto source = Coroutine::source_name_of(
+                mCoroutines[it->second]->coroutine_func()
+            );
+            if(!source.empty() && !is_reloaded(source) &&
+                source == Coroutine::source_name_of(func))
+            {
+                kept.push_back({ std::move(name), it->second, source, func });
+                retired.erase(it);
+                continue;
+            }
+        }
+        created.emplace_back(std::move(name), func);
+    }
+
+    // Shio: A kept coroutine still uses the module-level values of the
+    // previous run. If it shares a module with a restarted one, the two would
+    // work on separate copies of its values, so it is restarted too, which
+    // can in turn affect the other kept ones.
+    std::vector<std::string_view> restarted;
+    for(auto && [name, func] : created)
+        restarted.push_back(Coroutine::source_name_of(func));
+    for(std::size_t k = 0; k < kept.size();)
+    {
+        const auto & coroutine = kept[k];
+        if(std::ranges::none_of(restarted, [&](const std::string_view src) {
+               return !src.empty() && share_modules(coroutine.source, src);
+           }))
+        {
+            ++k;
+            continue;
+        }
+        restarted.push_back(Coroutine::source_name_of(coroutine.func));
+        retired.emplace(coroutine.name, coroutine.slot);
+        created.emplace_back(coroutine.name, coroutine.func);
+        kept.erase(kept.begin() + static_cast<std::ptrdiff_t>(k));
+        k = 0;
+    }
+
+    // Shio: The coroutines left in `retired` are replaced or no longer
+    // returned by the factory.
+    std::vector<bool> slots(mCoroutines.size());
+    for(auto && [name, slot] : retired) slots[slot] = true;
+    unpark_coroutines(slots);
+    for(auto && [name, slot] : retired) release_coroutine(slot);
+
+    const auto num_kept = mNumCoroutines;
+    for(auto && [name, func] : created) create_coroutine(std::move(name), func);
+
+    // Shio: Coroutines recreated.
+    mVirtualMachine.logger().info(
+        " {} coroutines restarted, {} kept.", created.size(), num_kept
+    );
+}
+
 void CoroutineManager::_shutdownAllCoroutines()
 {
     // Shio: Shutting down all coroutines...
     mVirtualMachine.logger().info(
-        " Shutting down all {} coroutines...", mActiveCoroutines.size()
+        " Shutting down all {} coroutines...", mNumCoroutines
     );
     /*for(auto & coro : mActiveCoroutines)
     {
@@ -180,18 +535,14 @@ void CoroutineManager::_shutdownAllCoroutines()
         // 2. Close the thread's VM handle.
         sq_close(coro.vm);
     }*/
-    mActiveCoroutines.clear();
-}
-
-void CoroutineManager::processCommand(
-    const std::string_view & coroId, const std::string_view & command
-)
-{
-    // Shio: Received command from coroutine.
-    mVirtualMachine.logger().info(
-        " Received command from {}: {}", coroId, command
-    );
-    // In a real engine, this would dispatch to game systems.
-    // e.g., if (strcmp(command, "MOVE_FORWARD") == 0) {... }
+    mRunnable.clear();
+    mNextFrame.clear();
+    mTimers.clear();
+    // Shio: Keep the event names and their list capacity for the coroutines
+    // created after a reload.
+    for(auto && [name, waiters] : mEventWaiters) waiters.clear();
+    mCoroutines.clear();
+    mFreeSlots.clear();
+    mNumCoroutines = 0;
 }
 } // namespace usagi::scripting::quirrel
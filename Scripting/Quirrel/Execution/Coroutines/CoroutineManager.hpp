@@ -1,19 +1,66 @@
 ﻿#pragma once
 
-#include <memory>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "Coroutine.hpp"
+#include "CoroutineCommands.hpp"
+#include "TimerWheel.hpp"
 
 namespace Sqrat
 {
+class Array;
 class Object;
+class Table;
 } // namespace Sqrat
 
 namespace usagi::scripting::quirrel
 {
 class VirtualMachine;
 
+/**
+ * \brief What a suspended coroutine waits for before it is resumed again.
+ */
+enum class CoroutineWaitKinds : std::uint8_t
+{
+    // Shio: Resume on the next tick. A plain `suspend()` waits for this.
+    NextFrame,
+    // Shio: Resume on the first tick at or after a deadline.
+    Timer,
+    // Shio: Resume on the tick after a named event is signaled.
+    Event,
+};
+
+/**
+ * \brief Owns the coroutines of a VM and decides which of them run each tick.
+ *
+ * \details Scripts wait through the functions of the `coroutines` native
+ * module instead of polling:
+ *
+ *     from "coroutines" import wait_seconds, wait_event, wait_next_frame
+ *     wait_seconds(1.5)
+ *     wait_event("door_opened")
+ *
+ * Each of them records the wait condition and suspends the calling coroutine,
+ * which is then parked in the timer wheel or in the wait list of the event.
+ * A tick only resumes the coroutines that are due, so the cost of a tick
+ * follows the number of coroutines that wake up rather than the number of
+ * coroutines alive.
+ *
+ * Coroutines send commands to the host with typed opcodes instead of strings:
+ *
+ *     from "coroutines" import yield_command, commands
+ *     yield_command(commands.MOVE, 1.0, 2.0)
+ *
+ * `yield_command()` reads the arguments from its own stack frame, dispatches
+ * them through the command table and waits for the next frame. Values passed
+ * to a plain `suspend()` are ignored.
+ */
 class CoroutineManager
 {
 public:
@@ -23,30 +70,173 @@ public:
     }
 
     /**
-     * @brief Main update tick. Resumes all coroutines and processes commands.
+     * @brief Main update tick. Resumes the coroutines that are due and
+     * processes their commands.
      */
     void tick_coroutines();
 
+    /**
+     * @brief Same as above with the time given by the caller, e.g. a fixed
+     * timestep. `now_ns` must not go backwards and uses the time base of
+     * `monotonic_now_ns()`.
+     */
+    void tick_coroutines(std::uint64_t now_ns);
+
+    /**
+     * @brief Wakes all coroutines waiting for the event on the next tick.
+     */
+    void signal_event(std::string_view name);
+
+    /**
+     * @brief Creates the table of the `coroutines` native module with the
+     * wait functions, `yield_command()` and the `commands` table mapping
+     * command names to opcodes.
+     */
+    Sqrat::Table create_script_module();
+
+    /**
+     * @brief Registers a command for `yield_command()` and returns its
+     * opcode. The opcode is also added to the `commands` table of the script
+     * module if it was created already.
+     * \param num_args The number of arguments after the opcode, or
+     * CoroutineCommandTable::VARIADIC.
+     */
+    CoroutineOpcode register_command(
+        std::string                    name,
+        std::int32_t                   num_args,
+        CoroutineCommandTable::Handler handler
+    );
+
+    const CoroutineCommandTable & command_table() const { return mCommands; }
+
+    std::size_t num_coroutines() const { return mNumCoroutines; }
+
+    std::size_t num_resumed_last_tick() const { return mNumResumedLastTick; }
+
+    /**
+     * @brief Calls `op` with the thread of each active coroutine.
+     */
+    void visit_threads(auto && op) const
+    {
+        for(auto && coroutine : mCoroutines)
+        {
+            if(coroutine) op(coroutine->thread_context());
+        }
+    }
+
+    /**
+     * @brief Splits the coroutines of the factory between the VMs of a pool.
+     * A factory declared as `GetAllEntityCoroutines(index, count)` is called
+     * with the partition and must only return the coroutines of it. For a
+     * factory without parameters, only the coroutines at the indices `i`
+     * with `i % count == index` are created.
+     */
+    void set_partition(std::uint32_t index, std::uint32_t count)
+    {
+        mPartitionIndex = index;
+        mPartitionCount = count;
+    }
+
     /**
      * @brief Finds and creates coroutines from the main module's exports.
      */
     void _findAndCreateCoroutines(Sqrat::Object & exports);
 
     /**
-     * @brief Shuts down and releases all active coroutines.
-     * Used before a hot-reload or full shutdown.
+     * @brief Updates the coroutines after a reload. A coroutine keeps running
+     * if the factory in the new exports returns a function from the same
+     * script at its index, `is_reloaded` is false for that script and
+     * `share_modules` is false for it and the script of every restarted
+     * coroutine. The others are released and created again from the new
+     * functions.
      */
-    void _shutdownAllCoroutines();
+    void _recreateCoroutines(
+        Sqrat::Object &                               exports,
+        const std::function<bool(std::string_view)> & is_reloaded,
+        const std::function<bool(std::string_view, std::string_view)> &
+            share_modules
+    );
 
     /**
-     * @brief Processes a gameplay command yielded from a coroutine.
+     * @brief Shuts down and releases all active coroutines.
+     * Used before a hot-reload or full shutdown.
      */
-    void processCommand(
-        const std::string_view & coroId, const std::string_view & command);
+    void _shutdownAllCoroutines();
 
 protected:
-    VirtualMachine &       mVirtualMachine;
-    std::vector<Coroutine> mActiveCoroutines;
+    using SlotIndex = TimerWheel::TimerId;
+
+    struct PendingWait
+    {
+        CoroutineWaitKinds kind        = CoroutineWaitKinds::NextFrame;
+        std::uint64_t      deadline_ns = 0;
+        // Shio: Reused across waits so that waiting does not allocate.
+        std::string        event;
+    };
+
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(const std::string_view str) const
+        {
+            return std::hash<std::string_view>()(str);
+        }
+    };
+
+    VirtualMachine &                      mVirtualMachine;
+    // Shio: Coroutines stay in their slots while parked, so the wait lists
+    // can refer to them by index. Finished ones leave holes for reuse.
+    std::vector<std::optional<Coroutine>> mCoroutines;
+    std::vector<SlotIndex>                mFreeSlots;
+    std::size_t                           mNumCoroutines      = 0;
+    std::size_t                           mNumResumedLastTick = 0;
+    std::uint32_t                         mPartitionIndex     = 0;
+    std::uint32_t                         mPartitionCount     = 1;
+
+    // Shio: Coroutines resumed by the current tick and by the next one.
+    std::vector<SlotIndex> mRunnable;
+    std::vector<SlotIndex> mNextFrame;
+    TimerWheel             mTimers;
+    std::unordered_map<
+        std::string, std::vector<SlotIndex>, StringHash, std::equal_to<>>
+        mEventWaiters;
+
+    CoroutineCommandTable mCommands;
+    // Shio: The `commands` table of the script module, kept to add the
+    // opcodes of commands registered later.
+    Sqrat::Object         mCommandOpcodes;
+
+    // Shio: The time of the current tick, which wait_seconds() counts from.
+    std::uint64_t mNowNs = 0;
+    // Shio: The coroutine being started or resumed and the wait it asked for.
+    std::optional<SlotIndex> mResuming;
+    PendingWait              mPendingWait;
+
+    static CoroutineManager & from_vm(HSQUIRRELVM v);
+    bool is_resuming(HSQUIRRELVM v) const;
+
+    static SQInteger script_wait_next_frame(HSQUIRRELVM v);
+    static SQInteger script_wait_seconds(HSQUIRRELVM v);
+    static SQInteger script_wait_event(HSQUIRRELVM v);
+    static SQInteger script_yield_command(HSQUIRRELVM v);
+
+    // Shio: `partitioned` is set if the factory took the partition, so
+    // that all of the returned functions belong to this VM.
+    bool evaluate_coroutine_factory(
+        Sqrat::Object & exports, Sqrat::Array & functions, bool & partitioned
+    );
+    void create_coroutine(std::string name, const Sqrat::Object & func);
+    // Shio: Removes the flagged slots from the wait lists, so that they can
+    // be released while parked.
+    void unpark_coroutines(const std::vector<bool> & slots);
+
+    SlotIndex add_coroutine(Coroutine coroutine);
+    void      release_coroutine(SlotIndex slot);
+    // Shio: Starts or resumes the coroutine in the slot, then parks it
+    // according to the wait it asked for, or releases it once finished.
+    void      run_coroutine(SlotIndex slot, bool first_run);
+    void      park_coroutine(SlotIndex slot);
 };
 
 } // namespace usagi::scripting::quirrel
@@ -0,0 +1,117 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace usagi::scripting::quirrel
+{
+/**
+ * \brief A hashed timer wheel that holds ids until their deadlines pass.
+ *
+ * \details Time is divided into ticks of `resolution_ns`. A timer goes into
+ * the bucket of its deadline tick modulo `NUM_BUCKETS`, so scheduling is O(1)
+ * and `advance()` only visits the buckets of the ticks that elapsed since the
+ * previous call, instead of every timer. Timers whose deadlines are more than
+ * one revolution away share buckets with nearer ones and are simply kept when
+ * their bucket is visited early.
+ *
+ * The bucket of the current tick is visited again by the next `advance()`,
+ * because it may still hold timers due later within the same tick.
+ */
+class TimerWheel
+{
+public:
+    using TimerId = std::uint32_t;
+
+    // Shio: With the default resolution, one revolution is about a second,
+    // so a 60 Hz frame visits ~17 buckets.
+    constexpr static std::size_t   NUM_BUCKETS           = 1024;
+    constexpr static std::uint64_t DEFAULT_RESOLUTION_NS = 1'000'000;
+
+    explicit TimerWheel(std::uint64_t resolution_ns = DEFAULT_RESOLUTION_NS)
+        : mResolutionNs(resolution_ns)
+    {
+    }
+
+    /**
+     * \brief Schedules `id` to expire at the first `advance()` whose time is
+     * at or after `deadline_ns`. Deadlines in the past expire on the next
+     * `advance()`.
+     */
+    void schedule(const TimerId id, const std::uint64_t deadline_ns)
+    {
+        const auto tick = std::max(deadline_ns / mResolutionNs, mCurrentTick);
+        mBuckets[tick % NUM_BUCKETS].push_back({ deadline_ns, id });
+        ++mSize;
+    }
+
+    /**
+     * \brief Calls `expired(id)` for every timer due at `now_ns`, in the
+     * order of their ticks. `expired` must not schedule new timers.
+     */
+    template <typename Func>
+    void advance(const std::uint64_t now_ns, Func && expired)
+    {
+        const auto target = std::max(now_ns / mResolutionNs, mCurrentTick);
+        // Shio: After a long pause every bucket is visited once at most.
+        const auto first  = target - std::min<std::uint64_t>(
+            target - mCurrentTick, NUM_BUCKETS - 1
+        );
+        for(auto tick = first; tick <= target; ++tick)
+        {
+            auto & bucket = mBuckets[tick % NUM_BUCKETS];
+            auto   keep   = bucket.begin();
+            for(auto && timer : bucket)
+            {
+                if(timer.deadline_ns <= now_ns)
+                    expired(timer.id);
+                else
+                    *keep++ = timer;
+            }
+            mSize -= bucket.end() - keep;
+            bucket.erase(keep, bucket.end());
+        }
+        mCurrentTick = target;
+    }
+
+    /**
+     * \brief Cancels the timers whose ids satisfy `pred`. This visits every
+     * timer, so it is meant for rare events such as reloads.
+     */
+    template <typename Pred>
+    void remove_if(Pred && pred)
+    {
+        for(auto && bucket : mBuckets)
+        {
+            mSize -= std::erase_if(bucket, [&](const Timer & timer) {
+                return pred(timer.id);
+            });
+        }
+    }
+
+    void clear()
+    {
+        for(auto && bucket : mBuckets) bucket.clear();
+        mSize = 0;
+    }
+
+    std::size_t size() const { return mSize; }
+
+    std::uint64_t resolution_ns() const { return mResolutionNs; }
+
+private:
+    struct Timer
+    {
+        std::uint64_t deadline_ns;
+        TimerId       id;
+    };
+
+    std::array<std::vector<Timer>, NUM_BUCKETS> mBuckets;
+    std::uint64_t                               mResolutionNs;
+    // Shio: The tick whose bucket the next advance() starts from.
+    std::uint64_t                               mCurrentTick = 0;
+    std::size_t                                 mSize        = 0;
+};
+} // namespace usagi::scripting::quirrel
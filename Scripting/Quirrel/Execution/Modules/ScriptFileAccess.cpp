@@ -0,0 +1,129 @@
+﻿#include "ScriptFileAccess.hpp"
+
+#include <algorithm>
+
+namespace usagi::scripting::quirrel
+{
+void ScriptFileAccess::resolveFileName(
+    const char *  requested_fn,
+    const char *  running_script,
+    std::string & res
+)
+{
+    DefSqModulesFileAccess::resolveFileName(requested_fn, running_script, res);
+
+    // Shio: Native modules are resolved too, but never read, so they never
+    // show up among the changed scripts.
+    if(!running_script) return;
+    auto & importers = mCurrent.importers[res];
+    if(std::ranges::find(importers, running_script) == importers.end())
+        importers.emplace_back(running_script);
+}
+
+bool ScriptFileAccess::readFile(
+    const std::string & resolved_fn,
+    const char *        requested_fn,
+    std::vector<char> & buf,
+    std::string &       out_err_msg
+)
+{
+    if(!DefSqModulesFileAccess::readFile(
+           resolved_fn, requested_fn, buf, out_err_msg
+       ))
+        return false;
+
+    mCurrent.hashes.insert_or_assign(
+        resolved_fn, hash_source({ buf.data(), buf.size() })
+    );
+    return true;
+}
+
+void ScriptFileAccess::begin_load()
+{
+    mPrevious = std::move(mCurrent);
+    mCurrent  = { };
+}
+
+void ScriptFileAccess::end_load(const bool succeeded)
+{
+    // Shio: After a failed reload the old modules are still the ones in
+    // use, and the changes that broke it must still count as changes.
+    if(!succeeded) mCurrent = std::move(mPrevious);
+    mPrevious = { };
+}
+
+std::vector<std::string> ScriptFileAccess::changed_sources()
+{
+    std::vector<std::string> changed;
+    std::vector<char>        buf;
+    std::string              err;
+    for(auto && [resolved_fn, hash] : mCurrent.hashes)
+    {
+        buf.clear();
+        // Shio: Read through the base so the recorded hash is not replaced.
+        // A script that can no longer be read counts as changed.
+        if(!DefSqModulesFileAccess::readFile(
+               resolved_fn, resolved_fn.c_str(), buf, err
+           ) ||
+            hash_source({ buf.data(), buf.size() }) != hash)
+            changed.push_back(resolved_fn);
+    }
+    return changed;
+}
+
+std::unordered_set<std::string> ScriptFileAccess::importers_of(
+    const std::vector<std::string> & sources
+) const
+{
+    std::unordered_set<std::string> affected(sources.begin(), sources.end());
+    std::vector<std::string_view>   pending(sources.begin(), sources.end());
+    while(!pending.empty())
+    {
+        const auto it = mCurrent.importers.find(pending.back());
+        pending.pop_back();
+        if(it == mCurrent.importers.end()) continue;
+        for(auto && importer : it->second)
+        {
+            if(affected.insert(importer).second) pending.push_back(importer);
+        }
+    }
+    return affected;
+}
+
+std::unordered_set<std::string> ScriptFileAccess::imports_of(
+    const std::vector<std::string> & sources
+) const
+{
+    std::unordered_set<std::string> imported(sources.begin(), sources.end());
+    std::vector<std::string_view>   pending(sources.begin(), sources.end());
+    while(!pending.empty())
+    {
+        const auto importer = pending.back();
+        pending.pop_back();
+        // Shio: Only the importers are recorded. There are few scripts, so
+        // they are searched instead of keeping the reverse edges too.
+        for(auto && [module, importers] : mCurrent.importers)
+        {
+            if(!is_tracked(module) ||
+                std::ranges::find(importers, importer) == importers.end())
+                continue;
+            if(imported.insert(module).second) pending.push_back(module);
+        }
+    }
+    return imported;
+}
+
+std::uint64_t ScriptFileAccess::hash_source(const std::string_view source)
+{
+    // Shio: 64-bit FNV-1a. Only compared with the hash of the same file read
+    // by the same process, so it doesn't have to be strong, and reading the
+    // file costs more than hashing it.
+    std::uint64_t hash = 0xcbf29ce484222325;
+    for(const char c : source)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+} // namespace usagi::scripting::quirrel
@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sqmodules.h>
+
+namespace usagi::scripting::quirrel
+{
+/**
+ * \brief The file access of `SqModules` that remembers a content hash of every
+ * script it reads and which scripts import it.
+ *
+ * \details `SqModules` compiles every module again on each reload, even when
+ * nothing has changed. With the hashes, `changed_sources()` can tell which
+ * scripts a reload would run differently by reading the files again, which is
+ * much cheaper than compiling them. The importers recorded while the scripts
+ * are resolved give the modules affected by a change, so that only the
+ * coroutines created from them, and the ones sharing a module with those,
+ * have to be restarted.
+ *
+ * Scripts are identified by the file names resolved by `SqModules`, which are
+ * also the source names of the functions compiled from them.
+ *
+ * This only saves the reloads that change nothing. The first load and every
+ * reload that does run still compile all the scripts, because `SqModules`
+ * compiles inside `requireModule()` and `reloadModule()` and can't be given
+ * precompiled closures, so there is no bytecode cache to load from.
+ */
+class ScriptFileAccess : public DefSqModulesFileAccess
+{
+public:
+    void resolveFileName(
+        const char *  requested_fn,
+        const char *  running_script,
+        std::string & res
+    ) override;
+
+    bool readFile(
+        const std::string & resolved_fn,
+        const char *        requested_fn,
+        std::vector<char> & buf,
+        std::string &       out_err_msg
+    ) override;
+
+    /**
+     * \brief Starts recording the scripts of a (re)load from scratch, so that
+     * modules that are no longer required are forgotten. The previous records
+     * are restored by `end_load(false)`.
+     */
+    void begin_load();
+    void end_load(bool succeeded);
+
+    bool empty() const { return mCurrent.hashes.empty(); }
+
+    /**
+     * \brief Returns the scripts read by the last load that were changed or
+     * removed since.
+     */
+    std::vector<std::string> changed_sources();
+
+    /**
+     * \brief Returns the given scripts and every script importing any of
+     * them, directly or not.
+     */
+    std::unordered_set<std::string> importers_of(
+        const std::vector<std::string> & sources
+    ) const;
+
+    /**
+     * \brief Returns the given scripts and every script they import,
+     * directly or not. Native modules are left out.
+     */
+    std::unordered_set<std::string> imports_of(
+        const std::vector<std::string> & sources
+    ) const;
+
+    bool is_tracked(std::string_view resolved_fn) const
+    {
+        return mCurrent.hashes.contains(resolved_fn);
+    }
+
+    static std::uint64_t hash_source(std::string_view source);
+
+private:
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(const std::string_view str) const
+        {
+            return std::hash<std::string_view>()(str);
+        }
+    };
+
+    template <typename T>
+    using StringMap =
+        std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
+
+    struct Records
+    {
+        // <resolved file name, hash of the source>
+        StringMap<std::uint64_t>            hashes;
+        // <resolved file name, scripts that required it>
+        StringMap<std::vector<std::string>> importers;
+    };
+
+    Records mCurrent;
+    Records mPrevious;
+};
+} // namespace usagi::scripting::quirrel
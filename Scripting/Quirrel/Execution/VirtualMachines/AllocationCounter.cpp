@@ -0,0 +1,52 @@
+﻿#include "AllocationCounter.hpp"
+
+#include <cstdlib>
+
+// clang-format off
+#include <squirrel.h>
+#include <squtils.h>
+// clang-format on
+
+namespace usagi::scripting::quirrel
+{
+namespace
+{
+thread_local std::uint64_t gBytesAllocated = 0;
+}
+
+std::uint64_t vm_bytes_allocated_on_this_thread()
+{
+    return gBytesAllocated;
+}
+} // namespace usagi::scripting::quirrel
+
+using usagi::scripting::quirrel::gBytesAllocated;
+
+/*
+ * Shio: Same as the defaults in `sqmem.cpp`, plus the counting. Only growth is
+ * counted; shrinking and freeing are left to the cycle collector statistics.
+ */
+void sq_vm_init_alloc_context(SQAllocContext *) { }
+
+void sq_vm_destroy_alloc_context(SQAllocContext *) { }
+
+void sq_vm_assign_to_alloc_context(SQAllocContext, HSQUIRRELVM) { }
+
+void * sq_vm_malloc(SQAllocContext, SQUnsignedInteger size)
+{
+    gBytesAllocated += size;
+    return std::malloc(size);
+}
+
+void * sq_vm_realloc(
+    SQAllocContext, void * p, SQUnsignedInteger oldsize, SQUnsignedInteger size
+)
+{
+    if(size > oldsize) gBytesAllocated += size - oldsize;
+    return std::realloc(p, size);
+}
+
+void sq_vm_free(SQAllocContext, void * p, SQUnsignedInteger)
+{
+    std::free(p);
+}
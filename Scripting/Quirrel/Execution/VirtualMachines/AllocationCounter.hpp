@@ -0,0 +1,19 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace usagi::scripting::quirrel
+{
+/*
+ * Shio: Number of bytes the Quirrel VMs have allocated on the calling thread
+ * so far. It only grows, so the difference between two reads is what was
+ * allocated in between. Counted by the VM memory functions defined in
+ * `AllocationCounter.cpp`, which replace the default ones of the library
+ * (see `SQ_EXCLUDE_DEFAULT_MEMFUNCTIONS` in `QuirrelBuild.props`).
+ *
+ * A VM runs on one thread at a time, so this is what the VMs on that thread
+ * allocate. Reading it is one thread-local load, unlike walking the objects
+ * of a VM.
+ */
+std::uint64_t vm_bytes_allocated_on_this_thread();
+} // namespace usagi::scripting::quirrel
@@ -0,0 +1,128 @@
+﻿#include "GarbageCollector.hpp"
+
+#include <algorithm>
+
+// clang-format off
+#include <squirrel.h>
+#include <sqobject.h>
+#include <sqvm.h>
+#include <sqstate.h>
+// clang-format on
+
+#include <Usagi/Modules/Common/Time/MonotonicClock.hpp>
+#include <Usagi/Modules/Runtime/Logging/RuntimeLogger.hpp>
+
+#include "AllocationCounter.hpp"
+#include "VirtualMachine.hpp"
+
+namespace usagi::scripting::quirrel
+{
+namespace
+{
+constexpr std::uint64_t LOG_INTERVAL_NS = 1'000'000'000;
+}
+
+void GarbageCollector::configure(const GarbageCollectionSettings & settings)
+{
+    mSettings              = settings;
+    mAllocatedAtCollection = vm_bytes_allocated_on_this_thread();
+    mBudgetCreditNs        = 0;
+}
+
+void GarbageCollector::tick()
+{
+    switch(mSettings.mode)
+    {
+        case GarbageCollectionMode::Manual: break;
+        case GarbageCollectionMode::AllocationTriggered:
+        {
+            const auto allocated =
+                vm_bytes_allocated_on_this_thread() - mAllocatedAtCollection;
+            if(allocated >= mSettings.allocation_budget_bytes)
+                collect_garbage();
+            break;
+        }
+        case GarbageCollectionMode::TimeSliced:
+        {
+            const auto budget =
+                static_cast<std::int64_t>(mSettings.frame_budget_ns);
+            const auto last_pause =
+                static_cast<std::int64_t>(mStats.last_pause_ns);
+            // Shio: Don't bank the budget left by short pauses. Otherwise,
+            // once the heap grows, the banked budget would pay for a long
+            // collection every frame until it runs out.
+            mBudgetCreditNs = std::min(
+                mBudgetCreditNs + budget, std::max(budget, last_pause)
+            );
+            if(mBudgetCreditNs >= last_pause) collect_garbage();
+            break;
+        }
+    }
+}
+
+std::uint64_t GarbageCollector::collect_garbage()
+{
+    const auto begin = monotonic_now_ns();
+    // Shio: Negative if the library was built without the cycle collector.
+    const auto freed = sq_collectgarbage(mVirtualMachine.get_vm());
+    const auto pause = monotonic_now_ns() - begin;
+
+    const auto num_freed = freed > 0 ? static_cast<std::uint64_t>(freed) : 0;
+    ++mStats.collections;
+    mStats.objects_freed      += num_freed;
+    mStats.last_objects_freed  = num_freed;
+    mStats.live_objects       -= std::min(mStats.live_objects, num_freed);
+    mStats.last_pause_ns       = pause;
+    mStats.max_pause_ns        = std::max(mStats.max_pause_ns, pause);
+    mStats.total_pause_ns     += pause;
+
+    mAllocatedAtCollection  = vm_bytes_allocated_on_this_thread();
+    mBudgetCreditNs        -= static_cast<std::int64_t>(pause);
+
+    ++mCollectionsSinceLog;
+    mFreedSinceLog += num_freed;
+    const auto now = begin + pause;
+    if(now - mLastLogNs >= LOG_INTERVAL_NS)
+    {
+        // Shio: GC freed objects.
+        mVirtualMachine.logger().debug(
+            " GC: {} collections freed {} objects, last pause {} us",
+            mCollectionsSinceLog, mFreedSinceLog, pause / 1000
+        );
+        mLastLogNs           = now;
+        mCollectionsSinceLog = 0;
+        mFreedSinceLog       = 0;
+    }
+    return num_freed;
+}
+
+std::uint64_t GarbageCollector::count_live_objects()
+{
+#ifndef NO_GARBAGE_COLLECTOR
+    // Shio: Every collectable object of the VM, including the coroutine
+    // threads, is linked into the chain of the shared state.
+    const auto    v     = mVirtualMachine.get_vm();
+    std::uint64_t count = 0;
+    for(auto obj = _ss(v)->_gc_chain; obj; obj = obj->_next) ++count;
+    mStats.live_objects = count;
+#endif
+    return mStats.live_objects;
+}
+
+void GarbageCollector::log_stats()
+{
+    count_live_objects();
+
+    const auto ms = [](const std::uint64_t ns) { return ns / 1'000'000.0; };
+    // Shio: GC statistics.
+    mVirtualMachine.logger().info(
+        " GC: {} collections freed {} objects, {} live objects, pauses "
+        "last {:.3f} ms, mean {:.3f} ms, max {:.3f} ms",
+        mStats.collections, mStats.objects_freed, mStats.live_objects,
+        ms(mStats.last_pause_ns),
+        mStats.collections ? ms(mStats.total_pause_ns) / mStats.collections
+                           : 0.0,
+        ms(mStats.max_pause_ns)
+    );
+}
+} // namespace usagi::scripting::quirrel
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <cstdint>
+
+namespace usagi::scripting::quirrel
+{
+class VirtualMachine;
+
+enum class GarbageCollectionMode : std::uint8_t
+{
+    // Shio: Only `collect_garbage()` collects.
+    Manual,
+    // Collects when the VMs on the thread have allocated
+    // `allocation_budget_bytes` since the last collection.
+    AllocationTriggered,
+    // Collects as often as `frame_budget_ns` allows on average.
+    TimeSliced,
+};
+
+struct GarbageCollectionSettings
+{
+    // Shio: Like the VM itself, which never collects on its own.
+    GarbageCollectionMode mode = GarbageCollectionMode::Manual;
+
+    // Shio: For AllocationTriggered. Read from a thread-local byte counter
+    // bumped by the VM allocator, so checking it every frame is free.
+    std::uint64_t allocation_budget_bytes = 64ull << 20;
+
+    // Shio: For TimeSliced. The average time spent collecting per frame.
+    std::uint64_t frame_budget_ns = 500'000;
+};
+
+struct GarbageCollectionStats
+{
+    std::uint64_t collections        = 0;
+    std::uint64_t objects_freed      = 0;
+    std::uint64_t last_objects_freed = 0;
+    // As of the last count, minus the objects freed since.
+    std::uint64_t live_objects       = 0;
+    std::uint64_t last_pause_ns      = 0;
+    std::uint64_t max_pause_ns       = 0;
+    std::uint64_t total_pause_ns     = 0;
+};
+
+/**
+ * \brief Decides when the cycle collector of a VM runs and keeps statistics
+ * of its runs.
+ *
+ * \details Quirrel frees most objects by reference counting as soon as they
+ * become unreachable. Only reference cycles, such as tables referring to each
+ * other or closures stored in the tables they capture, are left to the cycle
+ * collector. That collector marks every object of the VM and cannot be
+ * interrupted, so its pause grows with the heap, and a tick that collects
+ * takes that much longer. `TimeSliced` cannot split a collection. Instead it
+ * spaces out whole collections so that the time spent on them averages to
+ * the frame budget, and the pauses are reported so that a heap which has
+ * outgrown the budget shows up. Splitting the scripts over the VMs of a
+ * `VirtualMachinePool` splits the heap as well.
+ *
+ * `tick()` must be called once per frame on the thread running the VM, while
+ * no script is running on it.
+ */
+class GarbageCollector
+{
+public:
+    explicit GarbageCollector(VirtualMachine & virtual_machine)
+        : mVirtualMachine(virtual_machine)
+    {
+    }
+
+    void configure(const GarbageCollectionSettings & settings);
+
+    const GarbageCollectionSettings & settings() const { return mSettings; }
+
+    /**
+     * @brief Collects if the mode says it is due.
+     */
+    void tick();
+
+    /**
+     * @brief Runs the cycle collector now and returns the number of objects
+     * it freed.
+     */
+    std::uint64_t collect_garbage();
+
+    /**
+     * @brief Walks the objects of the VM and updates `live_objects`.
+     */
+    std::uint64_t count_live_objects();
+
+    const GarbageCollectionStats & stats() const { return mStats; }
+
+    /**
+     * @brief Counts the live objects and logs the statistics.
+     */
+    void log_stats();
+
+private:
+    VirtualMachine &          mVirtualMachine;
+    GarbageCollectionSettings mSettings;
+    GarbageCollectionStats    mStats;
+
+    std::uint64_t mAllocatedAtCollection = 0;
+    // Shio: The budget accumulated since the last collection minus its
+    // pause, at most one frame's budget or the last pause. A collection is
+    // due when it covers the last pause again.
+    std::int64_t  mBudgetCreditNs        = 0;
+    // Shio: Collections are logged at most once per `LOG_INTERVAL_NS`, since
+    // short pauses can make TimeSliced collect every frame.
+    std::uint64_t mLastLogNs             = 0;
+    std::uint64_t mCollectionsSinceLog   = 0;
+    std::uint64_t mFreedSinceLog         = 0;
+};
+} // namespace usagi::scripting::quirrel
@@ -1,5 +1,10 @@
 ﻿#include "VirtualMachine.hpp"
 
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
 // clang-format off
 #include <sqstdblob.h>
 #include <sqstddatetime.h>
@@ -10,14 +15,71 @@
 #include <sqvm.h>
 // clang-format on
 
+#include <sqrat/sqratTable.h>
+
 
 #include <Usagi/Modules/Runtime/Logging/RuntimeLogger.hpp>
 #include <Usagi/Modules/Scripting/Quirrel/Debugging/DebuggingCommon.hpp>
 #include <Usagi/Runtime/Exceptions/Exceptions.hpp>
+#include <Usagi/Runtime/File/FilesystemWatcher.hpp>
 
 namespace
 {
 constexpr std::string_view gTestScriptPath { "scripts/tests/game_logic.nut" };
+
+// Shio: Only notes whether any script may have changed. What changed is
+// found by comparing the hashes of the scripts during the reload.
+class ScriptChangeHandler final : public usagi::FilesystemEventHandler
+{
+    void handle_file(const std::filesystem::path & path)
+    {
+        if(path.extension() == ".nut") changed = true;
+    }
+
+public:
+    bool changed = false;
+
+    void file_added(
+        std::uint64_t, const std::filesystem::path & path
+    ) override
+    {
+        handle_file(path);
+    }
+
+    void file_removed(
+        std::uint64_t, const std::filesystem::path & path
+    ) override
+    {
+        handle_file(path);
+    }
+
+    void file_changed(
+        std::uint64_t, const std::filesystem::path & path
+    ) override
+    {
+        handle_file(path);
+    }
+
+    void file_renamed(
+        std::uint64_t,
+        const std::filesystem::path & old_path,
+        const std::filesystem::path & new_path
+    ) override
+    {
+        handle_file(old_path);
+        handle_file(new_path);
+    }
+
+    void folder_renamed(
+        std::uint64_t, const std::filesystem::path &,
+        const std::filesystem::path &
+    ) override
+    {
+        changed = true;
+    }
+
+    void out_of_sync() override { changed = true; }
+};
 } // namespace
 
 namespace usagi::scripting::quirrel
@@ -34,7 +96,15 @@ VirtualMachine::VirtualMachine(
     , mInitialStackSize(initial_stack_size)
     , mModuleManager(GetRawHandle(), &mFileAccess)
     , mCoroutineManager(*this)
+    , mGarbageCollector(*this)
+{
+}
+
+VirtualMachine::~VirtualMachine()
 {
+    // Shio: The profiler is destroyed before the VM. Don't leave its hook and
+    // pointer behind.
+    if(mProfiler.running()) stop_profiling();
 }
 
 SQVM * VirtualMachine::CreateNewQuirrelVm(
@@ -105,6 +175,12 @@ void VirtualMachine::init()
         mModuleManager.registerDateTimeLib();
         mModuleManager.registerDebugLib();
     }
+
+    // Shio: wait_seconds(), wait_event() and wait_next_frame() for the
+    // coroutines.
+    mModuleManager.addNativeModule(
+        "coroutines", mCoroutineManager.create_script_module()
+    );
 }
 
 bool VirtualMachine::loadScripts()
@@ -115,9 +191,15 @@ bool VirtualMachine::loadScripts()
     std::string   errorMsg;
 
     // Use requireModule to load, compile, run, and cache the script
+    // todo: there is no bytecode cache. SqModules compiles every script it
+    // reads inside requireModule()/reloadModule() and takes no precompiled
+    // closures, so a cache of closures keyed by
+    // `ScriptFileAccess::hash_source()` needs a loading hook in SqModules.
+    mFileAccess.begin_load();
     bool success = mModuleManager.requireModule(
         gTestScriptPath.data(), true, nullptr, exports, errorMsg
     );
+    mFileAccess.end_load(success);
 
     if(!success)
     {
@@ -136,16 +218,42 @@ bool VirtualMachine::triggerReload()
     // Shio: --- TRIGGERING HOT-RELOAD ---
     logger().info("\n --- TRIGGERING HOT-RELOAD ---");
 
-    // 1. Shut down all old coroutine instances
-    mCoroutineManager._shutdownAllCoroutines();
+    // Shio: Compiling is by far the slowest part of a reload, so skip the
+    // whole reload when the scripts would compile to the same code. A reload
+    // that runs still compiles every script. Without records of a successful
+    // load, everything is reloaded.
+    const bool reload_all = mFileAccess.empty();
+    const auto changed    = mFileAccess.changed_sources();
+    if(!reload_all && changed.empty())
+    {
+        // Shio: No script was changed, skipping the reload.
+        logger().info(" No script was changed, skipping the reload.");
+        return true;
+    }
+    for(auto && source : changed)
+    {
+        // Shio: Changed script:
+        logger().info(" Changed script: {}", source);
+    }
+    const auto affected = mFileAccess.importers_of(changed);
+
+    // Shio: The released functions may be replaced by new ones at the same
+    // addresses, so name the samples taken so far before reloading.
+    mProfiler.collect();
+    mProfiler.forget_functions();
 
-    // 2. Reload all modules. This re-runs script code but
-    // preserves all data in `persist()` calls.
+    // 1. Reload all modules. This re-runs script code but
+    // preserves all data in `persist()` calls. The coroutines keep running
+    // on the old code until the reload succeeds.
+    // Shio: The modules record their hashes and imports again as they are
+    // read.
+    mFileAccess.begin_load();
     Sqrat::Object exports;
     std::string   errorMsg;
     bool          success = mModuleManager.reloadModule(
         gTestScriptPath.data(), true, nullptr, exports, errorMsg
     );
+    mFileAccess.end_load(success);
 
     if(!success)
     {
@@ -154,23 +262,98 @@ bool VirtualMachine::triggerReload()
         return false;
     }
 
-    // 3. Re-create coroutines from the new code. They will
+    // 2. Re-create coroutines from the new code. They will
     // automatically pick up the persisted state.
-    mCoroutineManager._findAndCreateCoroutines(exports);
+    if(reload_all)
+    {
+        mCoroutineManager._shutdownAllCoroutines();
+        mCoroutineManager._findAndCreateCoroutines(exports);
+    }
+    else
+    {
+        // Shio: Coroutines from scripts that are not tracked may come from
+        // anywhere, so they are restarted too. The kept ones still see the
+        // module-level values of the previous run, see `triggerReload()`.
+        std::unordered_map<std::string, std::unordered_set<std::string>>
+                   imports;
+        const auto imports_of = [&](const std::string_view source) -> auto & {
+            auto it = imports.find(std::string(source));
+            if(it == imports.end())
+            {
+                auto modules = mFileAccess.imports_of({ std::string(source) });
+                it = imports.emplace(source, std::move(modules)).first;
+            }
+            return it->second;
+        };
+        mCoroutineManager._recreateCoroutines(
+            exports,
+            [&](const std::string_view source) {
+                return !mFileAccess.is_tracked(source) ||
+                    affected.contains(std::string(source));
+            },
+            [&](const std::string_view a, const std::string_view b) {
+                const auto & used = imports_of(a);
+                return std::ranges::any_of(
+                    imports_of(b),
+                    [&](const std::string & m) { return used.contains(m); }
+                );
+            }
+        );
+    }
     // Shio: --- HOT-RELOAD COMPLETE ---
     logger().info(" --- HOT-RELOAD COMPLETE ---\n");
     return true;
 }
 
+void VirtualMachine::watch_scripts(const std::filesystem::path & folder)
+{
+    mScriptWatcher =
+        create_filesystem_watcher(std::filesystem::canonical(folder));
+}
+
+bool VirtualMachine::poll_script_changes()
+{
+    if(!mScriptWatcher) return true;
+
+    ScriptChangeHandler handler;
+    mScriptWatcher->poll_changes(handler);
+    // Shio: The hashes decide what was really changed, so saving a file
+    // without editing it reloads nothing.
+    if(!handler.changed) return true;
+    return triggerReload();
+}
+
+void VirtualMachine::start_profiling(const std::chrono::nanoseconds interval)
+{
+    // Shio: Coroutines created later inherit the hook from the root VM.
+    mProfiler.attach(GetRawHandle());
+    mCoroutineManager.visit_threads([&](const HSQUIRRELVM v) {
+        mProfiler.attach(v);
+    });
+    mProfiler.start(interval);
+}
+
+void VirtualMachine::stop_profiling()
+{
+    mProfiler.stop();
+    mProfiler.detach(GetRawHandle());
+    mCoroutineManager.visit_threads([&](const HSQUIRRELVM v) {
+        mProfiler.detach(v);
+    });
+    mProfiler.collect();
+}
+
 void VirtualMachine::tick()
 {
     mCoroutineManager.tick_coroutines();
+    mGarbageCollector.tick();
 }
 
 void VirtualMachine::shutdown()
 {
     // Shio: Shutting down...
     logger().info(" Shutting down...");
+    if(mProfiler.running()) stop_profiling();
     mCoroutineManager._shutdownAllCoroutines();
     // delete moduleManager;
     // sq_close(v);
@@ -1,15 +1,25 @@
 ﻿#pragma once
 
+#include <chrono>
+#include <filesystem>
 #include <memory>
 
 #include <sqmodules.h>
 #include <squirrel.h>
 
 #include <Usagi/Modules/Scripting/Quirrel/Debugging/DebuggingInterface.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Debugging/SamplingProfiler.hpp>
 #include <Usagi/Modules/Scripting/Quirrel/Execution/Coroutines/CoroutineManager.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Execution/Modules/ScriptFileAccess.hpp>
 #include <Usagi/Modules/Scripting/Quirrel/Execution/Execution.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Execution/VirtualMachines/GarbageCollector.hpp>
 #include <Usagi/Modules/Scripting/Quirrel/RuntimeEnvironment.hpp>
 
+namespace usagi
+{
+class FilesystemWatcher;
+} // namespace usagi
+
 namespace usagi::runtime
 {
 class RuntimeLogger;
@@ -30,6 +40,8 @@ public:
         SQInteger                           stack_size_override = -1
     );
 
+    ~VirtualMachine() override;
+
     HSQUIRRELVM get_vm() const { return GetRawHandle(); }
 
     auto & logger() const
@@ -49,6 +61,11 @@ public:
         return self.mCoroutineManager;
     }
 
+    auto & garbage_collector(this auto && self)
+    {
+        return self.mGarbageCollector;
+    }
+
     virtual void init();
 
     /**
@@ -57,12 +74,55 @@ public:
     bool loadScripts();
 
     /**
-     * @brief Triggers a stateful hot-reload of all scripts.
+     * @brief Triggers a stateful hot-reload of the scripts. Nothing is
+     * reloaded if no script was changed since the last load. Otherwise the
+     * coroutines whose functions come from a changed script or from a script
+     * importing one are restarted, as well as the coroutines using a module
+     * that a restarted coroutine uses too; the others keep running.
+     *
+     * `SqModules` executes every module again on a reload, including the
+     * unchanged ones. The coroutines that keep running still hold the
+     * closures of the previous run and see the module-level values created
+     * by it. Because they share no module with a restarted coroutine, no two
+     * coroutines work on separate copies of the same values. The new values
+     * of the modules they use are only seen by native code and by the
+     * coroutines created later. Values that must survive the reload are
+     * created with `persist()`.
      */
     bool triggerReload();
 
     /**
-     * @brief Main update tick. Resumes all coroutines and processes commands.
+     * @brief Watches the folder for changed scripts, which are reloaded by
+     * `poll_script_changes()`.
+     */
+    void watch_scripts(const std::filesystem::path & folder);
+
+    /**
+     * @brief Triggers a hot-reload if the watcher saw a script change since
+     * the last poll. Returns false if the reload failed.
+     */
+    bool poll_script_changes();
+
+    /**
+     * @brief Samples the call stacks of the scripts and coroutines at the
+     * given interval. The samples are aggregated by `profiler().collect()`.
+     */
+    void start_profiling(
+        std::chrono::nanoseconds interval = std::chrono::milliseconds(1)
+    );
+
+    /**
+     * @brief Stops sampling, restores the debug hooks and collects the
+     * remaining samples.
+     */
+    void stop_profiling();
+
+    auto & profiler(this auto && self) { return self.mProfiler; }
+
+    /**
+     * @brief Main update tick. Resumes the coroutines that are due and
+     * processes their commands, then collects garbage if the garbage
+     * collector says it is due.
      */
     void tick();
 
@@ -89,11 +149,14 @@ protected:
     std::shared_ptr<RuntimeEnvironment> mRuntimeEnvironment;
     SQInteger                           mInitialStackSize;
     // Use smart pointers for automatic memory management
-    DefSqModulesFileAccess              mFileAccess;
+    ScriptFileAccess                    mFileAccess;
     SqModules                           mModuleManager;
     // Track loaded scripts for hot reloading
     std::vector<std::string>            mLoadedScripts;
     CoroutineManager                    mCoroutineManager;
+    GarbageCollector                    mGarbageCollector;
+    std::unique_ptr<FilesystemWatcher>  mScriptWatcher;
+    debugging::SamplingProfiler         mProfiler;
 
     static SQVM * CreateNewQuirrelVm(
         VirtualMachine * this_vm, SQInteger initial_stack_size
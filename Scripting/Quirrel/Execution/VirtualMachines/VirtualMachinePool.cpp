@@ -0,0 +1,334 @@
+﻿#include "VirtualMachinePool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include <sqrat/sqratObject.h>
+#include <sqrat/sqratTable.h>
+
+#include <Usagi/Modules/Common/Time/MonotonicClock.hpp>
+#include <Usagi/Modules/Runtime/Logging/RuntimeLogger.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Interop/Json.hpp>
+
+#include "VirtualMachine.hpp"
+
+namespace usagi::scripting::quirrel
+{
+thread_local VirtualMachinePool::Worker * VirtualMachinePool::tCurrentWorker =
+    nullptr;
+
+VirtualMachinePool::VirtualMachinePool(
+    std::shared_ptr<RuntimeEnvironment> runtime_env,
+    std::uint32_t                       num_workers,
+    Setup                               setup
+)
+    // Shio: The workers and the calling thread.
+    : mJobStart(std::max<std::uint32_t>(num_workers, 1) + 1)
+    , mJobFinish(std::max<std::uint32_t>(num_workers, 1) + 1)
+{
+    num_workers = std::max<std::uint32_t>(num_workers, 1);
+
+    // Shio: The service provider is not synchronized. Creating the services
+    // here leaves the workers only reading it.
+    runtime_env->service_provider.ensure_service<runtime::RuntimeLogger>();
+
+    mWorkers.reserve(num_workers);
+    for(std::uint32_t i = 0; i < num_workers; ++i)
+    {
+        mWorkers.push_back(
+            std::make_unique<Worker>(Worker { .pool = this, .index = i })
+        );
+    }
+    mThreads.reserve(num_workers);
+    for(auto && worker : mWorkers)
+    {
+        mThreads.emplace_back([this, &worker = *worker] {
+            worker_main(worker);
+        });
+    }
+
+    // Shio: Each VM is created on the thread that will run it.
+    try
+    {
+        run_on_workers([&](Worker & worker) {
+            worker.vm = std::make_shared<VirtualMachine>(runtime_env);
+            worker.vm->init();
+            worker.vm->coroutine_manager().set_partition(
+                worker.index, num_workers
+            );
+            register_channels(worker);
+            if(setup) setup(*worker.vm, worker.index);
+        });
+    }
+    catch(...)
+    {
+        stop_workers();
+        throw;
+    }
+}
+
+VirtualMachinePool::~VirtualMachinePool()
+{
+    // Shio: The coroutines hold their VM, so they must be released before
+    // the VM can be destroyed.
+    try
+    {
+        run_on_workers([](Worker & worker) {
+            if(!worker.vm) return;
+            worker.vm->shutdown();
+            worker.vm.reset();
+        });
+    }
+    catch(...)
+    {
+    }
+    stop_workers();
+}
+
+void VirtualMachinePool::worker_main(Worker & worker)
+{
+    tCurrentWorker = &worker;
+    while(true)
+    {
+        mJobStart.arrive_and_wait();
+        if(mStopping) return;
+        try
+        {
+            mJob(worker);
+        }
+        catch(...)
+        {
+            std::lock_guard lk(mErrorMutex);
+            if(!mError) mError = std::current_exception();
+        }
+        mJobFinish.arrive_and_wait();
+    }
+}
+
+void VirtualMachinePool::run_on_workers(std::function<void(Worker &)> job)
+{
+    // Shio: The barriers order the writes before and after the job with the
+    // workers.
+    mJob = std::move(job);
+    mJobStart.arrive_and_wait();
+    mJobFinish.arrive_and_wait();
+    mJob = nullptr;
+
+    if(mError) std::rethrow_exception(std::exchange(mError, nullptr));
+}
+
+void VirtualMachinePool::stop_workers()
+{
+    if(mThreads.empty()) return;
+    mStopping = true;
+    mJobStart.arrive_and_wait();
+    mThreads.clear();
+}
+
+bool VirtualMachinePool::load_scripts()
+{
+    std::vector<char> succeeded(mWorkers.size());
+    run_on_workers([&](Worker & worker) {
+        succeeded[worker.index] = worker.vm->loadScripts();
+    });
+    return std::ranges::all_of(succeeded, [](const char s) { return s; });
+}
+
+bool VirtualMachinePool::trigger_reload()
+{
+    std::vector<char> succeeded(mWorkers.size());
+    run_on_workers([&](Worker & worker) {
+        succeeded[worker.index] = worker.vm->triggerReload();
+    });
+    return std::ranges::all_of(succeeded, [](const char s) { return s; });
+}
+
+void VirtualMachinePool::tick()
+{
+    tick(monotonic_now_ns());
+}
+
+void VirtualMachinePool::tick(const std::uint64_t now_ns)
+{
+    distribute_messages();
+
+    run_on_workers([now_ns](Worker & worker) {
+        auto & manager = worker.vm->coroutine_manager();
+        for(auto && message : worker.inbox)
+        {
+            auto it = worker.mailbox.find(message.topic);
+            if(it == worker.mailbox.end())
+                it = worker.mailbox.try_emplace(message.topic).first;
+            it->second.push_back(std::move(message.payload));
+            manager.signal_event(message.topic);
+        }
+        worker.inbox.clear();
+
+        manager.tick_coroutines(now_ns);
+        // Shio: Each VM has its own heap, so the workers collect in
+        // parallel.
+        worker.vm->garbage_collector().tick();
+    });
+}
+
+VirtualMachine & VirtualMachinePool::virtual_machine(
+    const std::uint32_t index
+) const
+{
+    return *mWorkers[index]->vm;
+}
+
+std::size_t VirtualMachinePool::num_coroutines() const
+{
+    std::size_t sum = 0;
+    for(auto && worker : mWorkers)
+        sum += worker->vm->coroutine_manager().num_coroutines();
+    return sum;
+}
+
+void VirtualMachinePool::distribute_messages()
+{
+    // Shio: All workers are idle between ticks.
+    for(auto && sender : mWorkers)
+    {
+        for(auto && message : sender->outbox)
+        {
+            if(message.recipient != ScriptMessage::BROADCAST)
+            {
+                mWorkers[message.recipient]->inbox.push_back(
+                    std::move(message)
+                );
+                continue;
+            }
+            for(auto && worker : mWorkers)
+            {
+                if(worker != sender) worker->inbox.push_back(message);
+            }
+        }
+        sender->outbox.clear();
+    }
+}
+
+void VirtualMachinePool::register_channels(Worker & worker)
+{
+    Sqrat::Table channels(worker.vm->get_vm());
+    channels.SquirrelFunc("post", &script_post, 4, ".ist");
+    channels.SquirrelFunc("broadcast", &script_broadcast, 3, ".st");
+    channels.SquirrelFunc("receive", &script_receive, 2, ".s");
+    channels.SetValue("worker_index", static_cast<SQInteger>(worker.index));
+    channels.SetValue(
+        "num_workers", static_cast<SQInteger>(worker.pool->num_workers())
+    );
+    worker.vm->module_manager().addNativeModule("channels", channels);
+}
+
+VirtualMachinePool::Worker * VirtualMachinePool::current_worker(
+    HSQUIRRELVM v
+)
+{
+    // Shio: Coroutine threads share the foreign pointer of the root VM.
+    const auto worker = tCurrentWorker;
+    if(!worker ||
+        worker->vm.get() != static_cast<VirtualMachine *>(sq_getforeignptr(v)))
+        return nullptr;
+    return worker;
+}
+
+SQInteger VirtualMachinePool::send_message(
+    HSQUIRRELVM v, const std::uint32_t recipient, const SQInteger first_arg
+)
+{
+    const auto worker = current_worker(v);
+    if(!worker)
+    {
+        return sq_throwerror(
+            v, "channels can only be used by the VMs of a VirtualMachinePool"
+        );
+    }
+
+    const SQChar * topic;
+    SQInteger      size;
+    sq_getstringandsize(v, first_arg, &topic, &size);
+    HSQOBJECT data;
+    sq_getstackobj(v, first_arg + 1, &data);
+
+    ScriptMessage message {
+        .sender    = worker->index,
+        .recipient = recipient,
+        .topic     = std::string(topic, static_cast<std::size_t>(size)),
+        .payload   = { },
+    };
+    try
+    {
+        interop::JsonSerializer::write_json(
+            Sqrat::Object(data, v), message.payload,
+            interop::JsonFormat::Compact
+        );
+    }
+    catch(const std::exception & e)
+    {
+        return sq_throwerror(v, e.what());
+    }
+    worker->outbox.push_back(std::move(message));
+    return 0;
+}
+
+SQInteger VirtualMachinePool::script_post(HSQUIRRELVM v)
+{
+    const auto worker = current_worker(v);
+    SQInteger  recipient;
+    sq_getinteger(v, 2, &recipient);
+    if(worker &&
+        (recipient < 0 ||
+            recipient >= static_cast<SQInteger>(worker->pool->num_workers())))
+    {
+        return sq_throwerror(v, "post(): invalid worker index");
+    }
+    return send_message(v, static_cast<std::uint32_t>(recipient), 3);
+}
+
+SQInteger VirtualMachinePool::script_broadcast(HSQUIRRELVM v)
+{
+    return send_message(v, ScriptMessage::BROADCAST, 2);
+}
+
+SQInteger VirtualMachinePool::script_receive(HSQUIRRELVM v)
+{
+    const auto worker = current_worker(v);
+    if(!worker)
+    {
+        return sq_throwerror(
+            v, "channels can only be used by the VMs of a VirtualMachinePool"
+        );
+    }
+
+    const SQChar * topic;
+    SQInteger      size;
+    sq_getstringandsize(v, 2, &topic, &size);
+
+    sq_newarray(v, 0);
+    const auto it = worker->mailbox.find(
+        std::string_view(topic, static_cast<std::size_t>(size))
+    );
+    if(it == worker->mailbox.end()) return 1;
+
+    // Shio: The payloads are taken even if one of them fails to parse.
+    auto payloads = std::move(it->second);
+    it->second.clear();
+    try
+    {
+        for(auto && payload : payloads)
+        {
+            const auto table =
+                interop::JsonSerializer::parse_json_to_table(v, payload);
+            sq_pushobject(v, table.GetObject());
+            sq_arrayappend(v, -2);
+        }
+    }
+    catch(const std::exception & e)
+    {
+        return sq_throwerror(v, e.what());
+    }
+    return 1;
+}
+} // namespace usagi::scripting::quirrel
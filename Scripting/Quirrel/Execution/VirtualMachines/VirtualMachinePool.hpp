@@ -0,0 +1,169 @@
+﻿#pragma once
+
+#include <barrier>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <squirrel.h>
+
+namespace usagi::scripting::quirrel
+{
+struct RuntimeEnvironment;
+class VirtualMachine;
+
+/**
+ * \brief A message sent between the VMs of a VirtualMachinePool. The payload
+ * is a table serialized as compact JSON, so no script object is shared
+ * between VMs.
+ */
+struct ScriptMessage
+{
+    constexpr static std::uint32_t BROADCAST =
+        std::numeric_limits<std::uint32_t>::max();
+
+    std::uint32_t sender;
+    std::uint32_t recipient;
+    std::string   topic;
+    std::string   payload;
+};
+
+/**
+ * \brief Runs scripts on N independent root VMs, one per worker thread.
+ *
+ * \details Every VM loads the same modules through its own `SqModules` and
+ * calls the same coroutine factory. A factory declared as
+ * `GetAllEntityCoroutines(index, count)` is passed the index of the VM and N
+ * and only returns the coroutines of that VM. Of a factory without
+ * parameters, coroutine `i` only runs in VM `i % N`, so an entity keeps its
+ * affinity to one VM as long as the factory returns the entities in the
+ * same order.
+ *
+ * VMs share no script objects. They exchange state through the `channels`
+ * native module:
+ *
+ *     from "channels" import post, broadcast, receive, worker_index
+ *     post(0, "trade", { item = "apple", count = 3 })
+ *     foreach (msg in receive("trade")) { ... }
+ *
+ * Messages sent during a tick are delivered before the next tick, in the
+ * order of the sending workers. Delivering messages of a topic also signals
+ * the coroutine event of the same name, so a coroutine can
+ * `wait_event("trade")` before calling `receive("trade")`. Received messages
+ * stay in the mailbox of their topic until `receive()` takes them.
+ *
+ * A VM and its coroutines are only touched by the worker thread that owns
+ * it. The pool itself must be used from one thread. The services of the
+ * runtime environment used by the VMs are created before the workers start,
+ * so the workers only look them up.
+ */
+class VirtualMachinePool
+{
+public:
+    // Shio: Called on each worker after its VM is initialized, e.g. to add
+    // the native modules of the game.
+    using Setup = std::function<void(VirtualMachine & vm, std::uint32_t index)>;
+
+    VirtualMachinePool(
+        std::shared_ptr<RuntimeEnvironment> runtime_env,
+        std::uint32_t num_workers = std::thread::hardware_concurrency(),
+        Setup         setup       = { }
+    );
+
+    ~VirtualMachinePool();
+
+    VirtualMachinePool(const VirtualMachinePool & other)             = delete;
+    VirtualMachinePool & operator=(const VirtualMachinePool & other) = delete;
+
+    /**
+     * @brief Loads the main script and creates the coroutines of every VM in
+     * parallel. Returns false if any VM failed.
+     */
+    bool load_scripts();
+
+    /**
+     * @brief Triggers a hot-reload in every VM. Returns false if any VM
+     * failed.
+     */
+    bool trigger_reload();
+
+    /**
+     * @brief Delivers the messages of the previous tick, then ticks the
+     * coroutines and garbage collectors of all VMs in parallel and waits for
+     * them.
+     */
+    void tick();
+    void tick(std::uint64_t now_ns);
+
+    std::uint32_t num_workers() const
+    {
+        return static_cast<std::uint32_t>(mWorkers.size());
+    }
+
+    VirtualMachine & virtual_machine(std::uint32_t index) const;
+
+    std::size_t num_coroutines() const;
+
+protected:
+    struct StringHash
+    {
+        using is_transparent = void;
+
+        std::size_t operator()(const std::string_view str) const
+        {
+            return std::hash<std::string_view>()(str);
+        }
+    };
+
+    struct Worker
+    {
+        VirtualMachinePool *            pool;
+        std::uint32_t                   index;
+        std::shared_ptr<VirtualMachine> vm;
+        // Shio: Written by the owner during a tick and moved to the inboxes
+        // between ticks, so no lock is needed.
+        std::vector<ScriptMessage>      outbox;
+        std::vector<ScriptMessage>      inbox;
+        std::unordered_map<
+            std::string, std::vector<std::string>, StringHash, std::equal_to<>>
+            mailbox;
+    };
+
+    // Shio: The worker owning the current thread, for the native functions.
+    static thread_local Worker * tCurrentWorker;
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    std::vector<std::jthread>            mThreads;
+    // Shio: Every job starts and finishes with all workers and the calling
+    // thread arriving at these.
+    std::barrier<>                       mJobStart;
+    std::barrier<>                       mJobFinish;
+    std::function<void(Worker &)>        mJob;
+    bool                                 mStopping = false;
+    std::mutex                           mErrorMutex;
+    std::exception_ptr                   mError;
+
+    void worker_main(Worker & worker);
+    void stop_workers();
+    // Shio: Runs the job on every worker and rethrows the first exception.
+    void run_on_workers(std::function<void(Worker &)> job);
+    void distribute_messages();
+
+    static void      register_channels(Worker & worker);
+    static Worker *  current_worker(HSQUIRRELVM v);
+    static SQInteger script_post(HSQUIRRELVM v);
+    static SQInteger script_broadcast(HSQUIRRELVM v);
+    static SQInteger script_receive(HSQUIRRELVM v);
+    static SQInteger send_message(
+        HSQUIRRELVM v, std::uint32_t recipient, SQInteger first_arg
+    );
+};
+} // namespace usagi::scripting::quirrel
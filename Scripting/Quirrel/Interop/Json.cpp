@@ -25,8 +25,16 @@
 #undef private
 // clang-format on
 
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <limits>
 // This goddamn header is so hard to spell.
 #include <sstream>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
@@ -235,34 +243,393 @@ nlohmann::json JsonSerializer::serialize_recursive(
     }
 }
 
-// todo: add formatting options
-std::string JsonSerializer::object_to_json_string(const Sqrat::Object & value)
+namespace
+{
+/*
+ * Writes JSON text into a caller-owned buffer while walking the Squirrel
+ * objects. Follows `serialize_recursive` value by value, so both produce the
+ * same JSON apart from the order of object keys.
+ */
+class StreamingJsonWriter
+{
+    HSQUIRRELVM       mVm;
+    std::string &     mOut;
+    const bool        mPretty;
+    const std::size_t mMaxDepth;
+
+    constexpr static std::size_t IndentWidth = 4;
+
+    void newline(const std::size_t depth)
+    {
+        if(!mPretty) return;
+        mOut.push_back('\n');
+        mOut.append(depth * IndentWidth, ' ');
+    }
+
+    /*
+     * Length of the UTF-8 sequence starting at `i`. If the sequence is
+     * invalid, `valid` is set to false and the length covers the lead byte and
+     * the continuation bytes that were acceptable so far, which are replaced
+     * as one character (the "maximal subpart" practice).
+     */
+    static std::size_t utf8_sequence_length(
+        const std::string_view str, const std::size_t i, bool & valid
+    )
+    {
+        const auto c = static_cast<unsigned char>(str[i]);
+
+        // number of continuation bytes and the range of the first one, which
+        // excludes overlong forms, surrogates and code points > U+10FFFF.
+        std::size_t   count = 0;
+        unsigned char lower = 0x80, upper = 0xBF;
+        if(c >= 0xC2 && c <= 0xDF) count = 1;
+        else if(c >= 0xE0 && c <= 0xEF)
+        {
+            count = 2;
+            if(c == 0xE0) lower = 0xA0;
+            if(c == 0xED) upper = 0x9F;
+        }
+        else if(c >= 0xF0 && c <= 0xF4)
+        {
+            count = 3;
+            if(c == 0xF0) lower = 0x90;
+            if(c == 0xF4) upper = 0x8F;
+        }
+        else
+        {
+            valid = false;
+            return 1;
+        }
+
+        for(std::size_t k = 1; k <= count; ++k)
+        {
+            const auto next = i + k < str.size()
+                ? static_cast<unsigned char>(str[i + k])
+                : 0;
+            if(next < lower || next > upper)
+            {
+                valid = false;
+                return k;
+            }
+            lower = 0x80;
+            upper = 0xBF;
+        }
+        valid = true;
+        return count + 1;
+    }
+
+    // Same escaping as nlohmann::json::dump() without `ensure_ascii`.
+    // Invalid UTF-8 is replaced with U+FFFD like `error_handler_t::replace`.
+    void write_string(const std::string_view str)
+    {
+        constexpr char hex[] = "0123456789abcdef";
+
+        mOut.push_back('"');
+        std::size_t run = 0;
+        std::size_t i   = 0;
+        const auto  flush = [&] { mOut.append(str.substr(run, i - run)); };
+        while(i < str.size())
+        {
+            const auto c = static_cast<unsigned char>(str[i]);
+            if(c >= 0x80)
+            {
+                bool       valid;
+                const auto len = utf8_sequence_length(str, i, valid);
+                if(!valid)
+                {
+                    flush();
+                    mOut.append("\xEF\xBF\xBD");
+                    run = i + len;
+                }
+                i += len;
+                continue;
+            }
+            if(c >= 0x20 && c != '"' && c != '\\')
+            {
+                ++i;
+                continue;
+            }
+            flush();
+            mOut.push_back('\\');
+            switch(c)
+            {
+                case '"' : mOut.push_back('"'); break;
+                case '\\': mOut.push_back('\\'); break;
+                case '\b': mOut.push_back('b'); break;
+                case '\f': mOut.push_back('f'); break;
+                case '\n': mOut.push_back('n'); break;
+                case '\r': mOut.push_back('r'); break;
+                case '\t': mOut.push_back('t'); break;
+                default:
+                {
+                    const char code[] = { 'u', '0', '0', hex[c >> 4],
+                                           hex[c & 0xF] };
+                    mOut.append(code, sizeof(code));
+                    break;
+                }
+            }
+            run = ++i;
+        }
+        flush();
+        mOut.push_back('"');
+    }
+
+    template <typename T>
+    void write_number(const T value)
+    {
+        char buffer[32];
+        const auto [end, ec] =
+            std::to_chars(buffer, buffer + sizeof(buffer), value);
+        assert(ec == std::errc());
+        mOut.append(buffer, end);
+        // keep floats recognizable as such, like nlohmann does.
+        if constexpr(std::is_floating_point_v<T>)
+        {
+            if(std::find_if(buffer, end, [](const char ch) {
+                   return ch == '.' || ch == 'e' || ch == 'n' || ch == 'i';
+               }) == end)
+                mOut.append(".0");
+        }
+    }
+
+    // Empty/deleted slots. See `JsonSerializer::optionally_skip_key`.
+    static bool is_skipped_key(const SQObjectPtr & key)
+    {
+        return sq_type(key) == OT_NULL || sq_type(key) & OT_FREE_TABLE_SLOT;
+    }
+
+    // Writes the key followed by the separator, without copying the key into
+    // a temporary string.
+    void write_key(const SQObjectPtr & key, const types::sq_uint32_t index)
+    {
+        if(sq_isstring(key))
+        {
+            write_string({ _stringval(key),
+                           static_cast<std::size_t>(_string(key)->_len) });
+        }
+        else if(sq_isinteger(key))
+        {
+            mOut.push_back('"');
+            write_number(_integer(key));
+            mOut.push_back('"');
+        }
+        else
+        {
+            mOut.append("\"<invalid_key_");
+            write_number(index);
+            mOut.append(">\"");
+        }
+        mOut.push_back(':');
+        if(mPretty) mOut.push_back(' ');
+    }
+
+    /*
+     * Writes the members of a table as `"key": value` pairs. `get_value`
+     * fetches the value of a hash node and returns a reference to it; values
+     * that are null are skipped like in `serialize_recursive`.
+     */
+    void write_members(
+        const SQTable * table, const std::size_t depth, bool & first,
+        auto && get_value, auto && skip_value
+    )
+    {
+        SQTable::_HashNode * nodes    = table->_nodes;
+        const auto           numNodes = table->_numofnodes_minus_one + 1;
+
+        if(const auto probe =
+               usagi::runtime::memory::is_address_readable(nodes);
+           !probe)
+        {
+            throw runtime::VirtualMachineAccessViolation(
+                mVm, nodes, probe.error()
+            );
+        }
+
+        for(types::sq_uint32_t i = 0; i < numNodes; ++i)
+        {
+            if(is_skipped_key(nodes[i].key)) continue;
+
+            const SQObjectPtr & val = get_value(nodes[i]);
+            if(sq_isnull(val) || skip_value(val)) continue;
+
+            if(!first) mOut.push_back(',');
+            first = false;
+            newline(depth + 1);
+            write_key(nodes[i].key, i);
+            write_value(val, depth + 1);
+        }
+    }
+
+    void close_container(
+        const char bracket, const bool empty, const std::size_t depth
+    )
+    {
+        if(!empty) newline(depth);
+        mOut.push_back(bracket);
+    }
+
+public:
+    StreamingJsonWriter(
+        HSQUIRRELVM v, std::string & out, const JsonFormat format,
+        const std::size_t max_depth
+    )
+        : mVm(v)
+        , mOut(out)
+        , mPretty(format == JsonFormat::Pretty)
+        , mMaxDepth(max_depth)
+    {
+    }
+
+    void write_value(const SQObjectPtr & obj, const std::size_t depth)
+    {
+        if(depth > mMaxDepth)
+        {
+            mOut.push_back('{');
+            newline(depth + 1);
+            mOut.append(mPretty ? "\"error\": " : "\"error\":");
+            write_string("<depth_limit_exceeded>");
+            close_container('}', false, depth);
+            return;
+        }
+
+        switch(sq_type(obj))
+        {
+            case OT_NULL   : mOut.append("null"); return;
+            case OT_INTEGER: write_number(_integer(obj)); return;
+            case OT_FLOAT:
+            {
+                const SQFloat val = _float(obj);
+                if(std::isnan(val))
+                    write_string(std::signbit(val) ? "-nan" : "+nan");
+                else if(std::isinf(val))
+                    write_string(std::signbit(val) ? "-inf" : "+inf");
+                else
+                    write_number(val);
+                return;
+            }
+            case OT_BOOL: mOut.append(_integer(obj) ? "true" : "false"); return;
+            case OT_STRING:
+                write_string({ _stringval(obj),
+                               static_cast<std::size_t>(_string(obj)->_len) });
+                return;
+            case OT_ARRAY:
+            {
+                const SQArray * arr = _array(obj);
+                const auto      len = arr->Size();
+                mOut.push_back('[');
+                for(types::sq_uint32_t i = 0; i < len; ++i)
+                {
+                    if(i) mOut.push_back(',');
+                    newline(depth + 1);
+                    write_value(arr->_values[i], depth + 1);
+                }
+                close_container(']', len == 0, depth);
+                return;
+            }
+            case OT_TABLE:
+            {
+                bool first = true;
+                mOut.push_back('{');
+                write_members(
+                    _table(obj), depth, first,
+                    [](SQTable::_HashNode & node) -> const SQObjectPtr & {
+                        return node.val;
+                    },
+                    [](const SQObjectPtr &) { return false; }
+                );
+                close_container('}', first, depth);
+                return;
+            }
+            case OT_CLASS:
+            case OT_INSTANCE:
+            {
+                bool first = true;
+                mOut.push_back('{');
+
+                // See `serialize_recursive` for the caveats.
+                sq_pushobject(mVm, obj);
+                sq_typeof(mVm, -1);
+                const SQChar * type_name = nullptr;
+                if(SQ_SUCCEEDED(sq_getstring(mVm, -1, &type_name)) && type_name)
+                {
+                    newline(depth + 1);
+                    mOut.append(mPretty ? "\"_typeof\": " : "\"_typeof\":");
+                    write_string(type_name);
+                    first = false;
+                }
+                sq_pop(mVm, 2); // Pop type name and object
+
+                SQClass * cls =
+                    sq_isclass(obj) ? _class(obj) : _instance(obj)->_class;
+                // slots might get removed, so the values are looked up.
+                SQObjectPtr member;
+                write_members(
+                    cls->_members, depth, first,
+                    [&](SQTable::_HashNode & node) -> const SQObjectPtr & {
+                        member.Null();
+                        if(sq_isclass(obj))
+                            _class(obj)->Get(node.key, member);
+                        else
+                            _instance(obj)->Get(node.key, member);
+                        return member;
+                    },
+                    // Skip functions.
+                    [](const SQObjectPtr & val) {
+                        return sq_isclosure(val) || sq_isnativeclosure(val) ||
+                            sq_type(val) == OT_FUNCPROTO;
+                    }
+                );
+                close_container('}', first, depth);
+                return;
+            }
+            default:
+            {
+                // Shio: Same as `serialize()`.
+                mOut.append("\"<");
+                mOut.append(meta::reflection::enum_to_string(
+                    (tagSQObjectType)sq_type(obj)
+                ));
+                mOut.append(">\"");
+                return;
+            }
+        }
+    }
+};
+} // namespace
+
+void JsonSerializer::write_json(
+    HSQUIRRELVM v, const objects::sq_object_ptr & obj, std::string & out,
+    const JsonFormat format
+)
+{
+    StreamingJsonWriter writer(v, out, format, MaxRecursionDepth);
+    writer.write_value(obj, 0);
+}
+
+void JsonSerializer::write_json(
+    const Sqrat::Object & value, std::string & out, const JsonFormat format
+)
 {
     HSQUIRRELVM v = value.GetVM();
-    if(!v) return "null";
+    if(!v)
+    {
+        out.append("null");
+        return;
+    }
 
-    // Convert Handle to internal SQObjectPtr
-    // HSQOBJECT is struct { type, val }. SQObjectPtr has
-    // constructors/assignment for it. We safely cast the internal handle.
-    const objects::sq_object hObj = value.GetObject();
-    // This `sq_object_ptr` MUST be constructed by directly taking `hObj`
+    // This `sq_object_ptr` MUST be constructed by directly taking the handle
     // because in `SQObjectPtr`'s ctor there is a line of
     // `__AddRef(_type,_unVal);` which is critical for keeping our value object
     // alive.
-    objects::sq_object_ptr   obj(hObj);
-    // obj._type  = hObj._type;
-    // obj._unVal = hObj._unVal;
+    const objects::sq_object_ptr obj(value.GetObject());
+    write_json(v, obj, out, format);
+}
 
-    /*
-     * Shio: `dump()` arguments:
-     *   - indent: 4 spaces for pretty-printing, useful for debugging.
-     *   - indent_char: ' '
-     *   - ensure_ascii: false to allow UTF-8 characters in the output.
-     *   - error_handler: replace to avoid throwing exceptions on errors.
-     */
-    return serialize(v, obj).dump(
-        4, ' ', false, nlohmann::json::error_handler_t::replace
-    );
+std::string JsonSerializer::object_to_json_string(const Sqrat::Object & value)
+{
+    std::string out;
+    write_json(value, out, JsonFormat::Pretty);
+    return out;
 }
 
 std::string JsonSerializer::table_to_json_string(const Sqrat::Table & value)
@@ -270,57 +637,341 @@ std::string JsonSerializer::table_to_json_string(const Sqrat::Table & value)
     return object_to_json_string(value);
 }
 
-Sqrat::Table JsonSerializer::compile_json_to_table(
-    HSQUIRRELVM v, const nlohmann::json & j
-)
+namespace
 {
-    // Shio: Convert the JSON object to its string representation and
-    // create a script that returns it as a table expression.
-    // todo: perf
-    const std::string json_string   = j.dump();
-    const std::string script_string = "return " + json_string;
-
-    const SQInteger top         = sq_gettop(v);
-    const char *    source_name = "__json_compiler__";
-
-    if(SQ_FAILED(sq_compile(
-           v, script_string.c_str(),
-           static_cast<SQInteger>(script_string.length()), source_name,
-           SQTrue /* raise error */
-       )))
-    {
-        // Shio: The compilation failed. sq_compilebuffer does not leave
-        // the error on the stack, so we throw a C++ exception.
-        sq_settop(v, top);
-        throw ScriptCompilationError(
-            "Failed to compile JSON object into a Squirrel table."
+// Each nesting level keeps at most the container, a key, and a value on the
+// stack while its children are built.
+constexpr SQInteger StackSlotsPerLevel = 3;
+
+void reserve_stack(HSQUIRRELVM v)
+{
+    // Squirrel does not grow the stack on push.
+    if(SQ_FAILED(sq_reservestack(v, StackSlotsPerLevel)))
+    {
+        throw ScriptExecutionError(
+            "Failed to reserve VM stack for building a table from JSON."
         );
     }
+}
 
-    // Shio: A closure is now on the stack; push the root table as its
-    // 'this' environment and execute it.
-    sq_pushroottable(v);
+void push_integer(HSQUIRRELVM v, const std::uint64_t value)
+{
+    // Integers not representable by SQInteger become floats, which keeps
+    // their magnitude.
+    constexpr auto max_integer =
+        static_cast<std::uint64_t>(std::numeric_limits<SQInteger>::max());
+    if(value > max_integer)
+        sq_pushfloat(v, static_cast<SQFloat>(value));
+    else
+        sq_pushinteger(v, static_cast<SQInteger>(value));
+}
 
-    if(SQ_FAILED(sq_call(v, 1, SQTrue, SQTrue)))
+// Pops the key and the value on top of the stack into the container below.
+void set_slot(HSQUIRRELVM v)
+{
+    // For tables, rawset creates missing slots without invoking metamethods.
+    if(SQ_FAILED(sq_rawset(v, -3)))
     {
-        sq_settop(v, top);
         throw ScriptExecutionError(
-            "Failed to execute compiled JSON table constructor."
+            "Failed to set a slot while building a table from JSON."
+        );
+    }
+}
+
+// Pushes the Squirrel value of `j` onto the stack.
+void push_json_value(
+    HSQUIRRELVM v, const nlohmann::json & j, const std::size_t depth,
+    const std::size_t max_depth
+)
+{
+    using value_t = nlohmann::json::value_t;
+
+    if(depth > max_depth)
+    {
+        throw MismatchedObjectType(
+            "JSON nesting exceeds the maximum depth for Squirrel tables."
         );
     }
 
-    // Shio: The result of the script (the table) is now on the stack.
-    // We use Sqrat::Var to safely wrap it.
+    switch(j.type())
+    {
+        case value_t::null           : sq_pushnull(v); break;
+        case value_t::boolean        : sq_pushbool(v, j.get<bool>()); break;
+        case value_t::number_integer :
+            sq_pushinteger(v, static_cast<SQInteger>(j.get<std::int64_t>()));
+            break;
+        case value_t::number_unsigned:
+            push_integer(v, j.get<std::uint64_t>());
+            break;
+        case value_t::number_float   :
+            sq_pushfloat(v, static_cast<SQFloat>(j.get<double>()));
+            break;
+        case value_t::string:
+        {
+            const auto & str = j.get_ref<const std::string &>();
+            sq_pushstring(v, str.data(), static_cast<SQInteger>(str.size()));
+            break;
+        }
+        case value_t::array:
+        {
+            reserve_stack(v);
+            // The array is created with all its elements (nulls), which are
+            // then overwritten in place.
+            sq_newarray(v, static_cast<SQInteger>(j.size()));
+            SQInteger index = 0;
+            for(const auto & element : j)
+            {
+                sq_pushinteger(v, index++);
+                push_json_value(v, element, depth + 1, max_depth);
+                set_slot(v);
+            }
+            break;
+        }
+        case value_t::object:
+        {
+            reserve_stack(v);
+            // Pre-size the hash so the table is never rehashed while filled.
+            sq_newtableex(v, static_cast<SQInteger>(j.size()));
+            for(const auto & [key, value] : j.items())
+            {
+                sq_pushstring(
+                    v, key.data(), static_cast<SQInteger>(key.size())
+                );
+                push_json_value(v, value, depth + 1, max_depth);
+                set_slot(v);
+            }
+            break;
+        }
+        // Not produced by JSON text.
+        case value_t::binary   :
+        case value_t::discarded:
+        default                : sq_pushnull(v); break;
+    }
+}
+
+/*
+ * Builds the Squirrel objects while the JSON text is parsed. Containers are
+ * pushed when they start and stored into their parent when they end, so the
+ * stack always holds the path from the root to the current value. The sizes
+ * are unknown while parsing, so the containers grow as needed.
+ */
+class SquirrelTableSaxBuilder
+{
+    HSQUIRRELVM       mVm;
+    const std::size_t mMaxDepth;
+    // Whether each open container is an array (true) or a table (false).
+    std::vector<bool> mOpenContainers;
+    std::string       mError;
+
+    // The depth of the next value is the number of open containers. Uses the
+    // same limit as `push_json_value`: the root is at depth 0 and values at
+    // `mMaxDepth` are still accepted.
+    void check_depth() const
+    {
+        if(mOpenContainers.size() > mMaxDepth)
+        {
+            throw MismatchedObjectType(
+                "JSON nesting exceeds the maximum depth for Squirrel tables."
+            );
+        }
+    }
+
+    // Stores the value on top of the stack into the current container.
+    bool add_value()
+    {
+        if(mOpenContainers.empty()) return true;
+        if(mOpenContainers.back())
+        {
+            if(SQ_FAILED(sq_arrayappend(mVm, -2)))
+                throw ScriptExecutionError(
+                    "Failed to append an element while building a table from "
+                    "JSON."
+                );
+        }
+        else
+        {
+            set_slot(mVm);
+        }
+        return true;
+    }
+
+    bool open_container(const bool is_array)
+    {
+        check_depth();
+        // Only an object can be the root.
+        if(mOpenContainers.empty() && is_array)
+        {
+            throw MismatchedObjectType("JSON root is not an object.");
+        }
+        reserve_stack(mVm);
+        if(is_array)
+            sq_newarray(mVm, 0);
+        else
+            sq_newtable(mVm);
+        mOpenContainers.push_back(is_array);
+        return true;
+    }
+
+    bool close_container()
+    {
+        mOpenContainers.pop_back();
+        return add_value();
+    }
+
+    bool root_check()
+    {
+        if(mOpenContainers.empty())
+            throw MismatchedObjectType("JSON root is not an object.");
+        check_depth();
+        return true;
+    }
+
+public:
+    using number_integer_t  = nlohmann::json::number_integer_t;
+    using number_unsigned_t = nlohmann::json::number_unsigned_t;
+    using number_float_t    = nlohmann::json::number_float_t;
+    using string_t          = nlohmann::json::string_t;
+    using binary_t          = nlohmann::json::binary_t;
+
+    SquirrelTableSaxBuilder(HSQUIRRELVM v, const std::size_t max_depth)
+        : mVm(v), mMaxDepth(max_depth)
+    {
+    }
+
+    const std::string & error() const { return mError; }
+
+    bool null()
+    {
+        root_check();
+        sq_pushnull(mVm);
+        return add_value();
+    }
+
+    bool boolean(const bool val)
+    {
+        root_check();
+        sq_pushbool(mVm, val);
+        return add_value();
+    }
+
+    bool number_integer(const number_integer_t val)
+    {
+        root_check();
+        sq_pushinteger(mVm, static_cast<SQInteger>(val));
+        return add_value();
+    }
+
+    bool number_unsigned(const number_unsigned_t val)
+    {
+        root_check();
+        push_integer(mVm, val);
+        return add_value();
+    }
+
+    bool number_float(const number_float_t val, const string_t &)
+    {
+        root_check();
+        sq_pushfloat(mVm, static_cast<SQFloat>(val));
+        return add_value();
+    }
+
+    bool string(string_t & val)
+    {
+        root_check();
+        sq_pushstring(mVm, val.data(), static_cast<SQInteger>(val.size()));
+        return add_value();
+    }
+
+    bool binary(binary_t &)
+    {
+        root_check();
+        sq_pushnull(mVm);
+        return add_value();
+    }
+
+    bool start_object(std::size_t) { return open_container(false); }
+
+    bool key(string_t & val)
+    {
+        sq_pushstring(mVm, val.data(), static_cast<SQInteger>(val.size()));
+        return true;
+    }
+
+    bool end_object() { return close_container(); }
+
+    bool start_array(std::size_t) { return open_container(true); }
+
+    bool end_array() { return close_container(); }
+
+    bool parse_error(
+        std::size_t, const std::string &, const nlohmann::json::exception & ex
+    )
+    {
+        mError = ex.what();
+        return false;
+    }
+};
+
+// Takes the table on top of the stack and restores the stack.
+Sqrat::Table take_table(HSQUIRRELVM v, const SQInteger top)
+{
+    // Shio: We use Sqrat::Var to safely wrap it.
     Sqrat::Var<Sqrat::Table> table_var(v, -1);
-    // Shio: Restore the stack to its original state before returning.
     sq_settop(v, top);
     if(table_var.value.IsNull())
     {
-        // Shio: This can happen if the script somehow didn't return a
-        // table.
-        sq_settop(v, top);
-        throw MismatchedObjectType("Compiled JSON did not return a table.");
+        throw MismatchedObjectType("JSON did not produce a table.");
     }
     return table_var.value;
 }
+} // namespace
+
+Sqrat::Table JsonSerializer::compile_json_to_table(
+    HSQUIRRELVM v, const nlohmann::json & j
+)
+{
+    if(!j.is_object())
+    {
+        throw MismatchedObjectType("JSON root is not an object.");
+    }
+
+    const SQInteger top = sq_gettop(v);
+    try
+    {
+        push_json_value(v, j, 0, MaxRecursionDepth);
+    }
+    catch(...)
+    {
+        sq_settop(v, top);
+        throw;
+    }
+    return take_table(v, top);
+}
+
+Sqrat::Table JsonSerializer::parse_json_to_table(
+    HSQUIRRELVM v, const std::string_view json_text
+)
+{
+    const SQInteger top = sq_gettop(v);
+
+    SquirrelTableSaxBuilder builder(v, MaxRecursionDepth);
+    bool parsed;
+    try
+    {
+        parsed = nlohmann::json::sax_parse(json_text, &builder);
+    }
+    catch(...)
+    {
+        sq_settop(v, top);
+        throw;
+    }
+    if(!parsed)
+    {
+        sq_settop(v, top);
+        throw MismatchedObjectType(
+            std::format("Failed to parse JSON: {}", builder.error())
+        );
+    }
+    return take_table(v, top);
+}
 } // namespace usagi::scripting::quirrel::interop
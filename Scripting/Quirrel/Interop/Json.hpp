@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <iterator>
 #include <optional>
 #include <string>
+#include <string_view>
 
 #include <nlohmann/json.hpp>
 
@@ -12,6 +14,14 @@
 
 namespace usagi::scripting::quirrel::interop
 {
+enum class JsonFormat : std::uint8_t
+{
+    // No whitespace at all.
+    Compact,
+    // One value per line, indented by 4 spaces.
+    Pretty,
+};
+
 struct JsonSerializer
 {
 private:
@@ -37,33 +47,61 @@ public:
     }
 
     /*
-     * Shio: The `to_json_string` functions are refactored to use the new
-     * `JsonSerializer`. They now construct a `nlohmann::json` object first,
-     * ensuring the output is always a valid JSON string, and then dump it to
-     * a string.
+     * Streams the JSON text of `obj` into `out` without building a DOM. Table
+     * and array slots are read in place and keys are escaped straight into
+     * the buffer. The text is appended, so a buffer that is cleared between
+     * calls keeps its capacity and serializing stops allocating once it is
+     * large enough. Produces the same values as `serialize()`, but object
+     * keys keep the order of the table's hash nodes.
+     */
+    static void write_json(
+        HSQUIRRELVM v, const objects::sq_object_ptr & obj, std::string & out,
+        JsonFormat format = JsonFormat::Pretty
+    );
+
+    static void write_json(
+        const Sqrat::Object & value, std::string & out,
+        JsonFormat format = JsonFormat::Pretty
+    );
+
+    /*
+     * Shio: The `to_json_string` functions always produce valid JSON. They
+     * are written by `write_json` in the pretty format.
      */
     static std::string object_to_json_string(const Sqrat::Object & value);
 
     static std::string table_to_json_string(const Sqrat::Table & value);
 
     /*
-     * Shio: Added an output iterator version as requested in the original
-     * prompt, in case we need to stream large JSON objects without holding the
-     * entire string in memory first.
+     * Shio: Output iterator version of `write_json`. The whole document is
+     * still written to a per-thread buffer first and then copied to `out`,
+     * so this saves the allocation of a new string per call, not the memory
+     * of holding the document.
      */
     template <std::output_iterator<char> It>
     void to_json_iterator(const Sqrat::Object & value, It out)
     {
-        const auto str = object_to_json_string(value);
-        std::copy(str.begin(), str.end(), out);
+        thread_local std::string buffer;
+        buffer.clear();
+        write_json(value, buffer);
+        std::copy(buffer.begin(), buffer.end(), out);
     }
 
     /*
-     * Shio: This function facilitates the creation of a Squirrel table from a
-     * JSON object. It leverages Squirrel's native ability to parse JSON-style
-     * table declarations.
+     * Build a Squirrel table from a JSON object by walking the DOM and
+     * creating the tables and arrays directly on the VM stack. Containers are
+     * created with their final number of slots, so nothing is rehashed or
+     * regrown. No script text is generated or compiled.
      */
     static Sqrat::Table
         compile_json_to_table(HSQUIRRELVM v, const nlohmann::json & j);
+
+    /*
+     * Same as above, but parses JSON text with a SAX parser that builds the
+     * table while reading, skipping the intermediate `nlohmann::json` DOM.
+     * Prefer this one for payloads that arrive as text, e.g. from network.
+     */
+    static Sqrat::Table
+        parse_json_to_table(HSQUIRRELVM v, std::string_view json_text);
 };
 } // namespace usagi::scripting::quirrel::interop
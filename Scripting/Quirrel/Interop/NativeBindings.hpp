@@ -0,0 +1,361 @@
+﻿#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// clang-format off
+#include <squirrel.h>
+#include <sqrat/sqratClassType.h>
+#include <sqrat/sqratObject.h>
+// clang-format on
+
+/*
+ * When enabled, the VM checks the argument types of fast-path natives against
+ * their type masks and the thunks check every read. Otherwise only the number
+ * of arguments is checked, which keeps the stack reads in bounds.
+ */
+#ifndef USAGI_QUIRREL_CHECK_NATIVE_ARGS
+#ifdef _DEBUG
+#define USAGI_QUIRREL_CHECK_NATIVE_ARGS 1
+#else
+#define USAGI_QUIRREL_CHECK_NATIVE_ARGS 0
+#endif
+#endif
+
+namespace usagi::scripting::quirrel::interop
+{
+/*
+ * Reads a native argument from the stack. `value_type` is what the thunk
+ * stores before the call, and `TYPE_MASK` is the character of the argument in
+ * a Squirrel type mask.
+ */
+template <typename T>
+struct NativeArgument;
+
+template <>
+struct NativeArgument<bool>
+{
+    using value_type                = bool;
+    constexpr static char TYPE_MASK = 'b';
+
+    static bool read(HSQUIRRELVM v, const SQInteger idx, value_type & out)
+    {
+        SQBool value   = SQFalse;
+        const auto ret = sq_getbool(v, idx, &value);
+        out            = value != SQFalse;
+        return SQ_SUCCEEDED(ret);
+    }
+};
+
+template <typename T>
+    requires std::integral<T> && (!std::same_as<T, bool>)
+struct NativeArgument<T>
+{
+    using value_type                = T;
+    constexpr static char TYPE_MASK = 'i';
+
+    static bool read(HSQUIRRELVM v, const SQInteger idx, value_type & out)
+    {
+        SQInteger  value = 0;
+        const auto ret   = sq_getinteger(v, idx, &value);
+        out              = static_cast<T>(value);
+        return SQ_SUCCEEDED(ret);
+    }
+};
+
+template <std::floating_point T>
+struct NativeArgument<T>
+{
+    using value_type                = T;
+    // Shio: Integers are converted.
+    constexpr static char TYPE_MASK = 'n';
+
+    static bool read(HSQUIRRELVM v, const SQInteger idx, value_type & out)
+    {
+        SQFloat    value = 0;
+        const auto ret   = sq_getfloat(v, idx, &value);
+        out              = static_cast<T>(value);
+        return SQ_SUCCEEDED(ret);
+    }
+};
+
+// Shio: Views the string in the VM, which outlives the call.
+template <>
+struct NativeArgument<std::string_view>
+{
+    using value_type                = std::string_view;
+    constexpr static char TYPE_MASK = 's';
+
+    static bool read(HSQUIRRELVM v, const SQInteger idx, value_type & out)
+    {
+        const SQChar * str  = nullptr;
+        SQInteger      size = 0;
+        const auto     ret  = sq_getstringandsize(v, idx, &str, &size);
+        out = { str, static_cast<std::size_t>(size) };
+        return SQ_SUCCEEDED(ret);
+    }
+};
+
+template <>
+struct NativeArgument<const SQChar *>
+{
+    using value_type                = const SQChar *;
+    constexpr static char TYPE_MASK = 's';
+
+    static bool read(HSQUIRRELVM v, const SQInteger idx, value_type & out)
+    {
+        return SQ_SUCCEEDED(sq_getstring(v, idx, &out));
+    }
+};
+
+// Shio: Copies the string. Prefer std::string_view parameters.
+template <>
+struct NativeArgument<std::string>
+{
+    using value_type                = std::string;
+    constexpr static char TYPE_MASK = 's';
+
+    static bool read(HSQUIRRELVM v, const SQInteger idx, value_type & out)
+    {
+        std::string_view view;
+        if(!NativeArgument<std::string_view>::read(v, idx, view)) return false;
+        out.assign(view);
+        return true;
+    }
+};
+
+inline void push_native_result(HSQUIRRELVM v, const bool value)
+{
+    sq_pushbool(v, value ? SQTrue : SQFalse);
+}
+
+template <typename T>
+    requires std::integral<T> && (!std::same_as<T, bool>)
+void push_native_result(HSQUIRRELVM v, const T value)
+{
+    sq_pushinteger(v, static_cast<SQInteger>(value));
+}
+
+template <std::floating_point T>
+void push_native_result(HSQUIRRELVM v, const T value)
+{
+    sq_pushfloat(v, static_cast<SQFloat>(value));
+}
+
+inline void push_native_result(HSQUIRRELVM v, const std::string_view value)
+{
+    sq_pushstring(v, value.data(), static_cast<SQInteger>(value.size()));
+}
+
+// Shio: Otherwise pointers would be converted to bool.
+inline void push_native_result(HSQUIRRELVM v, const SQChar * value)
+{
+    sq_pushstring(v, value, -1);
+}
+
+/*
+ * The parts of a function signature the thunks need. `Class` is void for free
+ * functions and static member functions.
+ */
+template <typename Func>
+struct NativeSignature;
+
+template <typename Ret, typename... Args>
+struct NativeSignature<Ret (*)(Args...)>
+{
+    using Class     = void;
+    using Result    = Ret;
+    using Arguments = std::tuple<std::remove_cvref_t<Args>...>;
+};
+
+template <typename Ret, typename... Args>
+struct NativeSignature<Ret (*)(Args...) noexcept>
+    : NativeSignature<Ret (*)(Args...)>
+{
+};
+
+template <typename Ret, typename C, typename... Args>
+struct NativeSignature<Ret (C::*)(Args...)>
+{
+    using Class     = C;
+    using Result    = Ret;
+    using Arguments = std::tuple<std::remove_cvref_t<Args>...>;
+};
+
+template <typename Ret, typename C, typename... Args>
+struct NativeSignature<Ret (C::*)(Args...) const>
+    : NativeSignature<Ret (C::*)(Args...)>
+{
+    using Class = const C;
+};
+
+template <typename Ret, typename C, typename... Args>
+struct NativeSignature<Ret (C::*)(Args...) noexcept>
+    : NativeSignature<Ret (C::*)(Args...)>
+{
+};
+
+template <typename Ret, typename C, typename... Args>
+struct NativeSignature<Ret (C::*)(Args...) const noexcept>
+    : NativeSignature<Ret (C::*)(Args...) const>
+{
+};
+
+namespace details
+{
+template <typename Tuple>
+struct NativeArgumentTuple;
+
+template <typename... Args>
+struct NativeArgumentTuple<std::tuple<Args...>>
+{
+    using Values = std::tuple<typename NativeArgument<Args>::value_type...>;
+
+    // Shio: '.' or 'x' for `this`, then one character per argument.
+    template <bool IsMember>
+    constexpr static auto type_mask()
+    {
+        return std::array<SQChar, sizeof...(Args) + 2> {
+            IsMember ? 'x' : '.', NativeArgument<Args>::TYPE_MASK..., '\0'
+        };
+    }
+
+    // Shio: Returns the stack index of the first argument that could not be
+    // read, or 0.
+    template <std::size_t... I>
+    static SQInteger read(
+        [[maybe_unused]] HSQUIRRELVM v,
+        [[maybe_unused]] Values &    values,
+        std::index_sequence<I...>
+    )
+    {
+        SQInteger failed = 0;
+        (
+            [&] {
+                constexpr SQInteger idx = static_cast<SQInteger>(I) + 2;
+                const bool ok = NativeArgument<Args>::read(
+                    v, idx, std::get<I>(values)
+                );
+                if(USAGI_QUIRREL_CHECK_NATIVE_ARGS && !ok && !failed)
+                    failed = idx;
+            }(),
+            ...
+        );
+        return failed;
+    }
+};
+} // namespace details
+
+/*
+ * A SQFUNCTION calling `Func` with its arguments read from fixed stack slots.
+ * The reads and the call are resolved from the signature of `Func` at compile
+ * time, so no argument is boxed and strings taken as `std::string_view` or
+ * `const SQChar *` are not copied. For member functions, `this` must be an
+ * instance of a class bound with `Sqrat::Class<C>`. Exceptions thrown by
+ * `Func` are reported as script errors.
+ */
+template <auto Func>
+SQInteger native_thunk(HSQUIRRELVM v)
+{
+    using Signature = NativeSignature<decltype(Func)>;
+    using Arguments = details::NativeArgumentTuple<
+        typename Signature::Arguments>;
+    using Class     = typename Signature::Class;
+    using Result    = typename Signature::Result;
+
+    constexpr auto num_args = std::tuple_size_v<typename Signature::Arguments>;
+
+    typename Arguments::Values values;
+    if(const auto failed = Arguments::read(
+           v, values, std::make_index_sequence<num_args>()
+       ))
+    {
+        return sq_throwerror(
+            v,
+            ("native call: argument " + std::to_string(failed - 1) +
+                " has a mismatched type")
+                .c_str()
+        );
+    }
+
+    try
+    {
+        const auto call = [&]() -> decltype(auto) {
+            if constexpr(std::is_void_v<Class>)
+            {
+                return std::apply(Func, std::move(values));
+            }
+            else
+            {
+                // Shio: Sqrat checks the class of the instance.
+                auto * self = Sqrat::ClassType<std::remove_const_t<Class>>::
+                    GetInstance(v, 1);
+                if(!self) throw std::invalid_argument("invalid instance");
+                return std::apply(
+                    [&](auto &&... args) -> decltype(auto) {
+                        return (self->*Func)(
+                            std::forward<decltype(args)>(args)...
+                        );
+                    },
+                    std::move(values)
+                );
+            }
+        };
+
+        if constexpr(std::is_void_v<Result>)
+        {
+            call();
+            return 0;
+        }
+        else
+        {
+            push_native_result(v, call());
+            return 1;
+        }
+    }
+    catch(const std::exception & e)
+    {
+        return sq_throwerror(v, e.what());
+    }
+}
+
+/*
+ * Binds `Func` to `name` in a table or class through `native_thunk`. The
+ * number of arguments is always checked by the VM. Their types are checked
+ * too when USAGI_QUIRREL_CHECK_NATIVE_ARGS is enabled:
+ *
+ *     bind_native<&get_delta_time>(exports, "get_delta_time");
+ *     bind_native<&GameObject::SetPosition>(game_object_class, "SetPosition");
+ */
+template <auto Func>
+void bind_native(const Sqrat::Object & target, const SQChar * name)
+{
+    using Signature = NativeSignature<decltype(Func)>;
+    using Arguments = details::NativeArgumentTuple<
+        typename Signature::Arguments>;
+
+    constexpr auto num_args = std::tuple_size_v<typename Signature::Arguments>;
+    constexpr static auto type_mask = Arguments::template type_mask<
+        !std::is_void_v<typename Signature::Class>>();
+
+    const auto v = target.GetVM();
+    sq_pushobject(v, target.GetObject());
+    sq_pushstring(v, name, -1);
+    sq_newclosure(v, &native_thunk<Func>, 0);
+    sq_setparamscheck(
+        v, static_cast<SQInteger>(num_args) + 1,
+        USAGI_QUIRREL_CHECK_NATIVE_ARGS ? type_mask.data() : nullptr
+    );
+    sq_setnativeclosurename(v, -1, name);
+    sq_newslot(v, -3, SQFalse);
+    sq_pop(v, 1);
+}
+} // namespace usagi::scripting::quirrel::interop
@@ -0,0 +1,202 @@
+﻿// Benchmark of ticking many entity coroutines of which few wake per frame.
+//
+// Usage: CoroutineWakeBenchmark [coroutines] [frames]
+//
+// Creates the given number of coroutines (default 100000) that each wake once
+// every 100 frames with staggered phases, so 1% of them wake per frame, and
+// ticks the CoroutineManager with a simulated 64 Hz clock (default 600
+// frames). The first 100 frames are excluded as warm-up. Scenarios:
+//
+//  - poll:  the previous approach. Every coroutine is resumed every frame and
+//           counts the frames itself before doing its work.
+//  - timer: the coroutines sleep with wait_seconds() in the timer wheel.
+//  - event: the coroutines wait for one of 100 events with wait_event(), and
+//           one event is signaled per frame.
+//
+// For each scenario, the average number of coroutines resumed per frame and
+// the mean, median and 99th percentile of the tick time are reported.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <memory>
+#include <string>
+#include <vector>
+
+// clang-format off
+#include <squirrel.h>
+#include <sqrat.h>
+// clang-format on
+
+#include <Usagi/Modules/Common/Time/MonotonicClock.hpp>
+#include <Usagi/Modules/Runtime/Logging/RuntimeLogger.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Execution/Exceptions.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Execution/VirtualMachines/VirtualMachine.hpp>
+
+using namespace usagi;
+using namespace usagi::scripting::quirrel;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t   PERIOD_FRAMES = 100;
+// 1/64 s, so the waits in seconds convert to whole nanoseconds.
+constexpr std::uint64_t FRAME_NS      = 15'625'000;
+
+// The body of each coroutine. `phase` is in [0, PERIOD_FRAMES).
+constexpr const char * SCENARIOS[][2] = {
+    { "poll", R"(
+        local wakes = 0
+        local remaining = phase + 1
+        while (true) {
+            if (--remaining == 0) {
+                remaining = PERIOD
+                ++wakes
+            }
+            suspend(null)
+        }
+    )" },
+    { "timer", R"(
+        let { wait_next_frame, wait_seconds } = ::coroutines
+        local wakes = 0
+        wait_next_frame()
+        wait_seconds(phase * DT)
+        while (true) {
+            ++wakes
+            wait_seconds(PERIOD * DT)
+        }
+    )" },
+    { "event", R"(
+        let { wait_event } = ::coroutines
+        let name = $"group_{phase}"
+        local wakes = 0
+        while (true) {
+            wait_event(name)
+            ++wakes
+        }
+    )" },
+};
+
+Sqrat::Object compile_exports(HSQUIRRELVM v, const std::string & script)
+{
+    const SQInteger top = sq_gettop(v);
+    if(SQ_FAILED(sq_compile(
+           v, script.c_str(), static_cast<SQInteger>(script.size()),
+           "__coroutine_benchmark__", SQTrue
+       )))
+    {
+        sq_settop(v, top);
+        throw ScriptCompilationError("Failed to compile the benchmark.");
+    }
+    sq_pushroottable(v);
+    if(SQ_FAILED(sq_call(v, 1, SQTrue, SQTrue)))
+    {
+        sq_settop(v, top);
+        throw ScriptExecutionError("Failed to execute the benchmark.");
+    }
+    Sqrat::Var<Sqrat::Object> exports(v, -1);
+    sq_settop(v, top);
+    return exports.value;
+}
+
+void run(
+    const char *      name,
+    const char *      body,
+    const std::size_t num_coroutines,
+    const std::size_t frames)
+{
+    auto env = std::make_shared<RuntimeEnvironment>();
+    // No sinks: the messages are formatted but not written anywhere.
+    env->service_provider.create_default_service<runtime::RuntimeLogger>()
+        .value();
+
+    const auto vm = std::make_shared<VirtualMachine>(env);
+    vm->init();
+    const auto v = vm->get_vm();
+
+    Sqrat::RootTable(v).Bind(
+        "coroutines", vm->coroutine_manager().create_script_module()
+    );
+
+    const auto script = std::format(
+        R"(
+        const PERIOD = {}
+        const DT = {}
+        return {{
+            GetAllEntityCoroutines = function() {{
+                let coroutines = []
+                for (local i = 0; i < {}; ++i) {{
+                    let phase = i % PERIOD
+                    coroutines.append(function() {{ {} }})
+                }}
+                return coroutines
+            }}
+        }}
+        )",
+        PERIOD_FRAMES, static_cast<double>(FRAME_NS) / NANOSECONDS_PER_SECOND,
+        num_coroutines, body
+    );
+    auto exports = compile_exports(v, script);
+
+    auto & manager = vm->coroutine_manager();
+    manager._findAndCreateCoroutines(exports);
+
+    std::vector<std::string> events;
+    for(std::size_t i = 0; i < PERIOD_FRAMES; ++i)
+        events.push_back(std::format("group_{}", i));
+
+    std::vector<double> us;
+    std::size_t resumed = 0;
+    auto now_ns = monotonic_now_ns();
+    for(std::size_t f = 0; f < frames + PERIOD_FRAMES; ++f)
+    {
+        now_ns += FRAME_NS;
+        const auto begin = Clock::now();
+        manager.signal_event(events[f % PERIOD_FRAMES]);
+        manager.tick_coroutines(now_ns);
+        const auto end = Clock::now();
+
+        if(f < PERIOD_FRAMES) continue;
+        us.push_back(
+            std::chrono::duration<double, std::micro>(end - begin).count()
+        );
+        resumed += manager.num_resumed_last_tick();
+    }
+
+    double mean = 0;
+    for(auto && t : us) mean += t;
+    mean /= us.size();
+    std::ranges::sort(us);
+
+    std::fputs(
+        std::format(
+            "{},{},{},{:.1f},{:.1f},{:.1f},{:.1f}\n", name,
+            manager.num_coroutines(), frames,
+            static_cast<double>(resumed) / frames, mean, us[us.size() / 2],
+            us[us.size() * 99 / 100]
+        ).c_str(),
+        stdout
+    );
+
+    manager._shutdownAllCoroutines();
+}
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    const std::size_t num_coroutines = argc > 1 ? std::atoll(argv[1]) : 100000;
+    const std::size_t frames = argc > 2 ? std::atoll(argv[2]) : 600;
+
+    std::fputs(
+        "scenario,coroutines,frames,resumed_per_frame,mean_us,median_us,"
+        "p99_us\n",
+        stdout
+    );
+    for(auto && [name, body] : SCENARIOS)
+        run(name, body, num_coroutines, frames);
+
+    return 0;
+}
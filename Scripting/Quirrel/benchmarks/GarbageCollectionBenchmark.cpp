@@ -0,0 +1,216 @@
+﻿// Benchmark of tick times under heavy allocation with different garbage
+// collection settings.
+//
+// Usage: GarbageCollectionBenchmark [coroutines] [frames] [allocations]
+//
+// Creates the given number of coroutines (default 1000) that each keep 100
+// live tables and create the given number of table pairs (default 10) every
+// frame. Each pair references itself, so it is only freed by the cycle
+// collector. Each pair also replaces a nested table in the live ones, like the
+// tables built from JSON, which is freed by reference counting. The VM is
+// ticked for the given number of frames (default 600) after 60 frames of
+// warm-up. Scenarios:
+//
+//  - never:       nothing is collected and the cycles pile up.
+//  - every_frame: a full collection at the end of every tick.
+//  - allocation:  GarbageCollectionMode::AllocationTriggered with the default
+//                 budget of 64 MiB allocated between collections.
+//  - time_sliced: GarbageCollectionMode::TimeSliced with a budget of 0.5 ms
+//                 per frame.
+//  - time_sliced_growth: the same, but halfway through the measured frames
+//                 every coroutine adds 1000 live tables. The short pauses of
+//                 the small heap must not let the collections of the large
+//                 heap run every frame.
+//
+// For each scenario, the mean, median, 99th percentile and maximum of the
+// tick time, the number of collections, the longest pause and the number of
+// live objects at the end are reported.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <memory>
+#include <string>
+#include <vector>
+
+// clang-format off
+#include <squirrel.h>
+#include <sqrat.h>
+// clang-format on
+
+#include <Usagi/Modules/Runtime/Logging/RuntimeLogger.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Execution/Exceptions.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Execution/VirtualMachines/VirtualMachine.hpp>
+
+using namespace usagi;
+using namespace usagi::scripting::quirrel;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t WARM_UP_FRAMES = 60;
+
+struct Scenario
+{
+    const char *              name;
+    GarbageCollectionSettings settings;
+    bool                      collect_every_frame = false;
+    bool                      grow_heap           = false;
+};
+
+const Scenario SCENARIOS[] = {
+    { "never", { .mode = GarbageCollectionMode::Manual } },
+    { "every_frame", { .mode = GarbageCollectionMode::Manual }, true },
+    { "allocation", { .mode = GarbageCollectionMode::AllocationTriggered } },
+    { "time_sliced",
+      { .mode            = GarbageCollectionMode::TimeSliced,
+        .frame_budget_ns = 500'000 } },
+    { "time_sliced_growth",
+      { .mode            = GarbageCollectionMode::TimeSliced,
+        .frame_budget_ns = 500'000 },
+      false,
+      true },
+};
+
+Sqrat::Object compile_exports(HSQUIRRELVM v, const std::string & script)
+{
+    const SQInteger top = sq_gettop(v);
+    if(SQ_FAILED(sq_compile(
+           v, script.c_str(), static_cast<SQInteger>(script.size()),
+           "__garbage_collection_benchmark__", SQTrue
+       )))
+    {
+        sq_settop(v, top);
+        throw ScriptCompilationError("Failed to compile the benchmark.");
+    }
+    sq_pushroottable(v);
+    if(SQ_FAILED(sq_call(v, 1, SQTrue, SQTrue)))
+    {
+        sq_settop(v, top);
+        throw ScriptExecutionError("Failed to execute the benchmark.");
+    }
+    Sqrat::Var<Sqrat::Object> exports(v, -1);
+    sq_settop(v, top);
+    return exports.value;
+}
+
+void run(
+    const Scenario &  scenario,
+    const std::size_t num_coroutines,
+    const std::size_t frames,
+    const std::size_t allocations)
+{
+    auto env = std::make_shared<RuntimeEnvironment>();
+    // No sinks: the messages are formatted but not written anywhere.
+    env->service_provider.create_default_service<runtime::RuntimeLogger>()
+        .value();
+
+    const auto vm = std::make_shared<VirtualMachine>(env);
+    vm->init();
+    const auto v = vm->get_vm();
+
+    Sqrat::RootTable(v).Bind(
+        "coroutines", vm->coroutine_manager().create_script_module()
+    );
+    Sqrat::RootTable(v).SetValue("big_heap", false);
+
+    const auto script = std::format(
+        R"(
+        let {{ wait_next_frame }} = ::coroutines
+        return {{
+            GetAllEntityCoroutines = function() {{
+                let coroutines = []
+                for (local c = 0; c < {}; ++c) {{
+                    coroutines.append(function() {{
+                        let state = []
+                        for (local i = 0; i < 100; ++i)
+                            state.append({{ id = i, value = i * 0.5 }})
+                        while (true) {{
+                            if (::big_heap && state.len() == 100) {{
+                                for (local i = 0; i < 1000; ++i)
+                                    state.append({{ id = i, value = i * 0.5 }})
+                            }}
+                            for (local i = 0; i < {}; ++i) {{
+                                let a = {{ id = i, tags = ["x", "y"] }}
+                                let b = {{ other = a }}
+                                a.other <- b
+                                state[i % 100].json <- {{
+                                    pos = {{ x = i, y = i * 2 }},
+                                    name = "entity"
+                                }}
+                            }}
+                            wait_next_frame()
+                        }}
+                    }})
+                }}
+                return coroutines
+            }}
+        }}
+        )",
+        num_coroutines, allocations
+    );
+    auto exports = compile_exports(v, script);
+
+    auto & manager = vm->coroutine_manager();
+    manager._findAndCreateCoroutines(exports);
+
+    auto & collector = vm->garbage_collector();
+    collector.configure(scenario.settings);
+
+    std::vector<double> us;
+    for(std::size_t f = 0; f < frames + WARM_UP_FRAMES; ++f)
+    {
+        if(scenario.grow_heap && f == WARM_UP_FRAMES + frames / 2)
+            Sqrat::RootTable(v).SetValue("big_heap", true);
+
+        const auto begin = Clock::now();
+        vm->tick();
+        if(scenario.collect_every_frame) collector.collect_garbage();
+        const auto end = Clock::now();
+
+        if(f < WARM_UP_FRAMES) continue;
+        us.push_back(
+            std::chrono::duration<double, std::micro>(end - begin).count()
+        );
+    }
+
+    double mean = 0;
+    for(auto && t : us) mean += t;
+    mean /= us.size();
+    std::ranges::sort(us);
+
+    const auto & stats = collector.stats();
+    std::fputs(
+        std::format(
+            "{},{},{},{:.1f},{:.1f},{:.1f},{:.1f},{},{:.1f},{}\n",
+            scenario.name, manager.num_coroutines(), frames, mean,
+            us[us.size() / 2], us[us.size() * 99 / 100], us.back(),
+            stats.collections, stats.max_pause_ns / 1000.0,
+            collector.count_live_objects()
+        ).c_str(),
+        stdout
+    );
+
+    manager._shutdownAllCoroutines();
+}
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    const std::size_t num_coroutines = argc > 1 ? std::atoll(argv[1]) : 1000;
+    const std::size_t frames = argc > 2 ? std::atoll(argv[2]) : 600;
+    const std::size_t allocations = argc > 3 ? std::atoll(argv[3]) : 10;
+
+    std::fputs(
+        "scenario,coroutines,frames,mean_us,median_us,p99_us,max_us,"
+        "collections,max_pause_us,live_objects\n",
+        stdout
+    );
+    for(auto && scenario : SCENARIOS)
+        run(scenario, num_coroutines, frames, allocations);
+
+    return 0;
+}
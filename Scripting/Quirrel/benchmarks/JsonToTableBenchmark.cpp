@@ -0,0 +1,176 @@
+﻿// Benchmark of building Squirrel tables from JSON.
+//
+// Usage: JsonToTableBenchmark [payload size in KiB] [repetitions]
+//
+// Builds a table from a generated JSON payload (default 1 MiB) in three ways
+// and reports the median time and throughput of each:
+//
+//  - script: the previous approach. The JSON is dumped to text, prefixed with
+//    "return ", then compiled and executed as a script.
+//  - dom:    JsonSerializer::compile_json_to_table from a parsed DOM. The
+//    "dom_with_parse" row includes parsing the text into the DOM.
+//  - sax:    JsonSerializer::parse_json_to_table directly from the text.
+//
+// The tables built by the three methods are serialized back to JSON and
+// compared to make sure they are the same.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <string>
+#include <vector>
+
+// clang-format off
+#include <squirrel.h>
+#include <sqrat.h>
+// clang-format on
+
+#include <nlohmann/json.hpp>
+
+#include <Usagi/Modules/Scripting/Quirrel/Execution/Exceptions.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Interop/Json.hpp>
+
+using namespace usagi::scripting::quirrel;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Entity-like records similar to config pushes and network payloads.
+nlohmann::json make_payload(const std::size_t target_bytes)
+{
+    nlohmann::json entities = nlohmann::json::array();
+    std::size_t bytes = 0;
+    for(std::size_t i = 0; bytes < target_bytes; ++i)
+    {
+        nlohmann::json e = {
+            { "id", i },
+            { "name", std::format("entity_{:06}", i) },
+            { "active", i % 3 != 0 },
+            { "position", { i * 0.5, i * -0.25, 1.0 / (i + 1) } },
+            { "tags", { "unit", i % 2 ? "ally" : "enemy" } },
+            { "stats", {
+                { "hp", 100 + i % 50 },
+                { "mp", 30 + i % 7 },
+                { "speed", 1.5 + (i % 10) * 0.1 },
+                { "owner", nullptr },
+            } },
+        };
+        bytes += e.dump().size() + 1;
+        entities.push_back(std::move(e));
+    }
+    return { { "version", 3 }, { "entities", std::move(entities) } };
+}
+
+// The previous implementation of compile_json_to_table.
+Sqrat::Table compile_via_script(HSQUIRRELVM v, const nlohmann::json & j)
+{
+    const std::string script = "return " + j.dump();
+    const SQInteger top = sq_gettop(v);
+    if(SQ_FAILED(sq_compile(
+           v, script.c_str(), static_cast<SQInteger>(script.size()),
+           "__json_compiler__", SQTrue
+       )))
+    {
+        sq_settop(v, top);
+        throw ScriptCompilationError("Failed to compile JSON.");
+    }
+    sq_pushroottable(v);
+    if(SQ_FAILED(sq_call(v, 1, SQTrue, SQTrue)))
+    {
+        sq_settop(v, top);
+        throw ScriptExecutionError("Failed to execute JSON.");
+    }
+    Sqrat::Var<Sqrat::Table> table(v, -1);
+    sq_settop(v, top);
+    return table.value;
+}
+
+template <typename Func>
+double median_ms(const std::size_t repetitions, Func && func)
+{
+    std::vector<double> ms;
+    for(std::size_t i = 0; i < repetitions; ++i)
+    {
+        const auto begin = Clock::now();
+        func();
+        const auto end = Clock::now();
+        ms.push_back(
+            std::chrono::duration<double, std::milli>(end - begin).count()
+        );
+    }
+    std::ranges::sort(ms);
+    return ms[ms.size() / 2];
+}
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    const std::size_t kib = argc > 1 ? std::atoll(argv[1]) : 1024;
+    const std::size_t repetitions = argc > 2 ? std::atoll(argv[2]) : 20;
+
+    HSQUIRRELVM v = sq_open(1024);
+
+    const auto payload = make_payload(kib * 1024);
+    const auto text = payload.dump();
+    const double mib = text.size() / (1024.0 * 1024.0);
+
+    // check that all methods build the same table. the texts are parsed
+    // again because the order of the keys follows the hash nodes.
+    {
+        const auto to_json = [](const Sqrat::Table & table) {
+            return nlohmann::json::parse(
+                interop::JsonSerializer::table_to_json_string(table)
+            );
+        };
+        const auto expected = to_json(compile_via_script(v, payload));
+        const auto dom = to_json(
+            interop::JsonSerializer::compile_json_to_table(v, payload)
+        );
+        const auto sax = to_json(
+            interop::JsonSerializer::parse_json_to_table(v, text)
+        );
+        if(dom != expected || sax != expected)
+        {
+            std::fputs("mismatched tables.\n", stderr);
+            return 1;
+        }
+    }
+
+    std::fputs(
+        std::format(
+            "payload_bytes={} repetitions={}\nmethod,ms,mib_per_s\n",
+            text.size(), repetitions
+        ).c_str(),
+        stdout
+    );
+
+    const auto report = [&](const char * name, const double ms) {
+        std::fputs(
+            std::format("{},{:.3f},{:.1f}\n", name, ms, mib / ms * 1e3)
+                .c_str(),
+            stdout
+        );
+    };
+
+    report("script", median_ms(repetitions, [&] {
+        compile_via_script(v, payload);
+    }));
+    report("dom", median_ms(repetitions, [&] {
+        interop::JsonSerializer::compile_json_to_table(v, payload);
+    }));
+    report("dom_with_parse", median_ms(repetitions, [&] {
+        interop::JsonSerializer::compile_json_to_table(
+            v, nlohmann::json::parse(text)
+        );
+    }));
+    report("sax", median_ms(repetitions, [&] {
+        interop::JsonSerializer::parse_json_to_table(v, text);
+    }));
+
+    sq_close(v);
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+﻿// Benchmark of calling native functions from a script loop.
+//
+// Usage: NativeCallBenchmark [calls] [repetitions]
+//
+// Calls each native the given number of times (default 10000000) from a
+// script loop, bound once through Sqrat and once through
+// interop::bind_native, and reports the median time per call over the
+// repetitions (default 5). The time of the same loop without the call is
+// subtracted. Natives:
+//
+//  - add:      double(int, double), a free function.
+//  - length:   size_t(std::string_view), Sqrat binds it as std::string.
+//  - position: void(float, float, float), a member function like
+//              GameObject::SetPosition.
+//
+// The type checks of the fast path follow USAGI_QUIRREL_CHECK_NATIVE_ARGS,
+// which is off unless _DEBUG is defined.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// clang-format off
+#include <squirrel.h>
+#include <sqrat.h>
+// clang-format on
+
+#include <Usagi/Modules/Scripting/Quirrel/Execution/Exceptions.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Interop/NativeBindings.hpp>
+
+using namespace usagi::scripting::quirrel;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double add(const int a, const double b)
+{
+    return a + b;
+}
+
+std::size_t length(const std::string_view str)
+{
+    return str.size();
+}
+
+std::size_t length_sqrat(const std::string & str)
+{
+    return str.size();
+}
+
+struct Position
+{
+    float x = 0, y = 0, z = 0;
+
+    void set(const float nx, const float ny, const float nz)
+    {
+        x = nx;
+        y = ny;
+        z = nz;
+    }
+};
+
+// Shio: `{}` is replaced by the call, `i` is the loop counter.
+constexpr const char * LOOP = R"(
+    let { add, add_fast, length, length_fast, Position } = ::natives
+    let pos = Position()
+    let name = "entity_name"
+    return function(n) {{
+        for (local i = 0; i < n; ++i) {{
+            {}
+        }}
+    }}
+)";
+
+struct Scenario
+{
+    const char * name;
+    const char * binding;
+    const char * call;
+};
+
+constexpr Scenario SCENARIOS[] = {
+    { "add", "sqrat", "add(i, 0.5)" },
+    { "add", "fast", "add_fast(i, 0.5)" },
+    { "length", "sqrat", "length(name)" },
+    { "length", "fast", "length_fast(name)" },
+    { "position", "sqrat", "pos.set(i, 2.0, 3.0)" },
+    { "position", "fast", "pos.set_fast(i, 2.0, 3.0)" },
+};
+
+void bind_natives(HSQUIRRELVM v)
+{
+    Sqrat::Table natives(v);
+    natives.Func("add", &add);
+    natives.Func("length", &length_sqrat);
+    interop::bind_native<&add>(natives, "add_fast");
+    interop::bind_native<&length>(natives, "length_fast");
+
+    Sqrat::Class<Position> position(v, "Position");
+    position.Ctor().Func("set", &Position::set);
+    interop::bind_native<&Position::set>(position, "set_fast");
+    natives.Bind("Position", position);
+
+    Sqrat::RootTable(v).Bind("natives", natives);
+}
+
+Sqrat::Function compile_loop(HSQUIRRELVM v, const std::string & call)
+{
+    const auto script = std::vformat(LOOP, std::make_format_args(call));
+
+    const SQInteger top = sq_gettop(v);
+    if(SQ_FAILED(sq_compile(
+           v, script.c_str(), static_cast<SQInteger>(script.size()),
+           "__native_call_benchmark__", SQTrue
+       )))
+    {
+        sq_settop(v, top);
+        throw ScriptCompilationError("Failed to compile the benchmark.");
+    }
+    sq_pushroottable(v);
+    if(SQ_FAILED(sq_call(v, 1, SQTrue, SQTrue)))
+    {
+        sq_settop(v, top);
+        throw ScriptExecutionError("Failed to execute the benchmark.");
+    }
+    Sqrat::Var<Sqrat::Function> loop(v, -1);
+    sq_settop(v, top);
+    return loop.value;
+}
+
+double median_ns(
+    const Sqrat::Function & loop,
+    const std::size_t       calls,
+    const std::size_t       repetitions
+)
+{
+    std::vector<double> ns;
+    for(std::size_t r = 0; r < repetitions; ++r)
+    {
+        const auto begin = Clock::now();
+        if(!loop.Execute(static_cast<SQInteger>(calls)))
+            throw ScriptExecutionError("The benchmark loop failed.");
+        const auto end = Clock::now();
+        ns.push_back(std::chrono::duration<double, std::nano>(end - begin)
+                         .count());
+    }
+    std::ranges::sort(ns);
+    return ns[ns.size() / 2];
+}
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    const std::size_t calls = argc > 1 ? std::atoll(argv[1]) : 10000000;
+    const std::size_t repetitions = argc > 2 ? std::atoll(argv[2]) : 5;
+
+    const auto v = sq_open(1024);
+    bind_natives(v);
+
+    const auto baseline =
+        median_ns(compile_loop(v, ""), calls, repetitions) / calls;
+
+    std::fputs(
+        std::format(
+            "calls={} repetitions={} checks={} loop_ns={:.2f}\n"
+            "native,binding,ns_per_call\n",
+            calls, repetitions, USAGI_QUIRREL_CHECK_NATIVE_ARGS, baseline
+        ).c_str(),
+        stdout
+    );
+
+    for(auto && [name, binding, call] : SCENARIOS)
+    {
+        const auto ns =
+            median_ns(compile_loop(v, call), calls, repetitions) / calls;
+        std::fputs(
+            std::format("{},{},{:.2f}\n", name, binding, ns - baseline)
+                .c_str(),
+            stdout
+        );
+    }
+
+    sq_close(v);
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+﻿// Benchmark of the overhead of the sampling profiler on script execution.
+//
+// Usage: SamplingProfilerBenchmark [repetitions] [interval_us]
+//
+// Runs a call-heavy script (recursive fib(24) plus a loop over a table) the
+// given number of times (default 20) and reports the median run time of each
+// scenario and its overhead over the first one:
+//
+//  - none:     no debug hook is installed.
+//  - idle:     the profiler is attached, but no samples are requested, so
+//              the hook only loads the flag.
+//  - sampling: samples are requested every interval (default 1000 us, i.e.
+//              1 kHz).
+//
+// For the last scenario, the number of samples requested and taken is
+// reported too, and the folded stacks are written to
+// SamplingProfilerBenchmark.folded.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// clang-format off
+#include <squirrel.h>
+#include <sqrat.h>
+// clang-format on
+
+#include <Usagi/Modules/Scripting/Quirrel/Debugging/SamplingProfiler.hpp>
+#include <Usagi/Modules/Scripting/Quirrel/Execution/Exceptions.hpp>
+
+using namespace usagi::scripting::quirrel;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view SCRIPT = R"(
+    local function fib(n) {
+        return n < 2 ? n : fib(n - 1) + fib(n - 2)
+    }
+    local function sum_values(t) {
+        local sum = 0
+        foreach (v in t)
+            sum += v
+        return sum
+    }
+    return function() {
+        local t = {}
+        for (local i = 0; i < 1000; ++i)
+            t[i] <- i
+        local sum = 0
+        for (local i = 0; i < 100; ++i)
+            sum += sum_values(t)
+        return fib(24) + sum
+    }
+)";
+
+Sqrat::Function compile_script(HSQUIRRELVM v)
+{
+    const SQInteger top = sq_gettop(v);
+    if(SQ_FAILED(sq_compile(
+           v, SCRIPT.data(), static_cast<SQInteger>(SCRIPT.size()),
+           "__sampling_profiler_benchmark__", SQTrue
+       )))
+    {
+        sq_settop(v, top);
+        throw ScriptCompilationError("Failed to compile the benchmark.");
+    }
+    sq_pushroottable(v);
+    if(SQ_FAILED(sq_call(v, 1, SQTrue, SQTrue)))
+    {
+        sq_settop(v, top);
+        throw ScriptExecutionError("Failed to execute the benchmark.");
+    }
+    Sqrat::Var<Sqrat::Function> run(v, -1);
+    sq_settop(v, top);
+    return run.value;
+}
+
+double median_ms(const Sqrat::Function & run, const std::size_t repetitions)
+{
+    std::vector<double> ms;
+    for(std::size_t r = 0; r < repetitions; ++r)
+    {
+        const auto begin = Clock::now();
+        if(!run.Execute())
+            throw ScriptExecutionError("The benchmark script failed.");
+        const auto end = Clock::now();
+        ms.push_back(std::chrono::duration<double, std::milli>(end - begin)
+                         .count());
+    }
+    std::ranges::sort(ms);
+    return ms[ms.size() / 2];
+}
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    const std::size_t repetitions = argc > 1 ? std::atoll(argv[1]) : 20;
+    const std::chrono::microseconds interval(
+        argc > 2 ? std::atoll(argv[2]) : 1000
+    );
+
+    const auto v = sq_open(1024);
+    {
+        const auto run = compile_script(v);
+        // Shio: Warm-up.
+        median_ms(run, 1);
+
+        std::fputs("scenario,median_ms,overhead_percent\n", stdout);
+        const auto report = [](const char * name, double ms, double baseline) {
+            std::fputs(
+                std::format(
+                    "{},{:.3f},{:.2f}\n", name, ms, (ms / baseline - 1) * 100
+                ).c_str(),
+                stdout
+            );
+        };
+
+        sq_setnativedebughook(v, nullptr);
+        const auto none = median_ms(run, repetitions);
+        report("none", none, none);
+
+        debugging::SamplingProfiler profiler;
+        profiler.attach(v);
+        report("idle", median_ms(run, repetitions), none);
+
+        profiler.start(interval);
+        const auto sampling = median_ms(run, repetitions);
+        profiler.stop();
+        report("sampling", sampling, none);
+
+        profiler.collect();
+        std::fputs(
+            std::format(
+                "requested={} samples={} dropped={}\n",
+                profiler.num_requested(), profiler.num_samples(),
+                profiler.num_dropped()
+            ).c_str(),
+            stdout
+        );
+        profiler.write_folded_stacks("SamplingProfilerBenchmark.folded");
+
+        // Shio: The profiler goes away before the VM.
+        profiler.detach(v);
+    }
+    sq_close(v);
+
+    return 0;
+}
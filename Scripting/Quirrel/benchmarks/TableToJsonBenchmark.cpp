@@ -0,0 +1,167 @@
+﻿// Benchmark of serializing Squirrel tables to JSON.
+//
+// Usage: TableToJsonBenchmark [payload size in KiB] [repetitions]
+//
+// Builds a table from a generated JSON payload (default 1 MiB) and reports the
+// median time and throughput of serializing it back:
+//
+//  - dom_pretty / dom_compact: the previous approach, which builds a
+//    nlohmann::json DOM with JsonSerializer::serialize and dumps it.
+//  - stream_pretty / stream_compact: JsonSerializer::write_json into a buffer
+//    that is reused across repetitions.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// clang-format off
+#include <squirrel.h>
+#include <sqobject.h>
+#include <sqrat.h>
+// clang-format on
+
+#include <nlohmann/json.hpp>
+
+#include <Usagi/Modules/Scripting/Quirrel/Interop/Json.hpp>
+
+using namespace usagi::scripting::quirrel;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+nlohmann::json make_payload(const std::size_t target_bytes)
+{
+    nlohmann::json entities = nlohmann::json::array();
+    std::size_t bytes = 0;
+    for(std::size_t i = 0; bytes < target_bytes; ++i)
+    {
+        nlohmann::json e = {
+            { "id", i },
+            { "name", std::format("entity_{:06}", i) },
+            { "active", i % 3 != 0 },
+            { "position", { i * 0.5, i * -0.25, 1.0 / (i + 1) } },
+            { "tags", { "unit", i % 2 ? "ally" : "enemy" } },
+            { "stats", {
+                { "hp", 100 + i % 50 },
+                { "mp", 30 + i % 7 },
+                { "speed", 1.5 + (i % 10) * 0.1 },
+            } },
+        };
+        bytes += e.dump().size() + 1;
+        entities.push_back(std::move(e));
+    }
+    return { { "version", 3 }, { "entities", std::move(entities) } };
+}
+
+template <typename Func>
+double median_ms(const std::size_t repetitions, Func && func)
+{
+    std::vector<double> ms;
+    for(std::size_t i = 0; i < repetitions; ++i)
+    {
+        const auto begin = Clock::now();
+        func();
+        const auto end = Clock::now();
+        ms.push_back(
+            std::chrono::duration<double, std::milli>(end - begin).count()
+        );
+    }
+    std::ranges::sort(ms);
+    return ms[ms.size() / 2];
+}
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    const std::size_t kib = argc > 1 ? std::atoll(argv[1]) : 1024;
+    const std::size_t repetitions = argc > 2 ? std::atoll(argv[2]) : 20;
+
+    HSQUIRRELVM v = sq_open(1024);
+    {
+        auto table = interop::JsonSerializer::compile_json_to_table(
+            v, make_payload(kib * 1024)
+        );
+        // Shio: Values JSON can't hold are written as their type names. Only
+        // arrays keep closures, tables skip them.
+        {
+            constexpr std::string_view callback = "return 0";
+            if(SQ_FAILED(sq_compile(
+                   v, callback.data(),
+                   static_cast<SQInteger>(callback.size()), "__callback__",
+                   SQTrue
+               )))
+            {
+                std::fputs("failed to compile the callback.\n", stderr);
+                return 1;
+            }
+            Sqrat::Var<Sqrat::Object> closure(v, -1);
+            sq_pop(v, 1);
+            Sqrat::Array callbacks(v);
+            callbacks.Append(closure.value);
+            table.SetValue("callbacks", callbacks);
+        }
+        objects::sq_object_ptr obj(table.GetObject());
+
+        std::string buffer;
+        interop::JsonSerializer::write_json(
+            v, obj, buffer, interop::JsonFormat::Compact
+        );
+        const double mib = buffer.size() / (1024.0 * 1024.0);
+
+        // the streaming writer must produce the same values.
+        if(nlohmann::json::parse(buffer) !=
+           interop::JsonSerializer::serialize(v, obj))
+        {
+            std::fputs("mismatched json.\n", stderr);
+            return 1;
+        }
+
+        std::fputs(
+            std::format(
+                "compact_bytes={} repetitions={}\nmethod,ms,mib_per_s\n",
+                buffer.size(), repetitions
+            ).c_str(),
+            stdout
+        );
+
+        const auto report = [&](const char * name, const double ms) {
+            std::fputs(
+                std::format("{},{:.3f},{:.1f}\n", name, ms, mib / ms * 1e3)
+                    .c_str(),
+                stdout
+            );
+        };
+
+        report("dom_pretty", median_ms(repetitions, [&] {
+            interop::JsonSerializer::serialize(v, obj).dump(
+                4, ' ', false, nlohmann::json::error_handler_t::replace
+            );
+        }));
+        report("dom_compact", median_ms(repetitions, [&] {
+            interop::JsonSerializer::serialize(v, obj).dump(
+                -1, ' ', false, nlohmann::json::error_handler_t::replace
+            );
+        }));
+        report("stream_pretty", median_ms(repetitions, [&] {
+            buffer.clear();
+            interop::JsonSerializer::write_json(
+                v, obj, buffer, interop::JsonFormat::Pretty
+            );
+        }));
+        report("stream_compact", median_ms(repetitions, [&] {
+            buffer.clear();
+            interop::JsonSerializer::write_json(
+                v, obj, buffer, interop::JsonFormat::Compact
+            );
+        }));
+    }
+    sq_close(v);
+
+    return 0;
+}
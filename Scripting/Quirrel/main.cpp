@@ -2,6 +2,7 @@
 #include <cmath>
 #include <iomanip>
 #include <sstream>
+#include <string_view>
 
 // clang-format off
 #include <squirrel.h>
@@ -14,6 +15,7 @@
 
 #include "Execution/VirtualMachines/VirtualMachine.hpp"
 #include "Interop/Json.hpp"
+#include "Interop/NativeBindings.hpp"
 
 using namespace usagi::scripting::quirrel;
 
@@ -65,7 +67,7 @@ SQInteger native_log(HSQUIRRELVM v)
     return 0; // 0 return values
 }
 
-void native_log_2(const std::string & str)
+void native_log_2(const std::string_view str)
 {
     gGameServer->logger().info(" {}", str);
 }
@@ -74,9 +76,8 @@ Sqrat::Table compile_json_to_table(std::string json_string)
 {
     try
     {
-        auto j = nlohmann::json::parse(json_string);
-        return interop::JsonSerializer::compile_json_to_table(
-            gGameServer->get_vm(), j
+        return interop::JsonSerializer::parse_json_to_table(
+            gGameServer->get_vm(), json_string
         );
     }
     catch(const std::exception & e)
@@ -114,6 +115,11 @@ int main(int argc, char ** argv)
     root_vm.init();
     root_vm.RegisterCommandLineArgs(argc, argv);
 
+    // Shio: `--profile` samples the script call stacks for a flame graph.
+    bool profile = false;
+    for(int i = 1; i < argc; ++i)
+        if(std::string_view(argv[i]) == "--profile") profile = true;
+
     {
         // 1. Create an 'exports' table for our native module
         auto exports = root_vm.CreateBindNewObject<Sqrat::Table>();
@@ -127,11 +133,10 @@ int main(int argc, char ** argv)
             "get_delta_time(): float",
             "Returns engine delta time (fixed at 0.016)");
         */
-        exports.Func(
-            // auto derive function type
-            "get_delta_time", &get_delta_time,
-            "Returns engine delta time (fixed at 0.016)"
-        );
+        // Shio: Hot natives go through thunks generated from their
+        // signatures instead of Sqrat's generic marshalling.
+        // Returns engine delta time (fixed at 0.016)
+        interop::bind_native<&get_delta_time>(exports, "get_delta_time");
         // exports.Func("native_log", &native_log);
         // `native_log` is a motherfucking raw Squirrel function instead of a
         // C++ one.
@@ -146,7 +151,7 @@ int main(int argc, char ** argv)
         );
         */
 
-        exports.Func("native_log", &native_log_2);
+        interop::bind_native<&native_log_2>(exports, "native_log");
 
         /* todo polymorphism in Querrel doesn't work like this. I don't think
          *   there is function overloading.
@@ -171,17 +176,28 @@ int main(int argc, char ** argv)
             .Ctor<int>()              // Bind constructor: GameObject(int id)
             .Var("x", &GameObject::x) // Bind member variable
             .Var("y", &GameObject::y)
-            .Var("z", &GameObject::z)
-            .Func(
-                "SetPosition",
-                &GameObject::SetPosition
-            ); // Bind member function
+            .Var("z", &GameObject::z);
+        // Bind member function
+        interop::bind_native<&GameObject::SetPosition>(
+            gameObjClass, "SetPosition"
+        );
 
         // 4. Bind the class itself to the exports table
         exports.Bind("GameObject", gameObjClass);
 
         // 5. Register our populated exports table as a native module
         root_vm.module_manager().addNativeModule("engine_core", exports);
+
+        // 6. Commands yielded by coroutines with
+        // `yield_command(commands.CHECKPOINT, tick_count)`.
+        root_vm.coroutine_manager().register_command(
+            "CHECKPOINT", 1, [](const CoroutineCommand & command) {
+                gGameServer->logger().info(
+                    " Coroutine {} reached checkpoint {}", command.coroutine,
+                    command.integer(0)
+                );
+            }
+        );
     }
 
     /*
@@ -195,6 +211,16 @@ int main(int argc, char ** argv)
     {
         return 1;
     }
+    // Shio: Edited scripts are reloaded while the server runs.
+    root_vm.watch_scripts("scripts");
+    // Shio: Samples the script call stacks at 1 kHz for a flame graph.
+    if(profile) root_vm.start_profiling();
+    // Shio: Spread the collections so that they take 0.5 ms per frame on
+    // average.
+    root_vm.garbage_collector().configure({
+        .mode            = GarbageCollectionMode::TimeSliced,
+        .frame_budget_ns = 500'000,
+    });
 
     // Shio: --- SCRIPT SERVER RUNNING ---
     root_vm.logger().info("\n--- SCRIPT SERVER RUNNING ---");
@@ -215,12 +241,24 @@ int main(int argc, char ** argv)
             root_vm.triggerReload();
         }
 
+        root_vm.poll_script_changes();
         root_vm.tick();
         frame++;
     }
 
     // Shio: --- SIMULATION FINISHED ---
     root_vm.logger().info("\n--- SIMULATION FINISHED ---");
+    root_vm.garbage_collector().log_stats();
+    if(profile)
+    {
+        root_vm.stop_profiling();
+        root_vm.profiler().write_folded_stacks("quirrel_profile.folded");
+        // Shio: Script samples written to quirrel_profile.folded.
+        root_vm.logger().info(
+            " {} script samples written to quirrel_profile.folded",
+            root_vm.profiler().num_samples()
+        );
+    }
     root_vm.shutdown();
     return 0;
 }
@@ -2,6 +2,7 @@
 // Represents a single entity's logic
 
 from "engine_core" import native_log, get_delta_time, GameObject
+from "coroutines" import wait_next_frame, yield_command, commands
 
 class Entity {
     cpp_obj = null
@@ -46,17 +47,16 @@ class Entity {
 
             // --- 2. Yield a Command ---
             // On tick 100, 200, etc., yield a command to C++
-            if (this.state.tick_count != 0) {
-                let cmd = $"CHECKPOINT_{this.state.tick_count}"
-                suspend("<",cmd,">") // Pauses and sends string to C++
-                //suspend("CHECKPOINT") // Pauses and sends string to C++
-                //native_log($"{this.state.name} yielding command: {cmd}")
+            if (this.state.tick_count % 100 == 0) {
+                // Pauses and sends the opcode and the tick count to C++
+                yield_command(commands.CHECKPOINT, this.state.tick_count)
             }
 
             // --- 3. Wait for next frame ---
-            // 'yield null' (or just 'yield') pauses execution
-            // until C++ resumes us on the next tick.
-            suspend(null)
+            // Parks the coroutine until C++ resumes it on the next tick.
+            // wait_seconds() and wait_event() park it for longer without
+            // being visited every tick.
+            wait_next_frame()
         }
     }
 }
@@ -95,18 +95,24 @@ function test()
     //return 1
 }
 
-// This is the factory function C++ will call
-function GetAllEntityCoroutines() {
+// This is the factory function C++ will call. The VMs of a pool pass their
+// partition, and each only gets the coroutines it runs.
+function GetAllEntityCoroutines(partition_index = 0, partition_count = 1) {
     native_log($"game_logic.nut: C++ requested 'GetAllEntityCoroutines'")
     native_log(to_json_string({ "entity": Entity(4, "Enemy_2") }))
     //native_log(to_json_string({ "entity": Entity(4, "Enemy_2") }))
     local coroutines = []
-    foreach(entity in g_state.entities) {
+    foreach(i, entity in g_state.entities) {
+        if (i % partition_count != partition_index)
+            continue
        // Add the 'UpdateCoroutine' function from each entity instance
         coroutines.append(entity.UpdateCoroutine.bindenv(entity))
     }
-    coroutines.append(function() { while(true) { suspend("test") } })
-    coroutines.append(test)
+    // The other coroutines go to the first partition.
+    if (partition_index == 0) {
+        coroutines.append(function() { while(true) { suspend("test") } })
+        coroutines.append(test)
+    }
     return coroutines
 }
 